@@ -23,6 +23,12 @@
 
 #include "readsb.h"
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 struct converter_state {
     float dc_a;
     float dc_b;
@@ -36,11 +42,9 @@ static bool init_uc8_lookup() {
     if (uc8_lookup)
         return true;
 
-    uc8_lookup = malloc(sizeof (uint16_t) * 256 * 256);
-    if (!uc8_lookup) {
-        fprintf(stderr, "can't allocate UC8 conversion lookup table\n");
+    uc8_lookup = hot_alloc(sizeof (uint16_t) * 256 * 256, "UC8 conversion lookup table");
+    if (!uc8_lookup)
         return false;
-    }
 
     for (int i = 0; i <= 255; i++) {
         for (int q = 0; q <= 255; q++) {
@@ -258,25 +262,33 @@ static void convert_sc16_nodc(void *iq_data,
 // can run substantially faster by staying in cache.
 // See convert_benchmark.c for some numbers.
 
-// Leaving SC16QQ_TABLE_BITS undefined will disable the table lookup and always use
-// the floating-point path, which may be faster on some systems
+// Leaving SC16QQ_TABLE_BITS undefined will prefer the floating-point path,
+// which may be faster on some systems. The table is then only used if
+// autotuning finds it faster, at the best size it found.
 
-#if defined(SC16Q11_TABLE_BITS)
+#define SC16Q11_MIN_TABLE_BITS 7
+#define SC16Q11_MAX_TABLE_BITS 11
 
-#define USE_BITS SC16Q11_TABLE_BITS
-#define LOSE_BITS (11 - SC16Q11_TABLE_BITS)
+#if defined(SC16Q11_TABLE_BITS)
+static int sc16q11_table_bits = SC16Q11_TABLE_BITS;
+#else
+static int sc16q11_table_bits = 9;
+#endif
 
 static uint16_t *sc16q11_lookup;
+static size_t sc16q11_lookup_size;
 
 static bool init_sc16q11_lookup() {
+    const int USE_BITS = sc16q11_table_bits;
+    const int LOSE_BITS = 11 - sc16q11_table_bits;
+
     if (sc16q11_lookup)
         return true;
 
-    sc16q11_lookup = malloc(sizeof (uint16_t) * (1 << (USE_BITS * 2)));
-    if (!sc16q11_lookup) {
-        fprintf(stderr, "can't allocate SC16Q11 conversion lookup table\n");
+    sc16q11_lookup_size = sizeof (uint16_t) * (1 << (USE_BITS * 2));
+    sc16q11_lookup = hot_alloc(sc16q11_lookup_size, "SC16Q11 conversion lookup table");
+    if (!sc16q11_lookup)
         return false;
-    }
 
     for (int i = 0; i < 2048; i += (1 << LOSE_BITS)) {
         for (int q = 0; q < 2048; q += (1 << LOSE_BITS)) {
@@ -300,6 +312,8 @@ static void convert_sc16q11_table(void *iq_data,
         struct converter_state *state,
         double *out_mean_level,
         double *out_mean_power) {
+    const int USE_BITS = sc16q11_table_bits;
+    const int LOSE_BITS = 11 - sc16q11_table_bits;
     uint16_t *in = iq_data;
     unsigned i;
     uint16_t I, Q;
@@ -327,8 +341,6 @@ static void convert_sc16q11_table(void *iq_data,
     }
 }
 
-#else /* ! defined(SC16Q11_TABLE_BITS) */
-
 static void convert_sc16q11_nodc(void *iq_data,
         uint16_t *mag_data,
         unsigned nsamples,
@@ -369,8 +381,6 @@ static void convert_sc16q11_nodc(void *iq_data,
     }
 }
 
-#endif /* defined(SC16Q11_TABLE_BITS) */
-
 static void convert_sc16q11_generic(void *iq_data,
         uint16_t *mag_data,
         unsigned nsamples,
@@ -422,47 +432,517 @@ static void convert_sc16q11_generic(void *iq_data,
     }
 }
 
+//
+// SIMD converters
+//
+// These do the same float math as the scalar float converters, a vector of
+// samples at a time: scale to [-1,1), DC block, magnitude, clamp, sqrt.
+// Without DC filtering the output is bit for bit identical to the scalar
+// converters (and to the UC8 lookup table, which is built with the same
+// float math).
+//
+// The DC block z[k] = a * x[k] + b * z[k-1] looks serial, but over a
+// vector of W samples it is a weighted prefix sum
+//
+//   z[k] = sum(j = 0..k) b^(k-j) * a * x[j] + b^(k+1) * z[-1]
+//
+// which takes log2(W) shift-and-add steps, each adding b^s times the
+// vector shifted up by s lanes, and then the carried in state scaled by
+// b^(k+1). That only changes the float rounding of z, the filter itself
+// is the same.
+//
+// Each kernel is written once per instruction set and instantiated for
+// every input format with a constant `format` and `dc`, like the
+// demodulators in demod.c.
+//
+
+// Scalar version of one sample, for the samples that don't fill a vector
+
+static inline __attribute__ ((always_inline)) uint16_t convert_one(const void *iq_data,
+        unsigned i,
+        const input_format_t format,
+        const bool dc,
+        float dc_a,
+        float dc_b,
+        float *z1_I,
+        float *z1_Q,
+        float *sum_level,
+        float *sum_power) {
+    float fI, fQ, magsq;
+
+    if (format == INPUT_UC8) {
+        const uint8_t *in = iq_data;
+        fI = (in[2 * i] - 127.5f) / 127.5f;
+        fQ = (in[2 * i + 1] - 127.5f) / 127.5f;
+    } else {
+        const uint16_t *in = iq_data;
+        const float scale = (format == INPUT_SC16 ? 32768.0f : 2048.0f);
+        fI = (int16_t) le16toh(in[2 * i]) / scale;
+        fQ = (int16_t) le16toh(in[2 * i + 1]) / scale;
+    }
+
+    if (dc) {
+        *z1_I = fI * dc_a + *z1_I * dc_b;
+        *z1_Q = fQ * dc_a + *z1_Q * dc_b;
+        fI -= *z1_I;
+        fQ -= *z1_Q;
+    }
+
+    magsq = fI * fI + fQ * fQ;
+    if (magsq > 1)
+        magsq = 1;
+
+    float mag = sqrtf(magsq);
+    *sum_power += magsq;
+    *sum_level += mag;
+    return (uint16_t) (mag * 65535.0f + 0.5f);
+}
+
+static inline __attribute__ ((always_inline)) void convert_finish(const void *iq_data,
+        uint16_t *mag_data,
+        unsigned i,
+        unsigned nsamples,
+        struct converter_state *state,
+        const input_format_t format,
+        const bool dc,
+        float z1_I,
+        float z1_Q,
+        double sum_level,
+        double sum_power,
+        double *out_mean_level,
+        double *out_mean_power) {
+    float tail_level = 0, tail_power = 0;
+
+    for (; i < nsamples; ++i)
+        mag_data[i] = convert_one(iq_data, i, format, dc, state->dc_a, state->dc_b, &z1_I, &z1_Q, &tail_level, &tail_power);
+
+    if (dc) {
+        state->z1_I = z1_I;
+        state->z1_Q = z1_Q;
+    }
+
+    if (out_mean_level) {
+        *out_mean_level = (sum_level + tail_level) / nsamples;
+    }
+
+    if (out_mean_power) {
+        *out_mean_power = (sum_power + tail_power) / nsamples;
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+__attribute__ ((target("avx2")))
+static inline __attribute__ ((always_inline)) void convert_avx2(void *iq_data,
+        uint16_t *mag_data,
+        unsigned nsamples,
+        struct converter_state *state,
+        double *out_mean_level,
+        double *out_mean_power,
+        const input_format_t format,
+        const bool dc) {
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 full_scale = _mm256_set1_ps(65535.0f);
+    const __m256 round = _mm256_set1_ps(0.5f);
+    const __m256 uc8_offset = _mm256_set1_ps(127.5f);
+    const __m256 sc16_scale = _mm256_set1_ps(format == INPUT_SC16 ? 1.0f / 32768.0f : 1.0f / 2048.0f);
+    const __m256i shift1 = _mm256_setr_epi32(0, 0, 1, 2, 3, 4, 5, 6);
+    const __m256i shift2 = _mm256_setr_epi32(0, 0, 0, 1, 2, 3, 4, 5);
+    const __m256i shift4 = _mm256_setr_epi32(0, 0, 0, 0, 0, 1, 2, 3);
+    const __m256i last = _mm256_set1_epi32(7);
+    __m256 sum_level = _mm256_setzero_ps();
+    __m256 sum_power = _mm256_setzero_ps();
+    __m256 z1_I = _mm256_set1_ps(state->z1_I);
+    __m256 z1_Q = _mm256_set1_ps(state->z1_Q);
+    __m256 dc_a = _mm256_setzero_ps(), dc_b1 = dc_a, dc_b2 = dc_a, dc_b4 = dc_a, dc_carry = dc_a;
+    unsigned i;
+
+    if (dc) {
+        float b = state->dc_b, b2 = b * b, b4 = b2 * b2;
+        float carry[8];
+
+        carry[0] = b;
+        for (int k = 1; k < 8; ++k)
+            carry[k] = carry[k - 1] * b;
+
+        dc_a = _mm256_set1_ps(state->dc_a);
+        dc_b1 = _mm256_setr_ps(0, b, b, b, b, b, b, b);
+        dc_b2 = _mm256_setr_ps(0, 0, b2, b2, b2, b2, b2, b2);
+        dc_b4 = _mm256_setr_ps(0, 0, 0, 0, b4, b4, b4, b4);
+        dc_carry = _mm256_loadu_ps(carry);
+    }
+
+    for (i = 0; i + 8 <= nsamples; i += 8) {
+        __m256 fI, fQ;
+
+        if (format == INPUT_UC8) {
+            // widen the 8 IQ byte pairs to one 32 bit lane per sample, I in the low half
+            __m256i iq = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *) ((const uint8_t *) iq_data + 2 * i)));
+            fI = _mm256_cvtepi32_ps(_mm256_and_si256(iq, _mm256_set1_epi32(0xFFFF)));
+            fQ = _mm256_cvtepi32_ps(_mm256_srli_epi32(iq, 16));
+            fI = _mm256_div_ps(_mm256_sub_ps(fI, uc8_offset), uc8_offset);
+            fQ = _mm256_div_ps(_mm256_sub_ps(fQ, uc8_offset), uc8_offset);
+        } else {
+            // one IQ pair per 32 bit lane, sign extend each half
+            __m256i iq = _mm256_loadu_si256((const __m256i *) ((const uint16_t *) iq_data + 2 * i));
+            fI = _mm256_cvtepi32_ps(_mm256_srai_epi32(_mm256_slli_epi32(iq, 16), 16));
+            fQ = _mm256_cvtepi32_ps(_mm256_srai_epi32(iq, 16));
+            fI = _mm256_mul_ps(fI, sc16_scale);
+            fQ = _mm256_mul_ps(fQ, sc16_scale);
+        }
+
+        if (dc) {
+            __m256 yI = _mm256_mul_ps(fI, dc_a);
+            __m256 yQ = _mm256_mul_ps(fQ, dc_a);
+            yI = _mm256_add_ps(yI, _mm256_mul_ps(dc_b1, _mm256_permutevar8x32_ps(yI, shift1)));
+            yQ = _mm256_add_ps(yQ, _mm256_mul_ps(dc_b1, _mm256_permutevar8x32_ps(yQ, shift1)));
+            yI = _mm256_add_ps(yI, _mm256_mul_ps(dc_b2, _mm256_permutevar8x32_ps(yI, shift2)));
+            yQ = _mm256_add_ps(yQ, _mm256_mul_ps(dc_b2, _mm256_permutevar8x32_ps(yQ, shift2)));
+            yI = _mm256_add_ps(yI, _mm256_mul_ps(dc_b4, _mm256_permutevar8x32_ps(yI, shift4)));
+            yQ = _mm256_add_ps(yQ, _mm256_mul_ps(dc_b4, _mm256_permutevar8x32_ps(yQ, shift4)));
+            yI = _mm256_add_ps(yI, _mm256_mul_ps(dc_carry, z1_I));
+            yQ = _mm256_add_ps(yQ, _mm256_mul_ps(dc_carry, z1_Q));
+            fI = _mm256_sub_ps(fI, yI);
+            fQ = _mm256_sub_ps(fQ, yQ);
+            z1_I = _mm256_permutevar8x32_ps(yI, last);
+            z1_Q = _mm256_permutevar8x32_ps(yQ, last);
+        }
+
+        __m256 magsq = _mm256_min_ps(_mm256_add_ps(_mm256_mul_ps(fI, fI), _mm256_mul_ps(fQ, fQ)), one);
+        __m256 mag = _mm256_sqrt_ps(magsq);
+        sum_power = _mm256_add_ps(sum_power, magsq);
+        sum_level = _mm256_add_ps(sum_level, mag);
+
+        // packus works per 128 bit lane, gather the two low quadwords
+        __m256i out = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(mag, full_scale), round));
+        out = _mm256_permute4x64_epi64(_mm256_packus_epi32(out, out), 0x08);
+        _mm_storeu_si128((__m128i *) & mag_data[i], _mm256_castsi256_si128(out));
+    }
+
+    float level[8], power[8];
+    double total_level = 0, total_power = 0;
+    _mm256_storeu_ps(level, sum_level);
+    _mm256_storeu_ps(power, sum_power);
+    for (int k = 0; k < 8; ++k) {
+        total_level += level[k];
+        total_power += power[k];
+    }
+
+    convert_finish(iq_data, mag_data, i, nsamples, state, format, dc,
+            _mm256_cvtss_f32(z1_I), _mm256_cvtss_f32(z1_Q),
+            total_level, total_power, out_mean_level, out_mean_power);
+}
+
+__attribute__ ((target("sse2")))
+static inline __attribute__ ((always_inline)) void convert_sse2(void *iq_data,
+        uint16_t *mag_data,
+        unsigned nsamples,
+        struct converter_state *state,
+        double *out_mean_level,
+        double *out_mean_power,
+        const input_format_t format,
+        const bool dc) {
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 full_scale = _mm_set1_ps(65535.0f);
+    const __m128 round = _mm_set1_ps(0.5f);
+    const __m128 uc8_offset = _mm_set1_ps(127.5f);
+    const __m128 sc16_scale = _mm_set1_ps(format == INPUT_SC16 ? 1.0f / 32768.0f : 1.0f / 2048.0f);
+    const __m128i zero = _mm_setzero_si128();
+    __m128 sum_level = _mm_setzero_ps();
+    __m128 sum_power = _mm_setzero_ps();
+    __m128 z1_I = _mm_set1_ps(state->z1_I);
+    __m128 z1_Q = _mm_set1_ps(state->z1_Q);
+    __m128 dc_a = _mm_setzero_ps(), dc_b1 = dc_a, dc_b2 = dc_a, dc_carry = dc_a;
+    unsigned i;
+
+    if (dc) {
+        float b = state->dc_b, b2 = b * b;
+
+        dc_a = _mm_set1_ps(state->dc_a);
+        dc_b1 = _mm_set1_ps(b);
+        dc_b2 = _mm_set1_ps(b2);
+        dc_carry = _mm_setr_ps(b, b2, b2 * b, b2 * b2);
+    }
+
+    for (i = 0; i + 4 <= nsamples; i += 4) {
+        __m128 fI, fQ;
+
+        if (format == INPUT_UC8) {
+            // widen the 4 IQ byte pairs to one 32 bit lane per sample, I in the low half
+            __m128i iq = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) ((const uint8_t *) iq_data + 2 * i)), zero);
+            fI = _mm_cvtepi32_ps(_mm_and_si128(iq, _mm_set1_epi32(0xFFFF)));
+            fQ = _mm_cvtepi32_ps(_mm_srli_epi32(iq, 16));
+            fI = _mm_div_ps(_mm_sub_ps(fI, uc8_offset), uc8_offset);
+            fQ = _mm_div_ps(_mm_sub_ps(fQ, uc8_offset), uc8_offset);
+        } else {
+            // one IQ pair per 32 bit lane, sign extend each half
+            __m128i iq = _mm_loadu_si128((const __m128i *) ((const uint16_t *) iq_data + 2 * i));
+            fI = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(iq, 16), 16));
+            fQ = _mm_cvtepi32_ps(_mm_srai_epi32(iq, 16));
+            fI = _mm_mul_ps(fI, sc16_scale);
+            fQ = _mm_mul_ps(fQ, sc16_scale);
+        }
+
+        if (dc) {
+            // byte shifts move in zeros, so the coefficients need no zero lanes
+            __m128 yI = _mm_mul_ps(fI, dc_a);
+            __m128 yQ = _mm_mul_ps(fQ, dc_a);
+            yI = _mm_add_ps(yI, _mm_mul_ps(dc_b1, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(yI), 4))));
+            yQ = _mm_add_ps(yQ, _mm_mul_ps(dc_b1, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(yQ), 4))));
+            yI = _mm_add_ps(yI, _mm_mul_ps(dc_b2, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(yI), 8))));
+            yQ = _mm_add_ps(yQ, _mm_mul_ps(dc_b2, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(yQ), 8))));
+            yI = _mm_add_ps(yI, _mm_mul_ps(dc_carry, z1_I));
+            yQ = _mm_add_ps(yQ, _mm_mul_ps(dc_carry, z1_Q));
+            fI = _mm_sub_ps(fI, yI);
+            fQ = _mm_sub_ps(fQ, yQ);
+            z1_I = _mm_shuffle_ps(yI, yI, _MM_SHUFFLE(3, 3, 3, 3));
+            z1_Q = _mm_shuffle_ps(yQ, yQ, _MM_SHUFFLE(3, 3, 3, 3));
+        }
+
+        __m128 magsq = _mm_min_ps(_mm_add_ps(_mm_mul_ps(fI, fI), _mm_mul_ps(fQ, fQ)), one);
+        __m128 mag = _mm_sqrt_ps(magsq);
+        sum_power = _mm_add_ps(sum_power, magsq);
+        sum_level = _mm_add_ps(sum_level, mag);
+
+        // no unsigned 32 -> 16 bit pack before SSE4.1, bias into signed range and back
+        __m128i out = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(mag, full_scale), round));
+        out = _mm_sub_epi32(out, _mm_set1_epi32(32768));
+        out = _mm_xor_si128(_mm_packs_epi32(out, out), _mm_set1_epi16((short) 0x8000));
+        _mm_storel_epi64((__m128i *) & mag_data[i], out);
+    }
+
+    float level[4], power[4];
+    double total_level = 0, total_power = 0;
+    _mm_storeu_ps(level, sum_level);
+    _mm_storeu_ps(power, sum_power);
+    for (int k = 0; k < 4; ++k) {
+        total_level += level[k];
+        total_power += power[k];
+    }
+
+    convert_finish(iq_data, mag_data, i, nsamples, state, format, dc,
+            _mm_cvtss_f32(z1_I), _mm_cvtss_f32(z1_Q),
+            total_level, total_power, out_mean_level, out_mean_power);
+}
+
+static bool convert_have_avx2(void) {
+    return __builtin_cpu_supports("avx2");
+}
+
+static bool convert_have_sse2(void) {
+    return __builtin_cpu_supports("sse2");
+}
+
+#define CONVERT_SIMD(isa, name, format, dc) \
+    __attribute__ ((target(#isa))) \
+    static void convert_##name##_##isa(void *iq_data, uint16_t *mag_data, unsigned nsamples, \
+            struct converter_state *state, double *out_mean_level, double *out_mean_power) { \
+        convert_##isa(iq_data, mag_data, nsamples, state, out_mean_level, out_mean_power, format, dc); \
+    }
+
+CONVERT_SIMD(avx2, uc8_nodc, INPUT_UC8, false)
+CONVERT_SIMD(avx2, uc8_generic, INPUT_UC8, true)
+CONVERT_SIMD(avx2, sc16_nodc, INPUT_SC16, false)
+CONVERT_SIMD(avx2, sc16_generic, INPUT_SC16, true)
+CONVERT_SIMD(avx2, sc16q11_nodc, INPUT_SC16Q11, false)
+CONVERT_SIMD(avx2, sc16q11_generic, INPUT_SC16Q11, true)
+
+CONVERT_SIMD(sse2, uc8_nodc, INPUT_UC8, false)
+CONVERT_SIMD(sse2, uc8_generic, INPUT_UC8, true)
+CONVERT_SIMD(sse2, sc16_nodc, INPUT_SC16, false)
+CONVERT_SIMD(sse2, sc16_generic, INPUT_SC16, true)
+CONVERT_SIMD(sse2, sc16q11_nodc, INPUT_SC16Q11, false)
+CONVERT_SIMD(sse2, sc16q11_generic, INPUT_SC16Q11, true)
+
+#undef CONVERT_SIMD
+
+#endif /* x86 */
+
+// AArch64 only: ARMv7 NEON has no vector divide or square root
+#if defined(__ARM_NEON) && defined(__aarch64__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define CONVERT_NEON
+
+static inline __attribute__ ((always_inline)) void convert_neon(void *iq_data,
+        uint16_t *mag_data,
+        unsigned nsamples,
+        struct converter_state *state,
+        double *out_mean_level,
+        double *out_mean_power,
+        const input_format_t format,
+        const bool dc) {
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    const float32x4_t full_scale = vdupq_n_f32(65535.0f);
+    const float32x4_t round = vdupq_n_f32(0.5f);
+    const float32x4_t uc8_offset = vdupq_n_f32(127.5f);
+    const float32x4_t sc16_scale = vdupq_n_f32(format == INPUT_SC16 ? 1.0f / 32768.0f : 1.0f / 2048.0f);
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    float32x4_t sum_level = zero;
+    float32x4_t sum_power = zero;
+    float32x4_t z1_I = vdupq_n_f32(state->z1_I);
+    float32x4_t z1_Q = vdupq_n_f32(state->z1_Q);
+    float32x4_t dc_a = zero, dc_b1 = zero, dc_b2 = zero, dc_carry = zero;
+    unsigned i;
+
+    if (dc) {
+        float b = state->dc_b, b2 = b * b;
+        float carry[4] = { b, b2, b2 * b, b2 * b2 };
+
+        dc_a = vdupq_n_f32(state->dc_a);
+        dc_b1 = vdupq_n_f32(b);
+        dc_b2 = vdupq_n_f32(b2);
+        dc_carry = vld1q_f32(carry);
+    }
+
+    for (i = 0; i + 4 <= nsamples; i += 4) {
+        float32x4_t fI, fQ;
+
+        if (format == INPUT_UC8) {
+            // widen the 4 IQ byte pairs to one 32 bit lane per sample, I in the low half
+            uint32x4_t iq = vreinterpretq_u32_u16(vmovl_u8(vld1_u8((const uint8_t *) iq_data + 2 * i)));
+            fI = vcvtq_f32_u32(vandq_u32(iq, vdupq_n_u32(0xFFFF)));
+            fQ = vcvtq_f32_u32(vshrq_n_u32(iq, 16));
+            fI = vdivq_f32(vsubq_f32(fI, uc8_offset), uc8_offset);
+            fQ = vdivq_f32(vsubq_f32(fQ, uc8_offset), uc8_offset);
+        } else {
+            // one IQ pair per 32 bit lane, sign extend each half
+            int32x4_t iq = vreinterpretq_s32_u16(vld1q_u16((const uint16_t *) iq_data + 2 * i));
+            fI = vcvtq_f32_s32(vshrq_n_s32(vshlq_n_s32(iq, 16), 16));
+            fQ = vcvtq_f32_s32(vshrq_n_s32(iq, 16));
+            fI = vmulq_f32(fI, sc16_scale);
+            fQ = vmulq_f32(fQ, sc16_scale);
+        }
+
+        if (dc) {
+            // vext with a zero vector shifts up by whole lanes
+            float32x4_t yI = vmulq_f32(fI, dc_a);
+            float32x4_t yQ = vmulq_f32(fQ, dc_a);
+            yI = vaddq_f32(yI, vmulq_f32(dc_b1, vextq_f32(zero, yI, 3)));
+            yQ = vaddq_f32(yQ, vmulq_f32(dc_b1, vextq_f32(zero, yQ, 3)));
+            yI = vaddq_f32(yI, vmulq_f32(dc_b2, vextq_f32(zero, yI, 2)));
+            yQ = vaddq_f32(yQ, vmulq_f32(dc_b2, vextq_f32(zero, yQ, 2)));
+            yI = vaddq_f32(yI, vmulq_f32(dc_carry, z1_I));
+            yQ = vaddq_f32(yQ, vmulq_f32(dc_carry, z1_Q));
+            fI = vsubq_f32(fI, yI);
+            fQ = vsubq_f32(fQ, yQ);
+            z1_I = vdupq_laneq_f32(yI, 3);
+            z1_Q = vdupq_laneq_f32(yQ, 3);
+        }
+
+        float32x4_t magsq = vminq_f32(vaddq_f32(vmulq_f32(fI, fI), vmulq_f32(fQ, fQ)), one);
+        float32x4_t mag = vsqrtq_f32(magsq);
+        sum_power = vaddq_f32(sum_power, magsq);
+        sum_level = vaddq_f32(sum_level, mag);
+
+        uint32x4_t out = vcvtq_u32_f32(vaddq_f32(vmulq_f32(mag, full_scale), round));
+        vst1_u16(&mag_data[i], vmovn_u32(out));
+    }
+
+    float level[4], power[4];
+    double total_level = 0, total_power = 0;
+    vst1q_f32(level, sum_level);
+    vst1q_f32(power, sum_power);
+    for (int k = 0; k < 4; ++k) {
+        total_level += level[k];
+        total_power += power[k];
+    }
+
+    convert_finish(iq_data, mag_data, i, nsamples, state, format, dc,
+            vgetq_lane_f32(z1_I, 0), vgetq_lane_f32(z1_Q, 0),
+            total_level, total_power, out_mean_level, out_mean_power);
+}
+
+#define CONVERT_SIMD(isa, name, format, dc) \
+    static void convert_##name##_##isa(void *iq_data, uint16_t *mag_data, unsigned nsamples, \
+            struct converter_state *state, double *out_mean_level, double *out_mean_power) { \
+        convert_##isa(iq_data, mag_data, nsamples, state, out_mean_level, out_mean_power, format, dc); \
+    }
+
+CONVERT_SIMD(neon, uc8_nodc, INPUT_UC8, false)
+CONVERT_SIMD(neon, uc8_generic, INPUT_UC8, true)
+CONVERT_SIMD(neon, sc16_nodc, INPUT_SC16, false)
+CONVERT_SIMD(neon, sc16_generic, INPUT_SC16, true)
+CONVERT_SIMD(neon, sc16q11_nodc, INPUT_SC16Q11, false)
+CONVERT_SIMD(neon, sc16q11_generic, INPUT_SC16Q11, true)
+
+#undef CONVERT_SIMD
+
+#endif /* __ARM_NEON && __aarch64__ */
+
+static bool convert_always(void) {
+    return true;
+}
+
 static struct {
     input_format_t format;
     int can_filter_dc;
     iq_convert_fn fn;
     const char *description;
     bool(*init)();
+    bool(*supported)(void);
+    // exact result for every sample, the reference convert_benchmark compares
+    // against: the float paths, and the UC8 table which holds every possible
+    // sample (the SC16Q11 table drops low bits)
+    bool exact;
 } converters_table[] = {
     // In order of preference
-    { INPUT_UC8, 0, convert_uc8_nodc, "UC8, integer/table path", init_uc8_lookup},
-    { INPUT_UC8, 1, convert_uc8_generic, "UC8, float path", NULL},
-    { INPUT_SC16, 0, convert_sc16_nodc, "SC16, float path, no DC", NULL},
-    { INPUT_SC16, 1, convert_sc16_generic, "SC16, float path", NULL},
+#if defined(__x86_64__) || defined(__i386__)
+    { INPUT_UC8, 0, convert_uc8_nodc_avx2, "UC8, AVX2, no DC", NULL, convert_have_avx2, false},
+#elif defined(CONVERT_NEON)
+    { INPUT_UC8, 0, convert_uc8_nodc_neon, "UC8, NEON, no DC", NULL, convert_always, false},
+#endif
+    // the 128kB table stays in L2 and beats 4-wide SSE2
+    { INPUT_UC8, 0, convert_uc8_nodc, "UC8, integer/table path", init_uc8_lookup, convert_always, true},
+#if defined(__x86_64__) || defined(__i386__)
+    { INPUT_UC8, 0, convert_uc8_nodc_sse2, "UC8, SSE2, no DC", NULL, convert_have_sse2, false},
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+    { INPUT_UC8, 1, convert_uc8_generic_avx2, "UC8, AVX2", NULL, convert_have_avx2, false},
+    { INPUT_UC8, 1, convert_uc8_generic_sse2, "UC8, SSE2", NULL, convert_have_sse2, false},
+#elif defined(CONVERT_NEON)
+    { INPUT_UC8, 1, convert_uc8_generic_neon, "UC8, NEON", NULL, convert_always, false},
+#endif
+    { INPUT_UC8, 1, convert_uc8_generic, "UC8, float path", NULL, convert_always, true},
+#if defined(__x86_64__) || defined(__i386__)
+    { INPUT_SC16, 0, convert_sc16_nodc_avx2, "SC16, AVX2, no DC", NULL, convert_have_avx2, false},
+    { INPUT_SC16, 0, convert_sc16_nodc_sse2, "SC16, SSE2, no DC", NULL, convert_have_sse2, false},
+#elif defined(CONVERT_NEON)
+    { INPUT_SC16, 0, convert_sc16_nodc_neon, "SC16, NEON, no DC", NULL, convert_always, false},
+#endif
+    { INPUT_SC16, 0, convert_sc16_nodc, "SC16, float path, no DC", NULL, convert_always, true},
+#if defined(__x86_64__) || defined(__i386__)
+    { INPUT_SC16, 1, convert_sc16_generic_avx2, "SC16, AVX2", NULL, convert_have_avx2, false},
+    { INPUT_SC16, 1, convert_sc16_generic_sse2, "SC16, SSE2", NULL, convert_have_sse2, false},
+#elif defined(CONVERT_NEON)
+    { INPUT_SC16, 1, convert_sc16_generic_neon, "SC16, NEON", NULL, convert_always, false},
+#endif
+    { INPUT_SC16, 1, convert_sc16_generic, "SC16, float path", NULL, convert_always, true},
+#if defined(__x86_64__) || defined(__i386__)
+    { INPUT_SC16Q11, 0, convert_sc16q11_nodc_avx2, "SC16Q11, AVX2, no DC", NULL, convert_have_avx2, false},
+    { INPUT_SC16Q11, 0, convert_sc16q11_nodc_sse2, "SC16Q11, SSE2, no DC", NULL, convert_have_sse2, false},
+#elif defined(CONVERT_NEON)
+    { INPUT_SC16Q11, 0, convert_sc16q11_nodc_neon, "SC16Q11, NEON, no DC", NULL, convert_always, false},
+#endif
 #if defined(SC16Q11_TABLE_BITS)
-    { INPUT_SC16Q11, 0, convert_sc16q11_table, "SC16Q11, integer/table path", init_sc16q11_lookup},
+    { INPUT_SC16Q11, 0, convert_sc16q11_table, "SC16Q11, integer/table path", init_sc16q11_lookup, convert_always, false},
+    { INPUT_SC16Q11, 0, convert_sc16q11_nodc, "SC16Q11, float path, no DC", NULL, convert_always, true},
 #else
-    { INPUT_SC16Q11, 0, convert_sc16q11_nodc, "SC16Q11, float path, no DC", NULL},
+    { INPUT_SC16Q11, 0, convert_sc16q11_nodc, "SC16Q11, float path, no DC", NULL, convert_always, true},
+    { INPUT_SC16Q11, 0, convert_sc16q11_table, "SC16Q11, integer/table path", init_sc16q11_lookup, convert_always, false},
 #endif
-    { INPUT_SC16Q11, 1, convert_sc16q11_generic, "SC16Q11, float path", NULL},
-    { 0, 0, NULL, NULL, NULL}
+#if defined(__x86_64__) || defined(__i386__)
+    { INPUT_SC16Q11, 1, convert_sc16q11_generic_avx2, "SC16Q11, AVX2", NULL, convert_have_avx2, false},
+    { INPUT_SC16Q11, 1, convert_sc16q11_generic_sse2, "SC16Q11, SSE2", NULL, convert_have_sse2, false},
+#elif defined(CONVERT_NEON)
+    { INPUT_SC16Q11, 1, convert_sc16q11_generic_neon, "SC16Q11, NEON", NULL, convert_always, false},
+#endif
+    { INPUT_SC16Q11, 1, convert_sc16q11_generic, "SC16Q11, float path", NULL, convert_always, true},
+    { 0, 0, NULL, NULL, NULL, NULL, false}
 };
 
-iq_convert_fn init_converter(input_format_t format,
+static iq_convert_fn setup_converter(int i,
         double sample_rate,
         int filter_dc,
         struct converter_state **out_state) {
-    int i;
-
-    for (i = 0; converters_table[i].fn; ++i) {
-        if (converters_table[i].format != format)
-            continue;
-        if (filter_dc && !converters_table[i].can_filter_dc)
-            continue;
-        break;
-    }
-
-    if (!converters_table[i].fn) {
-        fprintf(stderr, "no suitable converter for format=%d dc=%d\n",
-                format, filter_dc);
-        return NULL;
-    }
-
     if (converters_table[i].init) {
         if (!converters_table[i].init())
             return NULL;
@@ -490,10 +970,217 @@ iq_convert_fn init_converter(input_format_t format,
     return converters_table[i].fn;
 }
 
+static bool converter_usable(int i, input_format_t format, int filter_dc) {
+    if (converters_table[i].format != format)
+        return false;
+    if (filter_dc && !converters_table[i].can_filter_dc)
+        return false;
+    return converters_table[i].supported();
+}
+
+static void free_sc16q11_lookup(void) {
+    hot_free(sc16q11_lookup, sc16q11_lookup_size);
+    sc16q11_lookup = NULL;
+}
+
+//
+// Converter autotuning
+//
+// Which converter is fastest depends on the CPU and its caches more than on
+// the instruction set alone; the best SC16Q11 table size differs between an
+// i7, a Pi3 and a Pi1 (see convert_benchmark.c). With --iq-autotune every
+// usable converter, and the table converter at every table size, is timed
+// on synthetic samples at startup and the fastest one is used.
+//
+
+#define AUTOTUNE_SAMPLES 65536 // samples per call, half a magnitude buffer
+#define AUTOTUNE_CALLS 4 // calls per timed round
+#define AUTOTUNE_ROUNDS 3 // best of
+
+// Uniform random IQ over the whole input range, like convert_benchmark
+static void *autotune_samples(input_format_t format) {
+    uint32_t seed = 1;
+    void *data = malloc((size_t) AUTOTUNE_SAMPLES * 4);
+
+    if (!data)
+        return NULL;
+
+    for (unsigned i = 0; i < AUTOTUNE_SAMPLES * 2; ++i) {
+        seed = seed * 1103515245 + 12345;
+        uint16_t r = seed >> 16;
+
+        switch (format) {
+            case INPUT_UC8:
+                ((uint8_t *) data)[i] = r >> 8;
+                break;
+            case INPUT_SC16:
+                ((uint16_t *) data)[i] = htole16(r);
+                break;
+            case INPUT_SC16Q11:
+                ((uint16_t *) data)[i] = htole16((uint16_t) ((int16_t) r >> 4));
+                break;
+        }
+    }
+
+    return data;
+}
+
+// Samples per second of one converter, or 0 if it can't be set up
+static double autotune_rate(int i, double sample_rate, int filter_dc, void *in, uint16_t *out) {
+    struct converter_state *state;
+    iq_convert_fn fn = setup_converter(i, sample_rate, filter_dc, &state);
+    int64_t best_ns = INT64_MAX;
+
+    if (!fn)
+        return 0;
+
+    // the first call faults in the table and output pages
+    fn(in, out, AUTOTUNE_SAMPLES, state, NULL, NULL);
+
+    for (int round = 0; round < AUTOTUNE_ROUNDS; ++round) {
+        struct timespec start, elapsed = {0, 0};
+
+        start_cpu_timing(&start);
+        for (int call = 0; call < AUTOTUNE_CALLS; ++call)
+            fn(in, out, AUTOTUNE_SAMPLES, state, NULL, NULL);
+        end_cpu_timing(&start, &elapsed);
+
+        int64_t ns = (int64_t) elapsed.tv_sec * 1000000000 + elapsed.tv_nsec;
+        if (ns < best_ns)
+            best_ns = ns;
+    }
+
+    free(state);
+    return 1e9 * AUTOTUNE_SAMPLES * AUTOTUNE_CALLS / max(best_ns, 1);
+}
+
+// Index of the fastest usable converter, -1 if there is none; also sets
+// sc16q11_table_bits to the fastest table size
+static int autotune_converter(input_format_t format, double sample_rate, int filter_dc, double *out_rate) {
+    void *in = autotune_samples(format);
+    uint16_t *out = malloc(AUTOTUNE_SAMPLES * sizeof (uint16_t));
+    int best = -1, best_bits = sc16q11_table_bits;
+    double best_rate = 0;
+
+    if (!in || !out) {
+        fprintf(stderr, "converter: can't allocate autotune buffers\n");
+        free(in);
+        free(out);
+        return -1;
+    }
+
+    for (int i = 0; converters_table[i].fn; ++i) {
+        if (!converter_usable(i, format, filter_dc))
+            continue;
+
+        bool table = (converters_table[i].fn == convert_sc16q11_table);
+        int min_bits = table ? SC16Q11_MIN_TABLE_BITS : sc16q11_table_bits;
+        int max_bits = table ? SC16Q11_MAX_TABLE_BITS : sc16q11_table_bits;
+
+        for (int bits = min_bits; bits <= max_bits; ++bits) {
+            if (table) {
+                free_sc16q11_lookup();
+                sc16q11_table_bits = bits;
+            }
+
+            double rate = autotune_rate(i, sample_rate, filter_dc, in, out);
+            if (table)
+                fprintf(stderr, "converter: %s, %d bits: %.2fM samples/second\n", converters_table[i].description, bits, rate / 1e6);
+            else
+                fprintf(stderr, "converter: %s: %.2fM samples/second\n", converters_table[i].description, rate / 1e6);
+
+            if (rate > best_rate) {
+                best = i;
+                best_rate = rate;
+                if (table)
+                    best_bits = bits;
+            }
+        }
+    }
+
+    if (sc16q11_table_bits != best_bits) {
+        free_sc16q11_lookup();
+        sc16q11_table_bits = best_bits;
+    }
+
+    free(in);
+    free(out);
+    *out_rate = best_rate;
+    return best;
+}
+
+iq_convert_fn init_converter(input_format_t format,
+        double sample_rate,
+        int filter_dc,
+        struct converter_state **out_state) {
+    double rate = 0;
+    int i;
+
+    if (Modes.converter_autotune) {
+        i = autotune_converter(format, sample_rate, filter_dc, &rate);
+    } else {
+        for (i = 0; converters_table[i].fn; ++i) {
+            if (converter_usable(i, format, filter_dc))
+                break;
+        }
+        if (!converters_table[i].fn)
+            i = -1;
+    }
+
+    if (i < 0) {
+        fprintf(stderr, "no suitable converter for format=%d dc=%d\n",
+                format, filter_dc);
+        return NULL;
+    }
+
+    if (converters_table[i].fn == convert_sc16q11_table)
+        snprintf(Modes.converter_name, sizeof (Modes.converter_name), "%s, %d bits", converters_table[i].description, sc16q11_table_bits);
+    else
+        snprintf(Modes.converter_name, sizeof (Modes.converter_name), "%s", converters_table[i].description);
+    Modes.converter_rate = rate;
+
+    if (Modes.converter_autotune)
+        fprintf(stderr, "converter: using %s (%.2fM samples/second)\n", Modes.converter_name, rate / 1e6);
+    else
+        fprintf(stderr, "converter: using %s\n", Modes.converter_name);
+
+    return setup_converter(i, sample_rate, filter_dc, out_state);
+}
+
+bool converter_variant(int index,
+        input_format_t *format,
+        int *filter_dc,
+        const char **description,
+        bool *supported) {
+    for (int i = 0; i <= index; ++i) {
+        if (!converters_table[i].fn)
+            return false;
+    }
+
+    *format = converters_table[index].format;
+    *filter_dc = converters_table[index].can_filter_dc;
+    *description = converters_table[index].description;
+    *supported = converters_table[index].supported();
+    return true;
+}
+
+int converter_reference_variant(input_format_t format, int filter_dc) {
+    for (int i = 0; converters_table[i].fn; ++i) {
+        if (converters_table[i].exact && converters_table[i].format == format && converters_table[i].can_filter_dc == filter_dc)
+            return i;
+    }
+    return -1;
+}
+
+iq_convert_fn init_converter_variant(int index,
+        double sample_rate,
+        struct converter_state **out_state) {
+    return setup_converter(index, sample_rate, converters_table[index].can_filter_dc, out_state);
+}
+
 void cleanup_converter(struct converter_state *state) {
     free(state);
-    free(uc8_lookup);
-#if defined(SC16Q11_TABLE_BITS)
-    free(sc16q11_lookup);
-#endif
+    hot_free(uc8_lookup, sizeof (uint16_t) * 256 * 256);
+    uc8_lookup = NULL;
+    free_sc16q11_lookup();
 }
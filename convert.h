@@ -42,6 +42,24 @@ iq_convert_fn init_converter(input_format_t format,
         int filter_dc,
         struct converter_state **out_state);
 
+// Enumerate the converter table, including variants that init_converter()
+// would not pick, for benchmarking. Returns false past the last entry.
+bool converter_variant(int index,
+        input_format_t *format,
+        int *filter_dc,
+        const char **description,
+        bool *supported);
+
+// Index of the converter table entry that gives the exact result for a
+// format and DC setting, to compare the other variants against; -1 if none
+int converter_reference_variant(input_format_t format, int filter_dc);
+
+// Initialize a specific entry of the converter table, DC filtering
+// enabled if the converter supports it
+iq_convert_fn init_converter_variant(int index,
+        double sample_rate,
+        struct converter_state **out_state);
+
 void cleanup_converter(struct converter_state *state);
 
 #endif
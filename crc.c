@@ -32,7 +32,7 @@ static struct errorinfo NO_ERRORS;
 
 // CRC values for all single-byte messages;
 // used to speed up CRC calculation.
-static uint32_t crc_table[256];
+uint32_t modesChecksumTable[256];
 
 // Syndrome values for all single-bit errors;
 // used to speed up construction of error-
@@ -53,7 +53,7 @@ static void initLookupTables() {
                 c = (c << 1);
         }
 
-        crc_table[i] = c & 0x00ffffff;
+        modesChecksumTable[i] = c & 0x00ffffff;
     }
 
     memset(msg, 0, sizeof (msg));
@@ -72,10 +72,8 @@ uint32_t modesChecksum(uint8_t *message, int bits) {
     assert(bits % 8 == 0);
     assert(n >= 3);
 
-    for (i = 0; i < n - 3; ++i) {
-        rem = (rem << 8) ^ crc_table[message[i] ^ ((rem & 0xff0000) >> 16)];
-        rem = rem & 0xffffff;
-    }
+    for (i = 0; i < n - 3; ++i)
+        rem = modesChecksumUpdate(rem, message[i]);
 
     rem = rem ^ (message[n - 3] << 16) ^ (message[n - 2] << 8) ^ (message[n - 1]);
     return rem;
@@ -304,6 +302,18 @@ static struct errorinfo *prepareErrorTable(int bits, int max_correct, int max_de
 #endif
     }
 
+#ifndef CRCDEBUG
+    // every message with a bad CRC is looked up here, keep the final table in hot memory
+    if (usedsize > 0) {
+        struct errorinfo *hot = hot_alloc(usedsize * sizeof (struct errorinfo), bits == MODES_SHORT_MSG_BITS ? "CRC error table (short)" : "CRC error table (long)");
+        if (!hot)
+            exit(1);
+        memcpy(hot, table, usedsize * sizeof (struct errorinfo));
+        free(table);
+        table = hot;
+    }
+#endif
+
     *size_out = usedsize;
 
 #ifdef CRCDEBUG
@@ -428,12 +438,21 @@ void modesChecksumFix(uint8_t *msg, struct errorinfo *info) {
  * Clean CRC LUTs on exit.
  *
  */
-void crcCleanupTables(void) {
-    if (bitErrorTable_short != NULL)
-        free(bitErrorTable_short);
+static void freeErrorTable(struct errorinfo *table, int size) {
+    if (table == NULL)
+        return;
+#ifdef CRCDEBUG
+    (void) size;
+    free(table);
+#else
+    hot_free(table, size * sizeof (struct errorinfo));
+#endif
+}
 
-    if (bitErrorTable_long != NULL)
-        free(bitErrorTable_long);
+void crcCleanupTables(void) {
+    freeErrorTable(bitErrorTable_short, bitErrorTableSize_short);
+    freeErrorTable(bitErrorTable_long, bitErrorTableSize_long);
+    bitErrorTable_short = bitErrorTable_long = NULL;
 }
 
 #ifdef CRCDEBUG
@@ -36,10 +36,20 @@ struct errorinfo {
     uint16_t padding;
 };
 
+extern uint32_t modesChecksumTable[256];
+
 void modesChecksumInit(int fixBits);
 uint32_t modesChecksum(uint8_t *msg, int bitlen);
 struct errorinfo *modesChecksumDiagnose(uint32_t syndrome, int bitlen);
 void modesChecksumFix(uint8_t *msg, struct errorinfo *info);
 void crcCleanupTables(void);
 
+// Feed one data byte into a running CRC remainder. The syndrome of a
+// message is the remainder over all but the last 3 bytes, xored with
+// those 3 parity bytes (see modesChecksum).
+
+static inline uint32_t modesChecksumUpdate(uint32_t rem, uint8_t byte) {
+    return ((rem << 8) ^ modesChecksumTable[byte ^ ((rem & 0xff0000) >> 16)]) & 0xffffff;
+}
+
 #endif
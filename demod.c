@@ -0,0 +1,336 @@
+// Part of readsb, a Mode-S/ADSB/TIS message decoder.
+//
+// demod.c: Mode S demodulator selection and integer sample rate demodulators.
+//
+// Copyright (c) 2020 Michael Wolf <michael@mictronics.de>
+//
+// This code is based on a detached fork of dump1090-fa.
+//
+// Copyright (c) 2014,2015 Oliver Jowett <oliver@mutability.co.uk>
+//
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// any later version.
+//
+// This file is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "readsb.h"
+
+//
+// Demodulators for sample rates that are an even number of samples per
+// microsecond, i.e. a whole number of samples per symbol.
+//
+// There is no need for the fractional phase handling of the 2.4MHz
+// demodulator here: every symbol covers `half` samples (half = sps / 2)
+// and the bit value is simply which of its two symbols holds more energy.
+// Scanning every sample offset j already tries every alignment the sample
+// rate can resolve (500ns at 2MHz, 167ns at 6MHz, 125ns at 8MHz).
+//
+// demodulate_sps() is written once and instantiated for each rate with a
+// constant `sps`, so the compiler unrolls all the symbol sums and turns
+// the sample offset math into shifts and adds.
+//
+
+static inline __attribute__ ((always_inline)) int32_t symbol_sum(const uint16_t *m, const int half) {
+    int32_t sum = 0;
+    for (int i = 0; i < half; ++i)
+        sum += m[i];
+    return sum;
+}
+
+// Preamble correlation at pa[0], -1 if the preamble shape doesn't match
+//
+// symbol#: 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5
+// ideal:   1 0 1 0 0 0 0 1 0 1 0 0 0 0 0 0 D0
+
+static inline __attribute__ ((always_inline)) int32_t preamble_mag(const uint16_t *pa, const int half) {
+    int32_t s0 = symbol_sum(pa, half);
+    int32_t s1 = symbol_sum(pa + 1 * half, half);
+    int32_t s2 = symbol_sum(pa + 2 * half, half);
+
+    if (!(s0 > s1 && s2 > s1))
+        return -1;
+
+    int32_t s7 = symbol_sum(pa + 7 * half, half);
+    int32_t s8 = symbol_sum(pa + 8 * half, half);
+    int32_t s9 = symbol_sum(pa + 9 * half, half);
+
+    if (!(s7 > s8 && s9 > s8))
+        return -1;
+
+    // the 4 high symbols minus the 2 low symbols between each pair
+    return s0 + s2 + s7 + s9 - s1 - s8;
+}
+
+// 5 quiet symbols of the preamble, away from the pulses
+
+static inline __attribute__ ((always_inline)) int32_t preamble_noise(const uint16_t *pa, const int half) {
+    return symbol_sum(pa + 4 * half, half) + symbol_sum(pa + 5 * half, half) +
+            symbol_sum(pa + 11 * half, half) + symbol_sum(pa + 12 * half, half) +
+            symbol_sum(pa + 13 * half, half);
+}
+
+static inline __attribute__ ((always_inline)) uint8_t slice_byte_sps(const uint16_t *p, const int half) {
+    uint8_t theByte = 0;
+    for (int bit = 0; bit < 8; ++bit, p += 2 * half)
+        theByte = (theByte << 1) | (symbol_sum(p, half) > symbol_sum(p + half, half));
+    return theByte;
+}
+
+static inline __attribute__ ((always_inline)) void demodulate_sps(struct mag_buf *mag, const int sps) {
+    static struct modesMessage zeroMessage;
+    struct modesMessage mm;
+    const int half = sps / 2;
+    unsigned char msg[MODES_LONG_MSG_BYTES];
+    uint16_t *m = mag->data;
+    uint32_t mlen = mag->validLength - mag->overlap;
+    uint32_t preamble_threshold;
+    uint64_t sum_scaled_signal_power = 0;
+
+    // advance ifile artificial clock even if we don't receive anything
+    if (Modes.sdr_type == SDR_IFILE) {
+        Modes.ifile_now = mag->sysTimestamp;
+    }
+
+    // reduce number of preamble detections if we recently dropped samples
+    if (Modes.stats_15min.samples_dropped) {
+        preamble_threshold = max(PREAMBLE_THRESHOLD_PIZERO, Modes.preambleThreshold);
+    } else {
+        preamble_threshold = Modes.preambleThreshold;
+    }
+
+    for (uint32_t j = 0; j < mlen; ++j) {
+        uint16_t *pa = &m[j];
+        int32_t pa_mag, ref_level;
+        int bytelen, msglen, score;
+
+        if ((pa_mag = preamble_mag(pa, half)) < 0)
+            continue;
+
+        ref_level = (preamble_noise(pa, half) * preamble_threshold) >> 5;
+        if (pa_mag < ref_level)
+            continue;
+
+        // only use the best aligned offset of a preamble
+        if ((j > 0 && preamble_mag(pa - 1, half) > pa_mag) || preamble_mag(pa + 1, half) >= pa_mag)
+            continue;
+
+        Modes.stats_current.demod_preambles++;
+
+        // data starts 8us after the preamble
+        const uint16_t *pPtr = pa + 8 * sps;
+
+        msg[0] = slice_byte_sps(pPtr, half);
+        switch (msg[0] >> 3) {
+            case 0: case 4: case 5: case 11:
+                bytelen = MODES_SHORT_MSG_BYTES;
+                break;
+
+            case 16: case 17: case 18: case 20: case 21: case 24:
+                bytelen = MODES_LONG_MSG_BYTES;
+                break;
+
+            default:
+                Modes.stats_current.demod_rejected_bad++;
+                continue;
+        }
+
+        for (int i = 1; i < bytelen; ++i)
+            msg[i] = slice_byte_sps(pPtr + i * 8 * sps, half);
+
+        // Score the mode S message and see if it's any good.
+        score = scoreModesMessage(msg, bytelen * 8);
+        if (score < 0) {
+            if (score == -1)
+                Modes.stats_current.demod_rejected_unknown_icao++;
+            else
+                Modes.stats_current.demod_rejected_bad++;
+            continue; // nope.
+        }
+
+        msglen = modesMessageLenByType(msg[0] >> 3);
+
+        // Set initial mm structure details
+        mm = zeroMessage;
+
+        // For consistency with how the Beast / Radarcape does it,
+        // we report the timestamp at the end of bit 56 (even if
+        // the frame is a 112-bit frame)
+        mm.timestampMsg = mag->sampleTimestamp + (uint64_t) j * 12 / sps + (8 + 56) * 12;
+
+        // compute message receive time as block-start-time + difference in the 12MHz clock
+        mm.sysTimestampMsg = mag->sysTimestamp + receiveclock_ms_elapsed(mag->sampleTimestamp, mm.timestampMsg);
+
+        // advance ifile artifical clock for every message received
+        if (Modes.sdr_type == SDR_IFILE) {
+            Modes.ifile_now = mm.sysTimestampMsg;
+        }
+
+        mm.score = score;
+
+        // Decode the received message
+        {
+            int result = decodeModesMessage(&mm, msg);
+            if (result < 0) {
+                if (result == -1)
+                    Modes.stats_current.demod_rejected_unknown_icao++;
+                else
+                    Modes.stats_current.demod_rejected_bad++;
+                continue;
+            } else {
+                Modes.stats_current.demod_accepted[mm.correctedbits]++;
+            }
+        }
+
+        // measure signal power
+        {
+            double signal_power;
+            uint64_t scaled_signal_power = 0;
+            int signal_len = msglen * sps;
+
+            for (int k = 0; k < signal_len; ++k) {
+                uint32_t mag = pPtr[k];
+                scaled_signal_power += mag * mag;
+            }
+
+            signal_power = scaled_signal_power / 65535.0 / 65535.0;
+            mm.signalLevel = signal_power / signal_len;
+            Modes.stats_current.signal_power_sum += signal_power;
+            Modes.stats_current.signal_power_count += signal_len;
+            sum_scaled_signal_power += scaled_signal_power;
+
+            if (mm.signalLevel > Modes.stats_current.peak_signal_power)
+                Modes.stats_current.peak_signal_power = mm.signalLevel;
+            if (mm.signalLevel > 0.50119)
+                Modes.stats_current.strong_signal_count++; // signal power above -3dBFS
+        }
+
+        // Skip over the message, up to 8 bits before its end
+        // (see demod_2400.c)
+        j += msglen * sps;
+
+        // Pass data to the next layer
+        useModesMessage(&mm);
+    }
+
+    /* update noise power */
+    {
+        double sum_signal_power = sum_scaled_signal_power / 65535.0 / 65535.0;
+        Modes.stats_current.noise_power_sum += (mag->mean_power * mlen - sum_signal_power);
+        Modes.stats_current.noise_power_count += mlen;
+    }
+}
+
+#define DEMODULATE_SPS(rate, sps) \
+    static void demodulate##rate(struct mag_buf *mag) { \
+        demodulate_sps(mag, sps); \
+    }
+
+DEMODULATE_SPS(2000, 2)
+DEMODULATE_SPS(6000, 6)
+DEMODULATE_SPS(8000, 8)
+
+static void noDemodInit(void) {
+}
+
+static void noDemodCleanup(void) {
+}
+
+//
+// Supported sample rates
+//
+
+static struct {
+    const char *name; // --sample-rate argument, in MHz
+    double sample_rate;
+    void (*init)(void);
+    void (*demodulate)(struct mag_buf *mag);
+    void (*cleanup)(void);
+    bool modeac; // Mode A/C supported
+    bool threads; // --demod-threads supported
+    void (*submit)(struct mag_buf *mag); // --batch, NULL if not supported
+    struct mag_buf *(*complete)(void);
+} demod_table[] = {
+    { "2.0", 2000000.0, noDemodInit, demodulate2000, noDemodCleanup, false, false, NULL, NULL },
+    { "2.4", 2400000.0, demodulate2400Init, demodulate2400, demodulate2400Cleanup, true, true, demodulate2400Submit, demodulate2400Complete },
+    { "6.0", 6000000.0, noDemodInit, demodulate6000, noDemodCleanup, false, false, NULL, NULL },
+    { "8.0", 8000000.0, noDemodInit, demodulate8000, noDemodCleanup, false, false, NULL, NULL },
+    { NULL, 0, NULL, NULL, NULL, false, false, NULL, NULL } /* must come last */
+};
+
+static int demod_current = -1;
+
+static int demodLookup(double sample_rate) {
+    for (int i = 0; demod_table[i].name; ++i) {
+        if (fabs(demod_table[i].sample_rate - sample_rate) < 1.0)
+            return i;
+    }
+    return -1;
+}
+
+bool demodParseSampleRate(const char *arg) {
+    int i = demodLookup(strtod(arg, NULL) * 1e6);
+
+    if (i < 0) {
+        fprintf(stderr, "Sample rate '%s' not supported; supported sample rates (MHz) are:\n", arg);
+        for (i = 0; demod_table[i].name; ++i) {
+            fprintf(stderr, "  %s\n", demod_table[i].name);
+        }
+        return false;
+    }
+
+    Modes.sample_rate = demod_table[i].sample_rate;
+    return true;
+}
+
+void demodInit(void) {
+    demod_current = demodLookup(Modes.sample_rate);
+    if (demod_current < 0) {
+        fprintf(stderr, "demod: no demodulator for a sample rate of %.0f Hz\n", Modes.sample_rate);
+        exit(1);
+    }
+
+    if (Modes.mode_ac && !demod_table[demod_current].modeac)
+        fprintf(stderr, "demod: Mode A/C is not supported at %sMHz, only Mode S will be decoded\n", demod_table[demod_current].name);
+    if (Modes.demod_threads > 1 && !demod_table[demod_current].threads)
+        fprintf(stderr, "demod: --demod-threads is not supported at %sMHz, using 1 thread\n", demod_table[demod_current].name);
+    if (Modes.demod_batch > 1 && !demod_table[demod_current].submit) {
+        fprintf(stderr, "demod: --batch is not supported at %sMHz\n", demod_table[demod_current].name);
+        Modes.demod_batch = 0;
+    }
+    if (Modes.demod_batch > 1 && (!sdrContinuous() || Modes.interactive)) {
+        fprintf(stderr, "demod: --batch only works with an input that never drops samples (--ifile) and without --interactive\n");
+        Modes.demod_batch = 0;
+    }
+
+    demod_table[demod_current].init();
+}
+
+void demodulate(struct mag_buf *mag) {
+    demod_table[demod_current].demodulate(mag);
+}
+
+int demodBatch(void) {
+    return Modes.demod_batch > 1 ? Modes.demod_batch : 0;
+}
+
+void demodSubmit(struct mag_buf *mag) {
+    demod_table[demod_current].submit(mag);
+}
+
+struct mag_buf *demodComplete(void) {
+    return demod_table[demod_current].complete();
+}
+
+void demodCleanup(void) {
+    if (demod_current >= 0)
+        demod_table[demod_current].cleanup();
+    demod_current = -1;
+}
@@ -0,0 +1,47 @@
+// Part of readsb, a Mode-S/ADSB/TIS message decoder.
+//
+// demod.h: Mode S demodulator selection prototypes.
+//
+// Copyright (c) 2020 Michael Wolf <michael@mictronics.de>
+//
+// This code is based on a detached fork of dump1090-fa.
+//
+// Copyright (c) 2014,2015 Oliver Jowett <oliver@mutability.co.uk>
+//
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// any later version.
+//
+// This file is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DEMOD_H
+#define DEMOD_H
+
+#include <stdbool.h>
+
+struct mag_buf;
+
+// Parse a --sample-rate argument in MHz, false if no demodulator supports it
+bool demodParseSampleRate(const char *arg);
+// Select the demodulator for Modes.sample_rate and initialize it
+void demodInit(void);
+void demodulate(struct mag_buf *mag);
+
+// Offline batch mode (--batch): the number of mag_bufs that may be in flight,
+// 0 if batch mode is not in use. demodSubmit() starts demodulating a mag_buf,
+// demodComplete() finishes the oldest one, passes its messages on and returns
+// it (NULL if there is none). Messages come out in the same order as with
+// demodulate().
+int demodBatch(void);
+void demodSubmit(struct mag_buf *mag);
+struct mag_buf *demodComplete(void);
+void demodCleanup(void);
+
+#endif
@@ -24,6 +24,12 @@
 #include "readsb.h"
 #include <assert.h>
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 #ifdef MODEAC_DEBUG
 #include <gd.h>
 #endif
@@ -176,247 +182,879 @@ static inline __attribute__ ((always_inline)) uint8_t slice_byte(uint16_t **pPtr
     return theByte;
 }
 
-// score a phase using data from the magnitude buffers
-// if the score is better than the existing one passed via bestscore,
-// update bestmsg, bestscore and bestphase
+// Preamble pre-scan
+//
+// Most sample positions fail the cheap pre-check at the top of the
+// demodulate2400() loop:
+//
+//   pa[1] > pa[7] && pa[12] > pa[14] && pa[12] > pa[15]
+//
+// The pre-scan kernels evaluate that check for PRESCAN_BLOCK consecutive
+// start positions at once and return a bitmap with bit N set if the
+// position m[N] passes. The phase correlations and score_phase() then
+// only run on the candidate positions.
+//
+// A kernel may read up to m[PRESCAN_BLOCK - 1 + 15], the overlap region
+// at the end of each mag_buf is much larger than that.
+//
+// prescan_scalar() is the reference implementation; the SIMD kernels must
+// produce identical bitmaps.
 
-static void score_phase(int try_phase, uint16_t *m, int j, unsigned char **bestmsg, int *bestscore, int *bestphase, unsigned char **msg, unsigned char *msg1, unsigned char *msg2) {
-    Modes.stats_current.demod_preamblePhase[try_phase - 4]++;
-    uint16_t *pPtr;
-    int phase, i, score, bytelen;
+#define PRESCAN_BLOCK 64
 
-    pPtr = &m[j + 19] + (try_phase / 5);
-    phase = try_phase % 5;
+typedef uint64_t(*prescan_fn)(const uint16_t *m);
 
-    (*msg)[0] = slice_byte(&pPtr, &phase);
+static uint64_t prescan_scalar(const uint16_t *m) {
+    uint64_t candidates = 0;
 
-    switch ((*msg)[0] >> 3) {
-        case 0: case 4: case 5: case 11:
-            bytelen = MODES_SHORT_MSG_BYTES;
-            break;
+    for (int i = 0; i < PRESCAN_BLOCK; ++i) {
+        const uint16_t *pa = &m[i];
+        if (pa[1] > pa[7] && pa[12] > pa[14] && pa[12] > pa[15])
+            candidates |= (uint64_t) 1 << i;
+    }
 
-        case 16: case 17: case 18: case 20: case 21: case 24:
-            bytelen = MODES_LONG_MSG_BYTES;
-            break;
+    return candidates;
+}
 
-        default:
-            bytelen = 1; // unknown DF, give up immediately
-            break;
-    }
+#if defined(__x86_64__) || defined(__i386__)
 
-    for (i = 1; i < bytelen; ++i) {
-        (*msg)[i] = slice_byte(&pPtr, &phase);
+// There is no unsigned 16 bit compare on x86, but a > b is the same as
+// saturating(a - b) != 0. The kernels compute the inverse (any of the
+// three differences is zero) and invert the bitmap at the end.
+
+__attribute__ ((target("sse2")))
+static uint64_t prescan_sse2(const uint16_t *m) {
+    const __m128i zero = _mm_setzero_si128();
+    uint64_t rejected = 0;
+
+    for (int i = 0; i < PRESCAN_BLOCK; i += 16) {
+        __m128i fail[2];
+
+        for (int k = 0; k < 2; ++k) {
+            const uint16_t *pa = &m[i + k * 8];
+            __m128i p1 = _mm_loadu_si128((const __m128i *) &pa[1]);
+            __m128i p7 = _mm_loadu_si128((const __m128i *) &pa[7]);
+            __m128i p12 = _mm_loadu_si128((const __m128i *) &pa[12]);
+            __m128i p14 = _mm_loadu_si128((const __m128i *) &pa[14]);
+            __m128i p15 = _mm_loadu_si128((const __m128i *) &pa[15]);
+
+            fail[k] = _mm_or_si128(_mm_cmpeq_epi16(_mm_subs_epu16(p1, p7), zero),
+                    _mm_or_si128(_mm_cmpeq_epi16(_mm_subs_epu16(p12, p14), zero),
+                    _mm_cmpeq_epi16(_mm_subs_epu16(p12, p15), zero)));
+        }
+
+        // 0xffff/0x0000 lanes pack to 0xff/0x00 bytes, one per position
+        rejected |= (uint64_t) (uint16_t) _mm_movemask_epi8(_mm_packs_epi16(fail[0], fail[1])) << i;
     }
 
-    // Score the mode S message and see if it's any good.
-    if (bytelen > 1) {
-        score = scoreModesMessage(*msg, i * 8);
-    } else {
-        score = -2;
+    return ~rejected;
+}
+
+__attribute__ ((target("avx2")))
+static uint64_t prescan_avx2(const uint16_t *m) {
+    const __m256i zero = _mm256_setzero_si256();
+    uint64_t rejected = 0;
+
+    for (int i = 0; i < PRESCAN_BLOCK; i += 32) {
+        __m256i fail[2];
+
+        for (int k = 0; k < 2; ++k) {
+            const uint16_t *pa = &m[i + k * 16];
+            __m256i p1 = _mm256_loadu_si256((const __m256i *) &pa[1]);
+            __m256i p7 = _mm256_loadu_si256((const __m256i *) &pa[7]);
+            __m256i p12 = _mm256_loadu_si256((const __m256i *) &pa[12]);
+            __m256i p14 = _mm256_loadu_si256((const __m256i *) &pa[14]);
+            __m256i p15 = _mm256_loadu_si256((const __m256i *) &pa[15]);
+
+            fail[k] = _mm256_or_si256(_mm256_cmpeq_epi16(_mm256_subs_epu16(p1, p7), zero),
+                    _mm256_or_si256(_mm256_cmpeq_epi16(_mm256_subs_epu16(p12, p14), zero),
+                    _mm256_cmpeq_epi16(_mm256_subs_epu16(p12, p15), zero)));
+        }
+
+        // packs works per 128 bit lane, restore position order before the movemask
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi16(fail[0], fail[1]), 0xD8);
+        rejected |= (uint64_t) (uint32_t) _mm256_movemask_epi8(packed) << i;
     }
 
-    if (score > *bestscore) {
-        // new high score!
-        *bestmsg = *msg;
-        *bestscore = score;
-        *bestphase = try_phase;
+    return ~rejected;
+}
+
+static bool prescan_have_sse2(void) {
+    return __builtin_cpu_supports("sse2");
+}
 
-        // swap to using the other buffer so we don't clobber our demodulated data
-        // (if we find a better result then we'll swap back, but that's OK because
-        // we no longer need this copy if we found a better one)
-        *msg = (*msg == msg1) ? msg2 : msg1;
+static bool prescan_have_avx2(void) {
+    return __builtin_cpu_supports("avx2");
+}
+
+#endif /* x86 */
+
+#if defined(__ARM_NEON)
+
+static uint64_t prescan_neon(const uint16_t *m) {
+    static const uint8_t bit_weights[8] = {1, 2, 4, 8, 16, 32, 64, 128};
+    const uint8x8_t weights = vld1_u8(bit_weights);
+    uint64_t candidates = 0;
+
+    for (int i = 0; i < PRESCAN_BLOCK; i += 8) {
+        const uint16_t *pa = &m[i];
+        uint16x8_t p12 = vld1q_u16(&pa[12]);
+        uint16x8_t pass = vandq_u16(vcgtq_u16(vld1q_u16(&pa[1]), vld1q_u16(&pa[7])),
+                vandq_u16(vcgtq_u16(p12, vld1q_u16(&pa[14])),
+                vcgtq_u16(p12, vld1q_u16(&pa[15]))));
+
+        // narrow to one byte per position and fold the weighted bytes into 8 bits
+        uint8x8_t bits = vand_u8(vmovn_u16(pass), weights);
+        bits = vpadd_u8(bits, bits);
+        bits = vpadd_u8(bits, bits);
+        bits = vpadd_u8(bits, bits);
+        candidates |= (uint64_t) vget_lane_u8(bits, 0) << i;
     }
+
+    return candidates;
 }
 
+#endif /* __ARM_NEON */
+
+static bool prescan_always(void) {
+    return true;
+}
+
+static struct {
+    prescan_fn fn;
+    const char *description;
+    bool(*supported)(void);
+} prescan_table[] = {
+    // In order of preference
+#if defined(__x86_64__) || defined(__i386__)
+    { prescan_avx2, "AVX2", prescan_have_avx2},
+    { prescan_sse2, "SSE2", prescan_have_sse2},
+#endif
+#if defined(__ARM_NEON)
+    { prescan_neon, "NEON", prescan_always},
+#endif
+    { prescan_scalar, "scalar", prescan_always},
+    { NULL, NULL, NULL}
+};
+
+static prescan_fn prescan = prescan_scalar;
+
+// All-phase slicer
 //
-// Given 'mlen' magnitude samples in 'm', sampled at 2.4MHz,
-// try to demodulate some Mode S messages.
+// A preamble usually passes the threshold for several phases, and each of
+// them is then sliced separately although they look at the same samples.
+// When more than one phase needs a byte, the all-phase slicer computes it
+// for all five phases in one vectorized pass instead.
+//
+// One bit is 2.4 samples wide. Measured in units of 1/5 of a sample from
+// the start of the message, bit k sliced with try_phase t (4..8) starts at
+//
+//   u = t + 12 * k, i.e. at sample u / 5 using slice_phase(u % 5)
+//
+// which is what slice_byte() walks through. For a given bit the five
+// try_phases are five consecutive units, covering the 5 samples starting at
+// sample (4 + 12 * k) / 5, so the correlations for all five phases are a
+// 5x5 matrix (one row per try_phase) times those samples. The matrix only
+// depends on r = (4 + 12 * k) % 5, the phase of the first row.
 //
+// The AVX2 kernel keeps one 32 bit lane per try_phase (lanes 5..7 unused)
+// and computes the matrix product with vpmaddwd on sample pairs. vpmaddwd
+// works on signed 16 bit values, so the samples are offset by -32768 (xor
+// 0x8000) and the correlation is compared against -32768 * (sum of the
+// weights) instead of 0. All sums fit easily in 32 bits, so the results
+// are identical to the scalar slice_phaseN() functions.
+//
+// The weights are taken from slice_phaseN() at startup, those remain the
+// single definition of the correlation functions.
 
-void demodulate2400(struct mag_buf *mag) {
-    static struct modesMessage zeroMessage;
+// slice bytes first..last-1 of the message starting at p for all five
+// phases, out[n][try_phase - 4] receives byte n for that phase
+typedef void (*slice_all_fn)(uint16_t *p, int first, int last, uint8_t out[][5]);
+
+#if defined(__x86_64__) || defined(__i386__)
+
+static int32_t slice_pairs[5][3][8]; // [r][sample pair][lane], two int16 weights per lane
+static int32_t slice_bias[5][8]; // [r][lane], -32768 * sum of the weights
+
+// slice one byte for all phases, starting at phase r0 of the first row;
+// x holds the offset samples starting at the first bit
+
+__attribute__ ((target("avx2")))
+static inline __attribute__ ((always_inline)) __m256i slice_byte_avx2(const uint16_t *x, int r0) {
+    __m256i bits = _mm256_setzero_si256();
+
+#pragma GCC unroll 8
+    for (int i = 0; i < 8; ++i) {
+        const uint16_t *s = x + (r0 + 12 * i) / 5;
+        int r = (r0 + 12 * i) % 5;
+        __m256i sum = _mm256_setzero_si256();
+
+#pragma GCC unroll 3
+        for (int q = 0; q < 3; ++q) {
+            uint32_t pair;
+            memcpy(&pair, &s[2 * q], sizeof (pair));
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(_mm256_set1_epi32(pair), _mm256_loadu_si256((const __m256i *) slice_pairs[r][q])));
+        }
+
+        // a true compare yields -1
+        bits = _mm256_sub_epi32(_mm256_slli_epi32(bits, 1), _mm256_cmpgt_epi32(sum, _mm256_loadu_si256((const __m256i *) slice_bias[r])));
+    }
+
+    return bits;
+}
+
+__attribute__ ((target("avx2")))
+static void slice_all_avx2(uint16_t *p, int first, int last, uint8_t out[][5]) {
+    const __m256i offset = _mm256_set1_epi16((short) 0x8000);
+
+    for (int n = first; n < last; ++n) {
+        // one byte covers at most 23 samples
+        const uint16_t *s = p + (4 + 96 * n) / 5;
+        uint16_t x[32];
+        int32_t result[8];
+        __m256i bits;
+
+        _mm256_storeu_si256((__m256i *) & x[0], _mm256_xor_si256(_mm256_loadu_si256((const __m256i *) & s[0]), offset));
+        _mm256_storeu_si256((__m256i *) & x[16], _mm256_xor_si256(_mm256_loadu_si256((const __m256i *) & s[16]), offset));
+
+        switch ((4 + 96 * n) % 5) {
+            case 0: bits = slice_byte_avx2(x, 0); break;
+            case 1: bits = slice_byte_avx2(x, 1); break;
+            case 2: bits = slice_byte_avx2(x, 2); break;
+            case 3: bits = slice_byte_avx2(x, 3); break;
+            default: bits = slice_byte_avx2(x, 4); break;
+        }
+
+        _mm256_storeu_si256((__m256i *) result, bits);
+        for (int lane = 0; lane < 5; ++lane)
+            out[n][lane] = (uint8_t) result[lane];
+    }
+}
+
+static bool slice_all_init(void) {
+    int (*slice_fn[5])(uint16_t *) = {slice_phase0, slice_phase1, slice_phase2, slice_phase3, slice_phase4};
+
+    if (!__builtin_cpu_supports("avx2"))
+        return false;
+
+    memset(slice_pairs, 0, sizeof (slice_pairs));
+    memset(slice_bias, 0, sizeof (slice_bias));
+    for (int r = 0; r < 5; ++r) {
+        for (int lane = 0; lane < 5; ++lane) {
+            int offset = (r + lane) / 5;
+            int phase = (r + lane) % 5;
+            uint16_t weights[6] = {0, 0, 0, 0, 0, 0}; // sample 5 is always 0
+
+            for (int tap = 0; tap + offset < 5; ++tap) {
+                uint16_t unit[5] = {0, 0, 0, 0, 0};
+                int weight;
+
+                unit[tap] = 1;
+                weight = slice_fn[phase](unit);
+                weights[tap + offset] = (uint16_t) weight;
+                slice_bias[r][lane] -= 32768 * weight;
+            }
+
+            for (int q = 0; q < 3; ++q)
+                slice_pairs[r][q][lane] = (int32_t) (weights[2 * q] | ((uint32_t) weights[2 * q + 1] << 16));
+        }
+    }
+
+    return true;
+}
+
+#endif
+
+// NULL if the CPU has no all-phase slicer, every phase is sliced separately then
+static slice_all_fn slice_all;
+
+// Mode S demodulation is split into two passes so that the expensive part
+// can be spread over several threads without changing the results:
+//
+// 1. find_candidates() looks for preambles in a range of sample offsets and
+//    slices the message bytes for every phase that passed the preamble
+//    threshold. It only reads the magnitude data and does not touch any
+//    global state, so several slices of one mag_buf can be processed in
+//    parallel. The slices only divide up the preamble start offsets; the
+//    sliced data may extend past the end of a slice into the next one (and
+//    into the trailing overlap of the mag_buf), exactly as it would in a
+//    single pass.
+//
+// 2. decode_candidates() then runs on the main thread and walks the
+//    candidates of all slices in sample order. It scores and decodes them,
+//    skips candidates that lie inside an already decoded message and hands
+//    the results to useModesMessage(). Scoring depends on the ICAO filter,
+//    which is updated as messages are decoded, so this part has to stay
+//    serial to give the same output as a single threaded run.
+//
+// Without worker threads both passes run on the main thread anyway, so the
+// first pass only notes which phases passed the threshold and the slicing
+// is left to decode_candidates(). That way candidates inside an already
+// decoded message are skipped before they are sliced.
+//
+// With --modeac the first pass also looks for Mode A/C replies. Each slice
+// is swept in chunks small enough to stay in L1 cache, running the Mode S
+// preamble search and then the Mode A/C F1/F2 search over the same chunk,
+// so the magnitude data is only brought in from memory once. The Mode A/C
+// noise level is computed once per mag_buf and shared by all slices.
+// merge_modeac() stitches the per-slice Mode A/C results together before
+// the second pass.
+
+// One preamble that passed the threshold for at least one phase
+struct demod_candidate {
+    uint32_t j; // sample offset of the preamble within the mag_buf
+    unsigned phases; // bit N set: try_phase N + 4 passed the preamble threshold
+    unsigned ntries; // number of phases tried
+    struct {
+        int phase; // 4..8, see find_candidates
+        int bytelen; // number of sliced bytes, 1 if the DF was not recognised
+        int score; // -2 if already rejected by precheckModesMessage, 0 otherwise
+        uint32_t crc; // CRC syndrome, computed while slicing
+        struct errorinfo *ei; // error diagnosis of precheckModesMessage, for scoring
+        unsigned char msg[MODES_LONG_MSG_BYTES];
+    } tries[5];
+};
+
+// A range of preamble start offsets and the candidates found in it
+struct demod_slice {
+    struct mag_buf *mag;
+    uint32_t start; // first preamble offset to look at
+    uint32_t end; // one past the last preamble offset to look at
+    uint32_t preamble_threshold; // threshold in effect for this buffer
+    struct demod_candidate *candidates;
+    unsigned count; // number of valid entries in candidates
+    unsigned size; // allocated size of candidates
+    unsigned dropped; // preambles dropped because candidates could not grow
+    bool slice_later; // leave the slicing to decode_candidates()
+    unsigned modeac_noise_level; // Mode A/C noise level of this mag_buf
+    uint32_t modeac_next; // next F1 offset the Mode A/C search looks at
+    struct demod_modeac *modeac; // Mode A/C results, in sample order
+    unsigned modeac_count;
+    unsigned modeac_size;
+    bool done; // first pass finished, protected by the worker pool mutex
+};
+
+// One Mode A/C reply found by find_modeac()
+struct demod_modeac {
+    uint32_t f1_sample; // sample offset of the first framing pulse
     struct modesMessage mm;
-    unsigned char msg1[MODES_LONG_MSG_BYTES], msg2[MODES_LONG_MSG_BYTES], *msg;
-    uint32_t j;
+};
 
-    unsigned char *bestmsg;
-    int bestscore, bestphase;
+// Chunk of preamble offsets searched for Mode S and Mode A/C in one go,
+// a multiple of PRESCAN_BLOCK (4096 samples = 8kB of magnitude data)
+#define DEMOD_CHUNK 4096
 
-    uint16_t *m = mag->data;
-    uint32_t mlen = mag->validLength - mag->overlap;
+// Length of a Mode A/C reply in samples, the search skips this far ahead after one
+#define MODEAC_SAMPLES (20 * 87 / 25 + 1)
 
-    uint64_t sum_scaled_signal_power = 0;
+static inline __attribute__ ((always_inline)) bool detect_modeac(const uint16_t *m, uint32_t len, uint32_t f1_sample, unsigned noise_level, unsigned *modeac_out, unsigned *f2_clock_out);
+static void modeac_message(struct mag_buf *mag, unsigned modeac, unsigned f2_clock, struct modesMessage *mm);
+static void find_modeac(struct demod_slice *slice, uint32_t end);
+static bool queue_modeac(struct demod_slice *slice, uint32_t f1_sample, struct modesMessage *mm);
 
-    msg = msg1;
+// message length in bytes given the first byte, 1 if the DF is not one we decode
 
-    // advance ifile artificial clock even if we don't receive anything
-    if (Modes.sdr_type == SDR_IFILE) {
-        Modes.ifile_now = mag->sysTimestamp;
+static inline int slice_bytelen(uint8_t first) {
+    switch (first >> 3) {
+        case 0: case 4: case 5: case 11:
+            return MODES_SHORT_MSG_BYTES;
+
+        case 16: case 17: case 18: case 20: case 21: case 24:
+            return MODES_LONG_MSG_BYTES;
+
+        default:
+            return 1; // unknown DF, give up immediately
     }
+}
 
-    for (j = 0; j < mlen; j++) {
-        uint16_t *pa = &m[j];
-        int32_t pa_mag, base_noise, ref_level;
-        int msglen;
+// update the CRC syndrome with byte i of a message of bytelen bytes
 
-        // Look for a message starting at around sample 0 with phase offset 3..7
+static inline uint32_t slice_crc(uint32_t crc, int i, int bytelen, uint8_t byte) {
+    if (i < bytelen - 3)
+        return modesChecksumUpdate(crc, byte);
+    else
+        return crc ^ ((uint32_t) byte << (8 * (bytelen - 1 - i)));
+}
 
-        // Ideal sample values for preambles with different phase
-        // Xn is the first data symbol with phase offset N
-        //
-        // sample#: 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0
-        // phase 3: 2/4\0/5\1 0 0 0 0/5\1/3 3\0 0 0 0 0 0 X4
-        // phase 4: 1/5\0/4\2 0 0 0 0/4\2 2/4\0 0 0 0 0 0 0 X0
-        // phase 5: 0/5\1/3 3\0 0 0 0/3 3\1/5\0 0 0 0 0 0 0 X1
-        // phase 6: 0/4\2 2/4\0 0 0 0 2/4\0/5\1 0 0 0 0 0 0 X2
-        // phase 7: 0/3 3\1/5\0 0 0 0 1/5\0/4\2 0 0 0 0 0 0 X3
-        //
+// the CRC syndrome is complete: reject what can be rejected without
+// looking at the ICAO filter, so decode_candidates() doesn't have to
 
-        // do a pre-check to reduce CPU usage
-        if (!(pa[1] > pa[7] && pa[12] > pa[14] && pa[12] > pa[15])) {
-            continue;
+static inline void slice_done(struct demod_candidate *c, unsigned n) {
+    if (c->tries[n].bytelen > 1)
+        c->tries[n].score = precheckModesMessage(c->tries[n].msg, c->tries[n].bytelen * 8, c->tries[n].crc, &c->tries[n].ei);
+    else
+        c->tries[n].score = -2;
+}
+
+// slice one phase using data from the magnitude buffers
+
+static void slice_phase(struct demod_candidate *c, int try_phase, uint16_t *m, uint32_t j) {
+    unsigned char *msg = c->tries[c->ntries].msg;
+    uint16_t *pPtr;
+    int phase, i, bytelen;
+    uint32_t crc = 0;
+
+    pPtr = &m[j + 19] + (try_phase / 5);
+    phase = try_phase % 5;
+
+    msg[0] = slice_byte(&pPtr, &phase);
+    bytelen = slice_bytelen(msg[0]);
+
+    for (i = 1; i < bytelen; ++i) {
+        crc = slice_crc(crc, i - 1, bytelen, msg[i - 1]);
+        msg[i] = slice_byte(&pPtr, &phase);
+    }
+    crc = slice_crc(crc, bytelen - 1, bytelen, msg[bytelen - 1]);
+
+    c->tries[c->ntries].phase = try_phase;
+    c->tries[c->ntries].bytelen = bytelen;
+    c->tries[c->ntries].crc = crc;
+    slice_done(c, c->ntries);
+    c->ntries++;
+}
+
+// slice the phases in the 'phases' bitmask (bit N for try_phase N + 4),
+// bytes needed by more than one phase are sliced for all of them at once
+
+static void slice_phases(struct demod_candidate *c, unsigned phases, uint16_t *m, uint32_t j) {
+    uint16_t *p = &m[j + 19];
+    uint8_t all[MODES_LONG_MSG_BYTES][5];
+    int longest = 0, second = 0; // the two largest message lengths
+    int shared;
+
+    if (!slice_all || !(phases & (phases - 1))) {
+        for (int t = 0; t < 5; ++t) {
+            if (phases & (1 << t))
+                slice_phase(c, t + 4, m, j);
         }
+        return;
+    }
 
-        // 5 noise samples
-        base_noise = pa[5] + pa[8] + pa[16] + pa[17] + pa[18];
-        // pa_mag is the sum of the 4 preamble high bits
-        // minus 2 low bits between each of high bit pairs
+    slice_all(p, 0, 1, all);
 
-        // reduce number of preamble detections if we recently dropped samples
-        if (Modes.stats_15min.samples_dropped) {
-            ref_level = base_noise * max(PREAMBLE_THRESHOLD_PIZERO, Modes.preambleThreshold);
-        } else {
-            ref_level = base_noise * Modes.preambleThreshold;
+    for (int t = 0; t < 5; ++t) {
+        int bytelen;
+
+        if (!(phases & (1 << t)))
+            continue;
+
+        bytelen = slice_bytelen(all[0][t]);
+
+        c->tries[c->ntries].phase = t + 4;
+        c->tries[c->ntries].bytelen = bytelen;
+        c->tries[c->ntries].msg[0] = all[0][t];
+        c->ntries++;
+
+        if (bytelen > longest) {
+            second = longest;
+            longest = bytelen;
+        } else if (bytelen > second) {
+            second = bytelen;
         }
+    }
+
+    shared = 1;
+    if (second > 1) {
+        slice_all(p, 1, second, all);
+        shared = second;
+    }
+
+    for (unsigned n = 0; n < c->ntries; ++n) {
+        unsigned char *msg = c->tries[n].msg;
+        int t = c->tries[n].phase - 4;
+        int bytelen = c->tries[n].bytelen;
+        uint32_t crc = 0;
+        int i;
 
-        ref_level >>= 5; // divide by 32
-
-        bestmsg = NULL;
-        bestscore = -42;
-        bestphase = -1;
-
-        int32_t diff_2_3 = pa[2] - pa[3];
-        int32_t sum_1_4 = pa[1] + pa[4];
-        int32_t diff_10_11 = pa[10] - pa[11];
-        int32_t common3456 = sum_1_4 - diff_2_3 + pa[9] + pa[12];
-
-        // sample#: 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0
-        // phase 3: 2/4\0/5\1 0 0 0 0/5\1/3 3\0 0 0 0 0 0 X4
-        // phase 4: 1/5\0/4\2 0 0 0 0/4\2 2/4\0 0 0 0 0 0 0 X0
-        pa_mag = common3456 - diff_10_11;
-        if (pa_mag >= ref_level) {
-            // peaks at 1,3,9,11-12: phase 3
-            score_phase(4, m, j, &bestmsg, &bestscore, &bestphase, &msg, msg1, msg2);
-            // peaks at 1,3,9,12: phase 4
-            score_phase(5, m, j, &bestmsg, &bestscore, &bestphase, &msg, msg1, msg2);
+        for (i = 1; i < shared && i < bytelen; ++i) {
+            crc = slice_crc(crc, i - 1, bytelen, msg[i - 1]);
+            msg[i] = all[i][t];
         }
-        // sample#: 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0
-        // phase 5: 0/5\1/3 3\0 0 0 0/3 3\1/5\0 0 0 0 0 0 0 X1
-        // phase 6: 0/4\2 2/4\0 0 0 0 2/4\0/5\1 0 0 0 0 0 0 X2
-        pa_mag = common3456 + diff_10_11;
-        if (pa_mag >= ref_level) {
-            // peaks at 1,3-4,9-10,12: phase 5
-            score_phase(6, m, j, &bestmsg, &bestscore, &bestphase, &msg, msg1, msg2);
-            // peaks at 1,4,10,12: phase 6
-            score_phase(7, m, j, &bestmsg, &bestscore, &bestphase, &msg, msg1, msg2);
+
+        // the rest of the longest message
+        if (i < bytelen) {
+            uint16_t *pPtr = p + (t + 4 + 96 * i) / 5;
+            int phase = (t + 4 + 96 * i) % 5;
+
+            for (; i < bytelen; ++i) {
+                crc = slice_crc(crc, i - 1, bytelen, msg[i - 1]);
+                msg[i] = slice_byte(&pPtr, &phase);
+            }
         }
 
-        // peaks at 1-2,4,10,12: phase 7
-        // sample#: 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0
-        // phase 7: 0/3 3\1/5\0 0 0 0 1/5\0/4\2 0 0 0 0 0 0 X3
-        pa_mag = sum_1_4 + 2 * diff_2_3 + diff_10_11 + pa[12];
-        if (pa_mag >= ref_level) {
-            score_phase(8, m, j, &bestmsg, &bestscore, &bestphase, &msg, msg1, msg2);
+        c->tries[n].crc = slice_crc(crc, bytelen - 1, bytelen, msg[bytelen - 1]);
+        slice_done(c, n);
+    }
+}
+
+static struct demod_candidate *new_candidate(struct demod_slice *slice) {
+    if (slice->count == slice->size) {
+        unsigned newsize = slice->size ? slice->size * 2 : 1024;
+        struct demod_candidate *newcandidates = realloc(slice->candidates, newsize * sizeof (*newcandidates));
+        if (!newcandidates)
+            return NULL;
+        slice->candidates = newcandidates;
+        slice->size = newsize;
+    }
+
+    return &slice->candidates[slice->count];
+}
+
+//
+// Look for Mode S preambles starting at offsets start .. end-1 and slice the
+// data of every phase that passed the preamble threshold, unless the slice
+// leaves that to decode_candidates().
+//
+
+static void find_preambles(struct demod_slice *slice, uint32_t start, uint32_t end) {
+    uint16_t *m = slice->mag->data;
+    uint32_t j;
+
+    for (uint32_t block = start; block < end; block += PRESCAN_BLOCK) {
+        uint64_t candidates = prescan(&m[block]);
+
+        if (end - block < PRESCAN_BLOCK)
+            candidates &= ((uint64_t) 1 << (end - block)) - 1;
+
+        while (candidates) {
+            j = block + __builtin_ctzll(candidates);
+            candidates &= candidates - 1;
+
+            uint16_t *pa = &m[j];
+            int32_t pa_mag, base_noise, ref_level;
+            struct demod_candidate *c;
+
+            // Look for a message starting at around sample 0 with phase offset 3..7
+
+            // Ideal sample values for preambles with different phase
+            // Xn is the first data symbol with phase offset N
+            //
+            // sample#: 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0
+            // phase 3: 2/4\0/5\1 0 0 0 0/5\1/3 3\0 0 0 0 0 0 X4
+            // phase 4: 1/5\0/4\2 0 0 0 0/4\2 2/4\0 0 0 0 0 0 0 X0
+            // phase 5: 0/5\1/3 3\0 0 0 0/3 3\1/5\0 0 0 0 0 0 0 X1
+            // phase 6: 0/4\2 2/4\0 0 0 0 2/4\0/5\1 0 0 0 0 0 0 X2
+            // phase 7: 0/3 3\1/5\0 0 0 0 1/5\0/4\2 0 0 0 0 0 0 X3
+            //
+
+            // the pre-check (pa[1] > pa[7] && pa[12] > pa[14] && pa[12] > pa[15])
+            // to reduce CPU usage was already done by prescan()
+
+            // 5 noise samples
+            base_noise = pa[5] + pa[8] + pa[16] + pa[17] + pa[18];
+            // pa_mag is the sum of the 4 preamble high bits
+            // minus 2 low bits between each of high bit pairs
+
+            ref_level = base_noise * slice->preamble_threshold;
+            ref_level >>= 5; // divide by 32
+
+            // out of memory: count what is lost and try again with the next one
+            if (!(c = new_candidate(slice))) {
+                slice->dropped++;
+                continue;
+            }
+
+            c->j = j;
+            c->ntries = 0;
+
+            unsigned phases = 0; // bit N set: try_phase N + 4 passed the threshold
+
+            int32_t diff_2_3 = pa[2] - pa[3];
+            int32_t sum_1_4 = pa[1] + pa[4];
+            int32_t diff_10_11 = pa[10] - pa[11];
+            int32_t common3456 = sum_1_4 - diff_2_3 + pa[9] + pa[12];
+
+            // sample#: 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0
+            // phase 3: 2/4\0/5\1 0 0 0 0/5\1/3 3\0 0 0 0 0 0 X4
+            // phase 4: 1/5\0/4\2 0 0 0 0/4\2 2/4\0 0 0 0 0 0 0 X0
+            pa_mag = common3456 - diff_10_11;
+            if (pa_mag >= ref_level) {
+                // peaks at 1,3,9,11-12: phase 3
+                // peaks at 1,3,9,12: phase 4
+                phases |= 0x03;
+            }
+            // sample#: 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0
+            // phase 5: 0/5\1/3 3\0 0 0 0/3 3\1/5\0 0 0 0 0 0 0 X1
+            // phase 6: 0/4\2 2/4\0 0 0 0 2/4\0/5\1 0 0 0 0 0 0 X2
+            pa_mag = common3456 + diff_10_11;
+            if (pa_mag >= ref_level) {
+                // peaks at 1,3-4,9-10,12: phase 5
+                // peaks at 1,4,10,12: phase 6
+                phases |= 0x0C;
+            }
+
+            // peaks at 1-2,4,10,12: phase 7
+            // sample#: 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0
+            // phase 7: 0/3 3\1/5\0 0 0 0 1/5\0/4\2 0 0 0 0 0 0 X3
+            pa_mag = sum_1_4 + 2 * diff_2_3 + diff_10_11 + pa[12];
+            if (pa_mag >= ref_level) {
+                phases |= 0x10;
+            }
+
+            // no preamble detected
+            if (!phases)
+                continue;
+
+            c->phases = phases;
+            if (!slice->slice_later)
+                slice_phases(c, phases, m, j);
+            slice->count++;
         }
+    }
+}
 
-        // no preamble detected
-        if (bestscore == -42) {
-            continue;
+//
+// First pass over one slice: Mode S candidates and, if enabled, Mode A/C
+// replies for offsets slice->start .. slice->end-1
+//
+
+static void find_candidates(struct demod_slice *slice) {
+    slice->count = 0;
+    slice->dropped = 0;
+    slice->modeac_count = 0;
+    // the Mode A/C search needs one sample before F1
+    slice->modeac_next = slice->start ? slice->start : 1;
+
+    for (uint32_t chunk = slice->start; chunk < slice->end; chunk += DEMOD_CHUNK) {
+        uint32_t end = min(chunk + DEMOD_CHUNK, slice->end);
+
+        find_preambles(slice, chunk, end);
+        if (Modes.mode_ac)
+            find_modeac(slice, end);
+    }
+}
+
+//
+// Merge the Mode A/C results of all slices into one list, as if the
+// whole mag_buf had been searched in one go.
+//
+// After a reply is found the search skips ahead past it. A slice starts
+// searching at its first offset without knowing about replies found at
+// the end of the previous slice, so until the two agree again on which
+// offsets get looked at, redo the search here.
+//
+
+static struct demod_slice *merge_modeac(struct demod_slice *slices, int nslices, struct demod_slice *out) {
+    struct modesMessage mm;
+    unsigned modeac, f2_clock;
+    uint32_t next = 1;
+
+    if (nslices == 1)
+        return &slices[0];
+
+    out->modeac_count = 0;
+
+    for (int s = 0; s < nslices; ++s) {
+        struct demod_slice *slice = &slices[s];
+        uint32_t f1_sample = max(next, slice->start);
+        unsigned n = 0;
+        bool synced = false;
+
+        while (f1_sample < slice->end) {
+            // skip over the replies found by the slice that end before f1_sample
+            while (n < slice->modeac_count && slice->modeac[n].f1_sample + MODEAC_SAMPLES <= f1_sample)
+                ++n;
+
+            // the slice looked at this offset too: its results from here on are right
+            if (n == slice->modeac_count || slice->modeac[n].f1_sample >= f1_sample) {
+                synced = true;
+                break;
+            }
+
+            if (detect_modeac(slice->mag->data, slice->mag->validLength, f1_sample, slice->modeac_noise_level, &modeac, &f2_clock)) {
+                modeac_message(slice->mag, modeac, f2_clock, &mm);
+                queue_modeac(out, f1_sample, &mm);
+                f1_sample += MODEAC_SAMPLES;
+            } else {
+                ++f1_sample;
+            }
         }
 
-        // we had at least one phase greater than the preamble threshold
-        // and used scoremodesmessage on those bytes
-        Modes.stats_current.demod_preambles++;
-
-        // Do we have a candidate?
-        if (bestscore < 0) {
-            if (bestscore == -1)
-                Modes.stats_current.demod_rejected_unknown_icao++;
-            else
-                Modes.stats_current.demod_rejected_bad++;
-            continue; // nope.
+        if (synced) {
+            for (; n < slice->modeac_count; ++n)
+                queue_modeac(out, slice->modeac[n].f1_sample, &slice->modeac[n].mm);
+            next = slice->modeac_next;
+        } else {
+            next = f1_sample;
         }
+    }
 
-        msglen = modesMessageLenByType(bestmsg[0] >> 3);
+    return out;
+}
 
-        // Set initial mm structure details
-        mm = zeroMessage;
+//
+// Score and decode the candidates found by find_candidates() in sample order
+// and pass the results, merged with any Mode A/C messages, to the next layer.
+//
 
-        // For consistency with how the Beast / Radarcape does it,
-        // we report the timestamp at the end of bit 56 (even if
-        // the frame is a 112-bit frame)
-        mm.timestampMsg = mag->sampleTimestamp + j * 5 + (8 + 56) * 12 + bestphase;
+static void decode_candidates(struct mag_buf *mag, struct demod_slice *slices, int nslices, struct demod_slice *modeac) {
+    static struct modesMessage zeroMessage;
+    struct modesMessage mm;
+    uint16_t *m = mag->data;
+    uint32_t mlen = mag->validLength - mag->overlap;
+    uint32_t next_j = 0;
+    unsigned next_modeac = 0;
 
-        // compute message receive time as block-start-time + difference in the 12MHz clock
-        mm.sysTimestampMsg = mag->sysTimestamp + receiveclock_ms_elapsed(mag->sampleTimestamp, mm.timestampMsg);
+    uint64_t sum_scaled_signal_power = 0;
 
-        // advance ifile artifical clock for every message received
-        if (Modes.sdr_type == SDR_IFILE) {
-            Modes.ifile_now = mm.sysTimestampMsg;
-        }
+    for (int s = 0; s < nslices; ++s) {
+        Modes.stats_current.demod_preambles_dropped += slices[s].dropped;
+
+        for (unsigned n = 0; n < slices[s].count; ++n) {
+            struct demod_candidate *c = &slices[s].candidates[n];
+            uint32_t j = c->j;
+            unsigned char *bestmsg;
+            int bestscore, bestphase;
+            int msglen;
+
+            // skip over preambles inside the last decoded message
+            if (j < next_j)
+                continue;
+
+            // phases still to be sliced, one at a time so that none are
+            // sliced once one scored perfectly
+            unsigned pending = slices[s].slice_later ? c->phases : 0;
+
+            bestmsg = NULL;
+            bestscore = -42;
+            bestphase = -1;
+
+            // score the sliced phases, keep the best one
+            for (unsigned t = 0; t < c->ntries || pending; ++t) {
+                int score;
+
+                if (t == c->ntries) {
+                    if (bestscore >= MODES_MAX_SCORE) {
+                        for (; pending; pending &= pending - 1) {
+                            Modes.stats_current.demod_preamblePhase[__builtin_ctz(pending)]++;
+                            Modes.stats_current.demod_score_skipped++;
+                        }
+                        break;
+                    }
+                    slice_phase(c, __builtin_ctz(pending) + 4, m, j);
+                    pending &= pending - 1;
+                }
+
+                Modes.stats_current.demod_preamblePhase[c->tries[t].phase - 4]++;
+
+                // Nothing can beat a perfect score, don't bother with the rest
+                if (bestscore >= MODES_MAX_SCORE) {
+                    Modes.stats_current.demod_score_skipped++;
+                    continue;
+                }
+
+                // Score the mode S message and see if it's any good.
+                // Bad CRCs were already rejected while slicing.
+                if (c->tries[t].score < 0) {
+                    score = c->tries[t].score;
+                    Modes.stats_current.demod_rejected_early++;
+                } else {
+                    score = scoreModesMessagePrechecked(c->tries[t].msg, c->tries[t].crc, c->tries[t].ei);
+                }
+
+                if (score > bestscore) {
+                    // new high score!
+                    bestmsg = c->tries[t].msg;
+                    bestscore = score;
+                    bestphase = c->tries[t].phase;
+                }
+            }
 
-        mm.score = bestscore;
+            // we had at least one phase greater than the preamble threshold
+            // and used scoremodesmessage on those bytes
+            Modes.stats_current.demod_preambles++;
 
-        // Decode the received message
-        {
-            int result = decodeModesMessage(&mm, bestmsg);
-            if (result < 0) {
-                if (result == -1)
+            // Do we have a candidate?
+            if (bestscore < 0) {
+                if (bestscore == -1)
                     Modes.stats_current.demod_rejected_unknown_icao++;
                 else
                     Modes.stats_current.demod_rejected_bad++;
-                continue;
-            } else {
-                Modes.stats_current.demod_accepted[mm.correctedbits]++;
+                continue; // nope.
             }
-        }
 
-        Modes.stats_current.demod_bestPhase[bestphase - 4]++;
-        
-        // measure signal power
-        {
-            double signal_power;
-            uint64_t scaled_signal_power = 0;
-            int signal_len = msglen * 12 / 5;
-            int k;
-
-            for (k = 0; k < signal_len; ++k) {
-                uint32_t mag = m[j + 19 + k];
-                scaled_signal_power += mag * mag;
+            msglen = modesMessageLenByType(bestmsg[0] >> 3);
+
+            // Set initial mm structure details
+            mm = zeroMessage;
+
+            // For consistency with how the Beast / Radarcape does it,
+            // we report the timestamp at the end of bit 56 (even if
+            // the frame is a 112-bit frame)
+            mm.timestampMsg = mag->sampleTimestamp + j * 5 + (8 + 56) * 12 + bestphase;
+
+            // compute message receive time as block-start-time + difference in the 12MHz clock
+            mm.sysTimestampMsg = mag->sysTimestamp + receiveclock_ms_elapsed(mag->sampleTimestamp, mm.timestampMsg);
+
+            // advance ifile artifical clock for every message received
+            if (Modes.sdr_type == SDR_IFILE) {
+                Modes.ifile_now = mm.sysTimestampMsg;
             }
 
-            signal_power = scaled_signal_power / 65535.0 / 65535.0;
-            mm.signalLevel = signal_power / signal_len;
-            Modes.stats_current.signal_power_sum += signal_power;
-            Modes.stats_current.signal_power_count += signal_len;
-            sum_scaled_signal_power += scaled_signal_power;
+            mm.score = bestscore;
+
+            // Decode the received message
+            {
+                int result = decodeModesMessage(&mm, bestmsg);
+                if (result < 0) {
+                    if (result == -1)
+                        Modes.stats_current.demod_rejected_unknown_icao++;
+                    else
+                        Modes.stats_current.demod_rejected_bad++;
+                    continue;
+                } else {
+                    Modes.stats_current.demod_accepted[mm.correctedbits]++;
+                }
+            }
 
-            if (mm.signalLevel > Modes.stats_current.peak_signal_power)
-                Modes.stats_current.peak_signal_power = mm.signalLevel;
-            if (mm.signalLevel > 0.50119)
-                Modes.stats_current.strong_signal_count++; // signal power above -3dBFS
-        }
+            Modes.stats_current.demod_bestPhase[bestphase - 4]++;
+
+            // measure signal power
+            {
+                double signal_power;
+                uint64_t scaled_signal_power = 0;
+                int signal_len = msglen * 12 / 5;
+                int k;
+
+                for (k = 0; k < signal_len; ++k) {
+                    uint32_t mag = m[j + 19 + k];
+                    scaled_signal_power += mag * mag;
+                }
+
+                signal_power = scaled_signal_power / 65535.0 / 65535.0;
+                mm.signalLevel = signal_power / signal_len;
+                Modes.stats_current.signal_power_sum += signal_power;
+                Modes.stats_current.signal_power_count += signal_len;
+                sum_scaled_signal_power += scaled_signal_power;
+
+                if (mm.signalLevel > Modes.stats_current.peak_signal_power)
+                    Modes.stats_current.peak_signal_power = mm.signalLevel;
+                if (mm.signalLevel > 0.50119)
+                    Modes.stats_current.strong_signal_count++; // signal power above -3dBFS
+            }
+
+            // Skip over the message:
+            // (we actually skip to 8 bits before the end of the message,
+            //  because we can often decode two messages that *almost* collide,
+            //  where the preamble of the second message clobbered the last
+            //  few bits of the first message, but the message bits didn't
+            //  overlap)
+            next_j = j + msglen * 12 / 5 + 1;
+
+            // Mode A/C messages received before this one go first
+            while (modeac && next_modeac < modeac->modeac_count && modeac->modeac[next_modeac].mm.timestampMsg < mm.timestampMsg) {
+                useModesMessage(&modeac->modeac[next_modeac++].mm);
+                Modes.stats_current.demod_modeac++;
+            }
 
-        // Skip over the message:
-        // (we actually skip to 8 bits before the end of the message,
-        //  because we can often decode two messages that *almost* collide,
-        //  where the preamble of the second message clobbered the last
-        //  few bits of the first message, but the message bits didn't
-        //  overlap)
-        j += msglen * 12 / 5;
+            // Pass data to the next layer
+            useModesMessage(&mm);
+        }
+    }
 
-        // Pass data to the next layer
-        useModesMessage(&mm);
+    while (modeac && next_modeac < modeac->modeac_count) {
+        useModesMessage(&modeac->modeac[next_modeac++].mm);
+        Modes.stats_current.demod_modeac++;
     }
 
     /* update noise power */
@@ -427,6 +1065,303 @@ void demodulate2400(struct mag_buf *mag) {
     }
 }
 
+//
+// Demodulation worker pool
+//
+// First pass jobs (one slice each) go into a queue that N-1 worker threads
+// take them from; a thread waiting for a job to finish runs queued jobs
+// itself instead of just blocking.
+//
+// With --demod-threads N the first pass of each mag_buf is split into N
+// slices. The main thread queues them and waits for all of them before
+// running the second pass.
+//
+// With --batch N (offline --ifile replay) each mag_buf is a single slice
+// and up to N of them are in flight: the workers run the first pass of
+// the next buffers while the main thread runs the second pass of the
+// oldest one. The second pass still sees the buffers one by one in sample
+// order, so the output is the same as a serial run.
+//
+
+static struct {
+    int nthreads; // number of threads doing the first pass, including the main thread
+    pthread_t *threads; // the worker threads
+    int nworkers; // number of worker threads actually running
+    pthread_mutex_t mutex; // mutex protecting the job queue and the done flags
+    pthread_cond_t work_cond; // signalled when a job is queued
+    pthread_cond_t done_cond; // signalled when a job is done
+    struct demod_slice **jobs; // queued jobs, a ring of job_mask + 1 entries
+    unsigned job_mask;
+    unsigned job_head; // next job to be picked up
+    unsigned job_tail; // next free entry
+    bool exit; // tells the worker threads to exit
+    struct demod_slice *slices; // slices[0..nthreads-1] first pass, slices[nthreads] merged Mode A/C;
+    // with --batch, one slice per mag_buf in flight
+    int nslices; // number of entries in slices
+    int batch; // --batch: number of mag_bufs in flight at most, 0 if not batching
+    int block_head; // --batch: slice of the oldest mag_buf in flight
+    int block_count; // --batch: number of mag_bufs in flight
+} demod;
+
+// Take the next queued job, with the mutex held. NULL if there is none.
+
+static struct demod_slice *take_demod_job(void) {
+    if (demod.job_head == demod.job_tail)
+        return NULL;
+    return demod.jobs[demod.job_head++ & demod.job_mask];
+}
+
+// Run a job taken from the queue, with the mutex held
+
+static void run_demod_job(struct demod_slice *job) {
+    pthread_mutex_unlock(&demod.mutex);
+    find_candidates(job);
+    pthread_mutex_lock(&demod.mutex);
+
+    job->done = true;
+    pthread_cond_broadcast(&demod.done_cond);
+}
+
+static void queue_demod_job(struct demod_slice *job) {
+    if (!demod.nworkers) {
+        find_candidates(job);
+        job->done = true;
+        return;
+    }
+
+    pthread_mutex_lock(&demod.mutex);
+    job->done = false;
+    demod.jobs[demod.job_tail++ & demod.job_mask] = job;
+    pthread_cond_signal(&demod.work_cond);
+    pthread_mutex_unlock(&demod.mutex);
+}
+
+// Wait for a queued job to finish, running other queued jobs meanwhile
+
+static void wait_demod_job(struct demod_slice *job) {
+    if (!demod.nworkers)
+        return;
+
+    pthread_mutex_lock(&demod.mutex);
+    while (!job->done) {
+        struct demod_slice *other = take_demod_job();
+        if (other)
+            run_demod_job(other);
+        else
+            pthread_cond_wait(&demod.done_cond, &demod.mutex);
+    }
+    pthread_mutex_unlock(&demod.mutex);
+}
+
+static void *demodThreadEntryPoint(void *arg) {
+    MODES_NOTUSED(arg);
+
+    worker_thread_init("readsb-demod");
+
+    pthread_mutex_lock(&demod.mutex);
+    while (!demod.exit) {
+        struct demod_slice *job = take_demod_job();
+        if (job)
+            run_demod_job(job);
+        else
+            pthread_cond_wait(&demod.work_cond, &demod.mutex);
+    }
+    pthread_mutex_unlock(&demod.mutex);
+
+    return NULL;
+}
+
+// Select the fastest preamble pre-scan kernel supported by this CPU
+// and start the demodulation worker threads
+
+void demodulate2400Init(void) {
+    for (int i = 0; prescan_table[i].fn; ++i) {
+        if (prescan_table[i].supported()) {
+            prescan = prescan_table[i].fn;
+            fprintf(stderr, "demod: using %s preamble pre-scan\n", prescan_table[i].description);
+            break;
+        }
+    }
+
+#if defined(__x86_64__) || defined(__i386__)
+    if (slice_all_init()) {
+        slice_all = slice_all_avx2;
+        fprintf(stderr, "demod: using AVX2 all-phase slicer\n");
+    }
+#endif
+
+    if (Modes.demod_batch > 1) {
+        demod.batch = Modes.demod_batch;
+        demod.nthreads = demod.batch;
+        demod.nslices = demod.batch;
+    } else {
+        demod.nthreads = Modes.demod_threads > 0 ? Modes.demod_threads : 1;
+        // one slice per thread plus one for the merged Mode A/C results
+        demod.nslices = demod.nthreads + 1;
+    }
+
+    // the job queue never holds more than one job per slice
+    unsigned capacity = 1;
+    while (capacity < (unsigned) demod.nslices)
+        capacity <<= 1;
+    demod.job_mask = capacity - 1;
+
+    demod.slices = calloc(demod.nslices, sizeof (struct demod_slice));
+    demod.jobs = calloc(capacity, sizeof (struct demod_slice *));
+    if (!demod.slices || !demod.jobs) {
+        fprintf(stderr, "Out of memory allocating demodulator state\n");
+        exit(1);
+    }
+
+    if (demod.nthreads == 1)
+        return;
+
+    pthread_mutex_init(&demod.mutex, NULL);
+    pthread_cond_init(&demod.work_cond, NULL);
+    pthread_cond_init(&demod.done_cond, NULL);
+
+    demod.threads = calloc(demod.nthreads - 1, sizeof (pthread_t));
+    for (int i = 0; i < demod.nthreads - 1; ++i) {
+        if (!demod.threads || pthread_create(&demod.threads[i], NULL, demodThreadEntryPoint, NULL)) {
+            // the threads started so far just keep picking up jobs
+            fprintf(stderr, "demod: can't start worker thread, using %d threads\n", i + 1);
+            break;
+        }
+        demod.nworkers++;
+    }
+
+    if (demod.batch)
+        fprintf(stderr, "demod: batch mode, up to %d sample blocks in flight on %d threads\n", demod.batch, demod.nworkers + 1);
+    else
+        fprintf(stderr, "demod: using %d threads\n", demod.nworkers + 1);
+}
+
+// Stop the worker threads and free the candidate buffers
+
+void demodulate2400Cleanup(void) {
+    if (demod.nworkers) {
+        pthread_mutex_lock(&demod.mutex);
+        demod.exit = true;
+        pthread_cond_broadcast(&demod.work_cond);
+        pthread_mutex_unlock(&demod.mutex);
+
+        for (int i = 0; i < demod.nworkers; ++i)
+            pthread_join(demod.threads[i], NULL);
+        demod.nworkers = 0;
+    }
+    free(demod.threads);
+    demod.threads = NULL;
+    free(demod.jobs);
+    demod.jobs = NULL;
+
+    if (demod.slices) {
+        for (int s = 0; s < demod.nslices; ++s) {
+            free(demod.slices[s].candidates);
+            free(demod.slices[s].modeac);
+        }
+        free(demod.slices);
+        demod.slices = NULL;
+    }
+}
+
+// Set up the first pass of mag over nslices slices
+
+static void prepare_slices(struct mag_buf *mag, struct demod_slice *slices, int nslices) {
+    uint32_t mlen = mag->validLength - mag->overlap;
+    uint32_t preamble_threshold;
+    unsigned modeac_noise_level = 0;
+
+    // reduce number of preamble detections if we recently dropped samples
+    if (Modes.stats_15min.samples_dropped) {
+        preamble_threshold = max(PREAMBLE_THRESHOLD_PIZERO, Modes.preambleThreshold);
+    } else {
+        preamble_threshold = Modes.preambleThreshold;
+    }
+
+    if (Modes.mode_ac) {
+        double noise_stddev = sqrt(mag->mean_power - mag->mean_level * mag->mean_level); // Var(X) = E[(X-E[X])^2] = E[X^2] - (E[X])^2
+        modeac_noise_level = (unsigned) ((mag->mean_power + noise_stddev) * 65535 + 0.5);
+    }
+
+    // split the preamble offsets into slices, aligned to the pre-scan blocks
+    for (int s = 0; s < nslices; ++s) {
+        struct demod_slice *slice = &slices[s];
+
+        slice->mag = mag;
+        slice->start = (uint64_t) mlen * s / nslices / PRESCAN_BLOCK * PRESCAN_BLOCK;
+        slice->preamble_threshold = preamble_threshold;
+        slice->modeac_noise_level = modeac_noise_level;
+        // the first pass runs on this thread right before the second
+        slice->slice_later = !demod.nworkers;
+        if (s > 0)
+            slices[s - 1].end = slice->start;
+    }
+    slices[nslices - 1].end = mlen;
+}
+
+//
+// Given 'mlen' magnitude samples in 'm', sampled at 2.4MHz,
+// try to demodulate some Mode S messages, and Mode A/C messages
+// if enabled.
+//
+
+void demodulate2400(struct mag_buf *mag) {
+    // advance ifile artificial clock even if we don't receive anything
+    if (Modes.sdr_type == SDR_IFILE) {
+        Modes.ifile_now = mag->sysTimestamp;
+    }
+
+    prepare_slices(mag, demod.slices, demod.nthreads);
+
+    for (int s = 0; s < demod.nthreads; ++s)
+        queue_demod_job(&demod.slices[s]);
+    for (int s = 0; s < demod.nthreads; ++s)
+        wait_demod_job(&demod.slices[s]);
+
+    decode_candidates(mag, demod.slices, demod.nthreads,
+            Modes.mode_ac ? merge_modeac(demod.slices, demod.nthreads, &demod.slices[demod.nthreads]) : NULL);
+}
+
+//
+// --batch: start the first pass of mag. The caller must not submit more
+// than --batch buffers without completing one.
+//
+
+void demodulate2400Submit(struct mag_buf *mag) {
+    struct demod_slice *slice = &demod.slices[(demod.block_head + demod.block_count) % demod.batch];
+
+    assert(demod.block_count < demod.batch);
+    demod.block_count++;
+
+    prepare_slices(mag, slice, 1);
+    queue_demod_job(slice);
+}
+
+//
+// --batch: run the second pass of the oldest submitted mag_buf and return
+// it, NULL if nothing was submitted.
+//
+
+struct mag_buf *demodulate2400Complete(void) {
+    struct demod_slice *slice;
+
+    if (!demod.block_count)
+        return NULL;
+
+    slice = &demod.slices[demod.block_head];
+    demod.block_head = (demod.block_head + 1) % demod.batch;
+    demod.block_count--;
+
+    wait_demod_job(slice);
+
+    // advance ifile artificial clock even if we don't receive anything
+    if (Modes.sdr_type == SDR_IFILE) {
+        Modes.ifile_now = slice->mag->sysTimestamp;
+    }
+
+    decode_candidates(slice->mag, slice, 1, Modes.mode_ac ? slice : NULL);
+    return slice->mag;
+}
 
 #ifdef MODEAC_DEBUG
 
@@ -434,7 +1369,7 @@ static int yscale(unsigned signal) {
     return (int) (299 - 299.0 * signal / 65536.0);
 }
 
-static void draw_modeac(uint16_t *m, unsigned modeac, unsigned f1_clock, unsigned noise_threshold, unsigned signal_threshold, unsigned bits, unsigned noisy_bits, unsigned uncertain_bits) {
+static void draw_modeac(const uint16_t *m, unsigned modeac, unsigned f1_clock, unsigned noise_threshold, unsigned signal_threshold, unsigned bits, unsigned noisy_bits, unsigned uncertain_bits) {
     // 25 bits at 87*60MHz
     // use 1 pixel = 30MHz = 1087 pixels
 
@@ -519,190 +1454,227 @@ static void draw_modeac(uint16_t *m, unsigned modeac, unsigned f1_clock, unsigne
 //
 // one 2.4MHz sample = 25 cycles
 
-void demodulate2400AC(struct mag_buf *mag) {
-    struct modesMessage mm;
-    uint16_t *m = mag->data;
-    uint32_t mlen = mag->validLength - mag->overlap;
-    unsigned f1_sample;
-
-    memset(&mm, 0, sizeof (mm));
-
-    double noise_stddev = sqrt(mag->mean_power - mag->mean_level * mag->mean_level); // Var(X) = E[(X-E[X])^2] = E[X^2] - (E[X])^2
-    unsigned noise_level = (unsigned) ((mag->mean_power + noise_stddev) * 65535 + 0.5);
-
-    for (f1_sample = 1; f1_sample < mlen; ++f1_sample) {
-        // Mode A/C messages should match this bit sequence:
-
-        // bit #     value
-        //   -1       0    quiet zone
-        //    0       1    framing pulse (F1)
-        //    1      C1
-        //    2      A1
-        //    3      C2
-        //    4      A2
-        //    5      C4
-        //    6      A4
-        //    7       0    quiet zone (X1)
-        //    8      B1
-        //    9      D1
-        //   10      B2
-        //   11      D2
-        //   12      B4
-        //   13      D4
-        //   14       1    framing pulse (F2)
-        //   15       0    quiet zone (X2)
-        //   16       0    quiet zone (X3)
-        //   17     SPI
-        //   18       0    quiet zone (X4)
-        //   19       0    quiet zone (X5)
-
-        // Look for a F1 and F2 pair,
-        // with F1 starting at offset f1_sample.
-
-        // the first framing pulse covers 3.5 samples:
-        //
-        // |----|        |----|
-        // | F1 |________| C1 |_
-        //
-        // | 0 | 1 | 2 | 3 | 4 |
-        //
-        // and there is some unknown phase offset of the
-        // leading edge e.g.:
-        //
-        //   |----|        |----|
-        // __| F1 |________| C1 |_
-        //
-        // | 0 | 1 | 2 | 3 | 4 |
-        //
-        // in theory the "on" period can straddle 3 samples
-        // but it's not a big deal as at most 4% of the power
-        // is in the third sample.
-
-        if (!(m[f1_sample - 1] < m[f1_sample + 0]))
-            continue; // not a rising edge
-
-        if (m[f1_sample + 2] > m[f1_sample + 0] || m[f1_sample + 2] > m[f1_sample + 1])
-            continue; // quiet part of bit wasn't sufficiently quiet
-
-        unsigned f1_level = (m[f1_sample + 0] + m[f1_sample + 1]) / 2;
-
-        if (noise_level * 2 > f1_level) {
-            // require 6dB above noise
-            continue;
-        }
-
-        // estimate initial clock phase based on the amount of power
-        // that ended up in the second sample
+// Check for a Mode A/C reply with its first framing pulse at f1_sample
+// in the len samples of m, return its code and the F2 time in 60MHz cycles
+
+static inline __attribute__ ((always_inline)) bool detect_modeac(const uint16_t *m, uint32_t len, uint32_t f1_sample, unsigned noise_level, unsigned *modeac_out, unsigned *f2_clock_out) {
+    // Mode A/C messages should match this bit sequence:
+
+    // bit #     value
+    //   -1       0    quiet zone
+    //    0       1    framing pulse (F1)
+    //    1      C1
+    //    2      A1
+    //    3      C2
+    //    4      A2
+    //    5      C4
+    //    6      A4
+    //    7       0    quiet zone (X1)
+    //    8      B1
+    //    9      D1
+    //   10      B2
+    //   11      D2
+    //   12      B4
+    //   13      D4
+    //   14       1    framing pulse (F2)
+    //   15       0    quiet zone (X2)
+    //   16       0    quiet zone (X3)
+    //   17     SPI
+    //   18       0    quiet zone (X4)
+    //   19       0    quiet zone (X5)
+
+    // Look for a F1 and F2 pair,
+    // with F1 starting at offset f1_sample.
+
+    // the first framing pulse covers 3.5 samples:
+    //
+    // |----|        |----|
+    // | F1 |________| C1 |_
+    //
+    // | 0 | 1 | 2 | 3 | 4 |
+    //
+    // and there is some unknown phase offset of the
+    // leading edge e.g.:
+    //
+    //   |----|        |----|
+    // __| F1 |________| C1 |_
+    //
+    // | 0 | 1 | 2 | 3 | 4 |
+    //
+    // in theory the "on" period can straddle 3 samples
+    // but it's not a big deal as at most 4% of the power
+    // is in the third sample.
+
+    if (!(m[f1_sample - 1] < m[f1_sample + 0]))
+        return false; // not a rising edge
+
+    if (m[f1_sample + 2] > m[f1_sample + 0] || m[f1_sample + 2] > m[f1_sample + 1])
+        return false; // quiet part of bit wasn't sufficiently quiet
+
+    unsigned f1_level = (m[f1_sample + 0] + m[f1_sample + 1]) / 2;
+
+    if (noise_level * 2 > f1_level) {
+        // require 6dB above noise
+        return false;
+    }
 
-        float f1a_power = (float) m[f1_sample] * m[f1_sample];
-        float f1b_power = (float) m[f1_sample + 1] * m[f1_sample + 1];
-        float fraction = f1b_power / (f1a_power + f1b_power);
-        unsigned f1_clock = (unsigned) (25 * (f1_sample + fraction * fraction) + 0.5);
+    // estimate initial clock phase based on the amount of power
+    // that ended up in the second sample
 
-        // same again for F2
-        // F2 is 20.3us / 14 bit periods after F1
-        unsigned f2_clock = f1_clock + (87 * 14);
-        unsigned f2_sample = f2_clock / 25;
-        assert(f2_sample < mlen + mag->overlap);
+    float f1a_power = (float) m[f1_sample] * m[f1_sample];
+    float f1b_power = (float) m[f1_sample + 1] * m[f1_sample + 1];
+    float fraction = f1b_power / (f1a_power + f1b_power);
+    unsigned f1_clock = (unsigned) (25 * (f1_sample + fraction * fraction) + 0.5);
 
-        if (!(m[f2_sample - 1] < m[f2_sample + 0]))
-            continue;
+    // same again for F2
+    // F2 is 20.3us / 14 bit periods after F1
+    unsigned f2_clock = f1_clock + (87 * 14);
+    unsigned f2_sample = f2_clock / 25;
+    assert(f2_sample < len);
 
-        if (m[f2_sample + 2] > m[f2_sample + 0] || m[f2_sample + 2] > m[f2_sample + 1])
-            continue; // quiet part of bit wasn't sufficiently quiet
+    if (!(m[f2_sample - 1] < m[f2_sample + 0]))
+        return false;
 
-        unsigned f2_level = (m[f2_sample + 0] + m[f2_sample + 1]) / 2;
+    if (m[f2_sample + 2] > m[f2_sample + 0] || m[f2_sample + 2] > m[f2_sample + 1])
+        return false; // quiet part of bit wasn't sufficiently quiet
 
-        if (noise_level * 2 > f2_level) {
-            // require 6dB above noise
-            continue;
-        }
+    unsigned f2_level = (m[f2_sample + 0] + m[f2_sample + 1]) / 2;
 
-        unsigned f1f2_level = (f1_level > f2_level ? f1_level : f2_level);
+    if (noise_level * 2 > f2_level) {
+        // require 6dB above noise
+        return false;
+    }
 
-        float midpoint = sqrtf(noise_level * f1f2_level); // geometric mean of the two levels
-        unsigned signal_threshold = (unsigned) (midpoint * M_SQRT2 + 0.5); // +3dB
-        unsigned noise_threshold = (unsigned) (midpoint / M_SQRT2 + 0.5); // -3dB
+    unsigned f1f2_level = (f1_level > f2_level ? f1_level : f2_level);
 
-        // Looks like a real signal. Demodulate all the bits.
-        unsigned uncertain_bits = 0;
-        unsigned noisy_bits = 0;
-        unsigned bits = 0;
-        unsigned bit;
-        unsigned clock;
-        for (bit = 0, clock = f1_clock; bit < 20; ++bit, clock += 87) {
-            unsigned sample = clock / 25;
+    float midpoint = sqrtf(noise_level * f1f2_level); // geometric mean of the two levels
+    unsigned signal_threshold = (unsigned) (midpoint * M_SQRT2 + 0.5); // +3dB
+    unsigned noise_threshold = (unsigned) (midpoint / M_SQRT2 + 0.5); // -3dB
 
-            bits <<= 1;
-            noisy_bits <<= 1;
-            uncertain_bits <<= 1;
+    // Looks like a real signal. Demodulate all the bits.
+    unsigned uncertain_bits = 0;
+    unsigned noisy_bits = 0;
+    unsigned bits = 0;
+    unsigned bit;
+    unsigned clock;
+    for (bit = 0, clock = f1_clock; bit < 20; ++bit, clock += 87) {
+        unsigned sample = clock / 25;
 
-            // check for excessive noise in the quiet period
-            if (m[sample + 2] >= signal_threshold) {
-                noisy_bits |= 1;
-            }
+        bits <<= 1;
+        noisy_bits <<= 1;
+        uncertain_bits <<= 1;
 
-            // decide if this bit is on or off
-            if (m[sample + 0] >= signal_threshold || m[sample + 1] >= signal_threshold) {
-                bits |= 1;
-            } else if (m[sample + 0] > noise_threshold && m[sample + 1] > noise_threshold) {
-                /* not certain about this bit */
-                uncertain_bits |= 1;
-            } else {
-                /* this bit is off */
-            }
+        // check for excessive noise in the quiet period
+        if (m[sample + 2] >= signal_threshold) {
+            noisy_bits |= 1;
         }
 
-        // framing bits must be on
-        if ((bits & 0x80020) != 0x80020) {
-            continue;
+        // decide if this bit is on or off
+        if (m[sample + 0] >= signal_threshold || m[sample + 1] >= signal_threshold) {
+            bits |= 1;
+        } else if (m[sample + 0] > noise_threshold && m[sample + 1] > noise_threshold) {
+            /* not certain about this bit */
+            uncertain_bits |= 1;
+        } else {
+            /* this bit is off */
         }
+    }
 
-        // quiet bits must be off
-        if ((bits & 0x0101B) != 0) {
-            continue;
-        }
+    // framing bits must be on
+    if ((bits & 0x80020) != 0x80020) {
+        return false;
+    }
 
-        if (noisy_bits || uncertain_bits) {
-            continue;
-        }
+    // quiet bits must be off
+    if ((bits & 0x0101B) != 0) {
+        return false;
+    }
+
+    if (noisy_bits || uncertain_bits) {
+        return false;
+    }
 
-        // Convert to the form that we use elsewhere:
-        //  00 A4 A2 A1  00 B4 B2 B1  SPI C4 C2 C1  00 D4 D2 D1
-        unsigned modeac =
-                ((bits & 0x40000) ? 0x0010 : 0) | // C1
-                ((bits & 0x20000) ? 0x1000 : 0) | // A1
-                ((bits & 0x10000) ? 0x0020 : 0) | // C2
-                ((bits & 0x08000) ? 0x2000 : 0) | // A2
-                ((bits & 0x04000) ? 0x0040 : 0) | // C4
-                ((bits & 0x02000) ? 0x4000 : 0) | // A4
-                ((bits & 0x00800) ? 0x0100 : 0) | // B1
-                ((bits & 0x00400) ? 0x0001 : 0) | // D1
-                ((bits & 0x00200) ? 0x0200 : 0) | // B2
-                ((bits & 0x00100) ? 0x0002 : 0) | // D2
-                ((bits & 0x00080) ? 0x0400 : 0) | // B4
-                ((bits & 0x00040) ? 0x0004 : 0) | // D4
-                ((bits & 0x00004) ? 0x0080 : 0); // SPI
+    // Convert to the form that we use elsewhere:
+    //  00 A4 A2 A1  00 B4 B2 B1  SPI C4 C2 C1  00 D4 D2 D1
+    unsigned modeac =
+            ((bits & 0x40000) ? 0x0010 : 0) | // C1
+            ((bits & 0x20000) ? 0x1000 : 0) | // A1
+            ((bits & 0x10000) ? 0x0020 : 0) | // C2
+            ((bits & 0x08000) ? 0x2000 : 0) | // A2
+            ((bits & 0x04000) ? 0x0040 : 0) | // C4
+            ((bits & 0x02000) ? 0x4000 : 0) | // A4
+            ((bits & 0x00800) ? 0x0100 : 0) | // B1
+            ((bits & 0x00400) ? 0x0001 : 0) | // D1
+            ((bits & 0x00200) ? 0x0200 : 0) | // B2
+            ((bits & 0x00100) ? 0x0002 : 0) | // D2
+            ((bits & 0x00080) ? 0x0400 : 0) | // B4
+            ((bits & 0x00040) ? 0x0004 : 0) | // D4
+            ((bits & 0x00004) ? 0x0080 : 0); // SPI
 
 #ifdef MODEAC_DEBUG
-        draw_modeac(m, modeac, f1_clock, noise_threshold, signal_threshold, bits, noisy_bits, uncertain_bits);
+    draw_modeac(m, modeac, f1_clock, noise_threshold, signal_threshold, bits, noisy_bits, uncertain_bits);
 #endif
 
-        // This message looks good, submit it
+    *modeac_out = modeac;
+    *f2_clock_out = f2_clock;
+    return true;
+}
 
-        // For consistency with how the Beast / Radarcape does it,
-        // we report the timestamp at the second framing pulse (F2)
-        mm.timestampMsg = mag->sampleTimestamp + f2_clock / 5; // 60MHz -> 12MHz
+// Fill in mm for a Mode A/C reply found by detect_modeac()
 
-        // compute message receive time as block-start-time + difference in the 12MHz clock
-        mm.sysTimestampMsg = mag->sysTimestamp + receiveclock_ms_elapsed(mag->sampleTimestamp, mm.timestampMsg);
+static void modeac_message(struct mag_buf *mag, unsigned modeac, unsigned f2_clock, struct modesMessage *mm) {
+    memset(mm, 0, sizeof (*mm));
 
-        decodeModeAMessage(&mm, modeac);
+    // For consistency with how the Beast / Radarcape does it,
+    // we report the timestamp at the second framing pulse (F2)
+    mm->timestampMsg = mag->sampleTimestamp + f2_clock / 5; // 60MHz -> 12MHz
 
-        // Pass data to the next layer
-        useModesMessage(&mm);
+    // compute message receive time as block-start-time + difference in the 12MHz clock
+    mm->sysTimestampMsg = mag->sysTimestamp + receiveclock_ms_elapsed(mag->sampleTimestamp, mm->timestampMsg);
 
-        f1_sample += (20 * 87 / 25);
-        Modes.stats_current.demod_modeac++;
+    decodeModeAMessage(mm, modeac);
+}
+
+static bool queue_modeac(struct demod_slice *slice, uint32_t f1_sample, struct modesMessage *mm) {
+    if (slice->modeac_count == slice->modeac_size) {
+        unsigned newsize = slice->modeac_size ? slice->modeac_size * 2 : 64;
+        struct demod_modeac *newmodeac = realloc(slice->modeac, newsize * sizeof (*newmodeac));
+        if (!newmodeac) {
+            fprintf(stderr, "demod: can't allocate Mode A/C messages\n");
+            return false;
+        }
+        slice->modeac = newmodeac;
+        slice->modeac_size = newsize;
+    }
+    slice->modeac[slice->modeac_count].f1_sample = f1_sample;
+    slice->modeac[slice->modeac_count].mm = *mm;
+    slice->modeac_count++;
+    return true;
+}
+
+// Look for Mode A/C replies with F1 at slice->modeac_next .. end-1,
+// decode_candidates() merges them with the Mode S messages
+
+static void find_modeac(struct demod_slice *slice, uint32_t end) {
+    struct mag_buf *mag = slice->mag;
+    const uint16_t *m = mag->data;
+    unsigned noise_level = slice->modeac_noise_level;
+    struct modesMessage mm;
+    unsigned modeac, f2_clock;
+    uint32_t f1_sample;
+
+    for (f1_sample = slice->modeac_next; f1_sample < end; ++f1_sample) {
+        if (!detect_modeac(m, mag->validLength, f1_sample, noise_level, &modeac, &f2_clock))
+            continue;
+
+        // This message looks good, submit it
+        modeac_message(mag, modeac, f2_clock, &mm);
+        if (!queue_modeac(slice, f1_sample, &mm))
+            break;
+
+        // skip over the reply
+        f1_sample += MODEAC_SAMPLES - 1;
     }
+
+    slice->modeac_next = f1_sample;
 }
@@ -34,7 +34,10 @@
 
 struct mag_buf;
 
+void demodulate2400Init(void);
 void demodulate2400(struct mag_buf *mag);
-void demodulate2400AC(struct mag_buf *mag);
+void demodulate2400Submit(struct mag_buf *mag);
+struct mag_buf *demodulate2400Complete(void);
+void demodulate2400Cleanup(void);
 
 #endif
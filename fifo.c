@@ -28,138 +28,457 @@
 #include <string.h>
 #include <pthread.h>
 #include <assert.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+// Adaptive mode retires a buffer after this long without running short
+#define FIFO_SHRINK_IDLE_MS (60 * 1000)
+
+// The FIFO has exactly one producer, the SDR reader thread (fifo_acquire,
+// fifo_enqueue, fifo_drain), and one consumer, the main thread
+// (fifo_dequeue, fifo_release). Buffers travel from the producer to the
+// consumer through the "filled" ring and back through the "free" ring. Each
+// ring has a single writer and a single reader, so it needs no lock: the
+// writer publishes a slot with a release store of its tail index, the
+// reader consumes it with a release store of its head index.
+//
+// Every buffer is in at most one ring at a time, so a ring with room for
+// all buffers can never overflow.
+//
+// A thread that finds its ring empty sleeps on an event. Signalling an
+// event costs a syscall only if somebody is actually sleeping on it, so
+// while the demodulator keeps up no handoff enters the kernel.
+//
+// The magnitude data of all buffers lives in one sample ring that is
+// mapped twice, back to back, so that samples at ring offset k are also at
+// offset k + size. A buffer is a view into the ring starting `overlap`
+// samples before the write position: its overlap region is the tail of the
+// previous buffer, in place, and a view that runs off the end of the ring
+// continues seamlessly in the second mapping. Nothing is copied between
+// buffers.
+//
+// The ring has room for every buffer at its full size plus one overlap, so
+// a free buffer always has free ring space behind it: the oldest buffer
+// still in use reaches back at most one overlap before its own samples.
+//
+// In adaptive mode (max_count > buffer_count) only buffer_count buffers
+// circulate at first; the rest wait in a spare stack that only the
+// producer touches. When the producer finds no free buffer it takes a
+// spare instead of dropping the block, and after a long quiet spell it
+// retires one again. The sample ring is sized for max_count buffers, so
+// the space argument above holds at every depth.
+
+struct fifo_event {
+    atomic_uint seq; // bumped by every signal; the futex word
+    atomic_uint waiters; // number of threads sleeping, or about to sleep, on seq
+#if !defined(__linux__)
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+#endif
+};
+
+struct fifo_ring {
+    _Alignas(64) atomic_uint head; // next slot to read, written by the reader only
+    _Alignas(64) atomic_uint tail; // next slot to write, written by the writer only
+    _Alignas(64) struct fifo_event event; // signalled when the ring becomes non-empty
+    struct mag_buf **slots;
+    unsigned mask; // capacity - 1, capacity is a power of two
+};
+
+static struct fifo_ring fifo_filled; // buffers awaiting demodulation, producer -> consumer
+static struct fifo_ring fifo_free; // buffers available to the producer, consumer -> producer
+static atomic_bool fifo_halted; // true if queue has been halted
+
+static struct mag_buf **fifo_buffers; // all allocated buffers, for fifo_destroy
+static unsigned fifo_buffer_count;
+
+static struct mag_buf **fifo_spares; // buffers not in circulation, producer only
+static unsigned fifo_spare_count;
+static unsigned fifo_min_depth; // adaptive mode never shrinks below this
+static atomic_uint fifo_current_depth; // buffers in circulation, written by the producer
+static uint64_t fifo_busy_time; // last time the producer ran short of buffers, producer only
+
+static unsigned overlap_length; // desired overlap size in samples
+
+static uint16_t *sample_ring; // first of the two mappings of the sample ring
+static size_t sample_ring_size; // ring size in samples, a whole number of pages
+static uint64_t write_position; // next sample to be written, producer only
+
+static void event_init(struct fifo_event *ev) {
+    atomic_init(&ev->seq, 0);
+    atomic_init(&ev->waiters, 0);
+#if !defined(__linux__)
+    pthread_mutex_init(&ev->mutex, NULL);
+    pthread_cond_init(&ev->cond, NULL);
+#endif
+}
+
+// Wake every thread sleeping on the event. The seq increment is ordered
+// before the waiters check, and a sleeper increments waiters before its
+// final check of seq, so a sleeper either sees the new seq or is woken.
+
+static void event_signal(struct fifo_event *ev) {
+    atomic_fetch_add(&ev->seq, 1);
+    if (!atomic_load(&ev->waiters))
+        return;
+
+#if defined(__linux__)
+    syscall(SYS_futex, &ev->seq, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+#else
+    pthread_mutex_lock(&ev->mutex);
+    pthread_cond_broadcast(&ev->cond);
+    pthread_mutex_unlock(&ev->mutex);
+#endif
+}
+
+// Sleep until the event is signalled after `seq` was read, or until the
+// absolute CLOCK_MONOTONIC `deadline`. May return early; callers recheck
+// their condition.
+
+static void event_wait(struct fifo_event *ev, unsigned seq, const struct timespec *deadline) {
+    atomic_fetch_add(&ev->waiters, 1);
+#if defined(__linux__)
+    syscall(SYS_futex, &ev->seq, FUTEX_WAIT_BITSET_PRIVATE, seq, deadline, NULL, FUTEX_BITSET_MATCH_ANY);
+#else
+    // pthread condition timeouts are on CLOCK_REALTIME
+    struct timespec now_mono, abstime;
+    clock_gettime(CLOCK_MONOTONIC, &now_mono);
+    clock_gettime(CLOCK_REALTIME, &abstime);
+    abstime.tv_sec += deadline->tv_sec - now_mono.tv_sec;
+    abstime.tv_nsec += deadline->tv_nsec - now_mono.tv_nsec;
+    normalize_timespec(&abstime);
+
+    pthread_mutex_lock(&ev->mutex);
+    if (atomic_load(&ev->seq) == seq)
+        pthread_cond_timedwait(&ev->cond, &ev->mutex, &abstime);
+    pthread_mutex_unlock(&ev->mutex);
+#endif
+    atomic_fetch_sub(&ev->waiters, 1);
+}
+
+static bool ring_init(struct fifo_ring *ring, unsigned count) {
+    unsigned capacity = 1;
+    while (capacity < count)
+        capacity <<= 1;
 
-static pthread_mutex_t fifo_mutex = PTHREAD_MUTEX_INITIALIZER; // mutex protecting the queues
-static pthread_cond_t fifo_notempty_cond = PTHREAD_COND_INITIALIZER; // condition used to signal FIFO-not-empty
-static pthread_cond_t fifo_empty_cond = PTHREAD_COND_INITIALIZER; // condition used to signal FIFO-empty
-static pthread_cond_t fifo_free_cond = PTHREAD_COND_INITIALIZER; // condition used to signal freelist-not-empty
-static struct mag_buf *fifo_head; // head of queued buffers awaiting demodulation
-static struct mag_buf *fifo_tail; // tail of queued buffers awaiting demodulation
-static struct mag_buf *fifo_freelist; // freelist of preallocated buffers
-static bool fifo_halted; // true if queue has been halted
+    if (!(ring->slots = calloc(capacity, sizeof (ring->slots[0]))))
+        return false;
+
+    ring->mask = capacity - 1;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    event_init(&ring->event);
+    return true;
+}
 
-static unsigned overlap_length; // desired overlap size in samples (size of overlap_buffer)
-static uint16_t *overlap_buffer; // buffer used to save overlapping data
+static void ring_free(struct fifo_ring *ring) {
+    free(ring->slots);
+    ring->slots = NULL;
+}
+
+// Writer side
+
+static void ring_push(struct fifo_ring *ring, struct mag_buf *buf) {
+    unsigned tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+    assert(tail - atomic_load_explicit(&ring->head, memory_order_acquire) <= ring->mask);
+    ring->slots[tail & ring->mask] = buf;
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+
+    event_signal(&ring->event);
+}
+
+// Reader side (ring_empty may also be called by the writer)
+
+static bool ring_empty(struct fifo_ring *ring) {
+    return atomic_load_explicit(&ring->head, memory_order_acquire) == atomic_load_explicit(&ring->tail, memory_order_acquire);
+}
+
+static struct mag_buf *ring_pop(struct fifo_ring *ring) {
+    unsigned head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+
+    if (head == atomic_load_explicit(&ring->tail, memory_order_acquire))
+        return NULL;
+
+    struct mag_buf *buf = ring->slots[head & ring->mask];
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    return buf;
+}
+
+// Pop a buffer, waiting up to timeout_ms for one. NULL on timeout or halt.
+
+static struct mag_buf *ring_pop_wait(struct fifo_ring *ring, uint32_t timeout_ms) {
+    struct timespec deadline;
+    bool have_deadline = false;
+
+    for (;;) {
+        unsigned seq = atomic_load(&ring->event.seq);
+
+        if (atomic_load(&fifo_halted))
+            return NULL;
+
+        struct mag_buf *buf = ring_pop(ring);
+        if (buf || !timeout_ms)
+            return buf;
+
+        if (!have_deadline) {
+            clock_gettime(CLOCK_MONOTONIC, &deadline);
+            deadline.tv_sec += timeout_ms / 1000;
+            deadline.tv_nsec += (timeout_ms % 1000) * 1000000;
+            normalize_timespec(&deadline);
+            have_deadline = true;
+        } else {
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            if (now.tv_sec > deadline.tv_sec || (now.tv_sec == deadline.tv_sec && now.tv_nsec >= deadline.tv_nsec))
+                return NULL; // timed out
+        }
+
+        event_wait(&ring->event, seq, &deadline);
+    }
+}
+
+// Map `bytes` of fd twice, back to back, at a huge page aligned address
+// (so huge pages can back both halves).
+
+static void *mirror_map(int fd, size_t bytes) {
+    char *reserved, *base;
+    void *first, *second;
+
+    // reserve the address range for both mappings, then map the ring over each half
+    reserved = mmap(NULL, 2 * bytes + HOT_HUGE_PAGE_SIZE, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (reserved == MAP_FAILED)
+        return NULL;
+
+    base = (char *) (((uintptr_t) reserved + HOT_HUGE_PAGE_SIZE - 1) & ~((uintptr_t) HOT_HUGE_PAGE_SIZE - 1));
+    if (base > reserved)
+        munmap(reserved, base - reserved);
+    munmap(base + 2 * bytes, reserved + HOT_HUGE_PAGE_SIZE - base);
+
+    first = mmap(base, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+    second = mmap(base + bytes, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+
+    if (first != base || second != base + bytes) {
+        munmap(base, 2 * bytes);
+        return NULL;
+    }
+
+    return base;
+}
+
+// Map a zero filled ring of `bytes` twice, back to back
+
+static void *mirror_create(size_t bytes) {
+    int fd;
+    void *base;
+
+#if defined(__linux__) && defined(MFD_HUGETLB)
+    // with --pin-memory, back the ring with explicit huge pages if any are reserved
+    if (hot_memory_pinned() && bytes % HOT_HUGE_PAGE_SIZE == 0) {
+        if ((fd = memfd_create("readsb-samples", MFD_CLOEXEC | MFD_HUGETLB)) >= 0) {
+            base = (ftruncate(fd, bytes) == 0) ? mirror_map(fd, bytes) : NULL;
+            close(fd);
+            if (base) {
+                hot_pin(base, 2 * bytes, true, "FIFO sample ring");
+                return base;
+            }
+        }
+    }
+#endif
+
+#if defined(__linux__)
+    fd = memfd_create("readsb-samples", MFD_CLOEXEC);
+#else
+    char name[64];
+    snprintf(name, sizeof (name), "/readsb-samples-%ld", (long) getpid());
+    fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd >= 0)
+        shm_unlink(name);
+#endif
+    if (fd < 0) {
+        fprintf(stderr, "fifo: can't create sample ring: %s\n", strerror(errno));
+        return NULL;
+    }
+
+    if (ftruncate(fd, bytes) < 0) {
+        fprintf(stderr, "fifo: can't size sample ring: %s\n", strerror(errno));
+        close(fd);
+        return NULL;
+    }
+
+    base = mirror_map(fd, bytes);
+    close(fd);
+    if (!base) {
+        fprintf(stderr, "fifo: can't mirror sample ring: %s\n", strerror(errno));
+        return NULL;
+    }
+
+    hot_pin(base, 2 * bytes, false, "FIFO sample ring");
+    return base;
+}
 
 // Create the queue structures. Not threadsafe.
 
-bool fifo_create(unsigned buffer_count, unsigned buffer_size, unsigned overlap) {
-    if (!(overlap_buffer = calloc(overlap, sizeof (overlap_buffer[0])))) {
+bool fifo_create(unsigned buffer_count, unsigned max_count, unsigned buffer_size, unsigned overlap) {
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t bytes;
+
+    if (max_count < buffer_count)
+        max_count = buffer_count;
+    bytes = ((size_t) max_count * (buffer_size - overlap) + overlap) * sizeof (sample_ring[0]);
+
+    overlap_length = overlap;
+
+    if (hot_memory_pinned())
+        page = HOT_HUGE_PAGE_SIZE;
+    bytes = (bytes + page - 1) / page * page;
+    if (!(sample_ring = mirror_create(bytes))) {
+        goto fail;
+    }
+    sample_ring_size = bytes / sizeof (sample_ring[0]);
+    write_position = overlap;
+
+    if (!ring_init(&fifo_filled, max_count) || !ring_init(&fifo_free, max_count)) {
         goto nomem;
     }
 
-    overlap_length = overlap;
+    if (!(fifo_buffers = calloc(max_count, sizeof (fifo_buffers[0]))) || !(fifo_spares = calloc(max_count, sizeof (fifo_spares[0])))) {
+        goto nomem;
+    }
 
-    for (unsigned i = 0; i < buffer_count; ++i) {
+    atomic_init(&fifo_halted, false);
+
+    for (unsigned i = 0; i < max_count; ++i) {
         struct mag_buf *newbuf;
         if (!(newbuf = calloc(1, sizeof (*newbuf)))) {
             goto nomem;
         }
 
-        if (!(newbuf->data = calloc(buffer_size, sizeof (newbuf->data[0])))) {
-            free(newbuf);
-            goto nomem;
-        }
-
         newbuf->totalLength = buffer_size;
-        newbuf->next = fifo_freelist;
-        fifo_freelist = newbuf;
+        fifo_buffers[fifo_buffer_count++] = newbuf;
+        if (i < buffer_count)
+            ring_push(&fifo_free, newbuf);
+        else
+            fifo_spares[fifo_spare_count++] = newbuf;
     }
 
+    fifo_min_depth = buffer_count;
+    atomic_init(&fifo_current_depth, buffer_count);
+    fifo_busy_time = mstime();
+
     return true;
 
 nomem:
+    fprintf(stderr, "fifo: out of memory\n");
+fail:
     fifo_destroy();
     return false;
 }
 
-static void free_buffer_list(struct mag_buf *head) {
-    while (head) {
-        struct mag_buf *next = head->next;
-        free(head->data);
-        free(head);
-        head = next;
+void fifo_destroy() {
+    for (unsigned i = 0; i < fifo_buffer_count; ++i) {
+        free(fifo_buffers[i]);
+    }
+    free(fifo_buffers);
+    fifo_buffers = NULL;
+    fifo_buffer_count = 0;
+    free(fifo_spares);
+    fifo_spares = NULL;
+    fifo_spare_count = 0;
+
+    ring_free(&fifo_filled);
+    ring_free(&fifo_free);
+
+    if (sample_ring) {
+        munmap(sample_ring, 2 * sample_ring_size * sizeof (sample_ring[0]));
+        sample_ring = NULL;
     }
 }
 
-void fifo_destroy() {
-    free_buffer_list(fifo_head);
-    free_buffer_list(fifo_freelist);
-    fifo_freelist = NULL;
-    fifo_head = fifo_tail = NULL;
+void fifo_drain() {
+    // the consumer signals the free ring as it returns each buffer
+    for (;;) {
+        unsigned seq = atomic_load(&fifo_free.event.seq);
+        struct timespec deadline;
 
-    free(overlap_buffer);
-    overlap_buffer = NULL;
-}
+        if (ring_empty(&fifo_filled) || atomic_load(&fifo_halted))
+            return;
 
-void fifo_drain() {
-    pthread_mutex_lock(&fifo_mutex);
-    while (fifo_head && !fifo_halted) {
-        pthread_cond_wait(&fifo_empty_cond, &fifo_mutex);
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += 1;
+        event_wait(&fifo_free.event, seq, &deadline);
     }
-    pthread_mutex_unlock(&fifo_mutex);
 }
 
 void fifo_halt() {
-    pthread_mutex_lock(&fifo_mutex);
-
-    // Drain all enqueued buffers to the freelist
-    while (fifo_head) {
-        struct mag_buf *freebuf = fifo_head;
-        fifo_head = freebuf->next;
-
-        freebuf->next = fifo_freelist;
-        fifo_freelist = freebuf;
-    }
-
-    fifo_tail = NULL;
-    fifo_halted = true;
+    // Queued buffers are simply abandoned, fifo_destroy frees them from fifo_buffers
+    atomic_store(&fifo_halted, true);
 
     // wake all waiters
-    pthread_cond_broadcast(&fifo_notempty_cond);
-    pthread_cond_broadcast(&fifo_empty_cond);
-    pthread_cond_broadcast(&fifo_free_cond);
-    pthread_mutex_unlock(&fifo_mutex);
+    event_signal(&fifo_filled.event);
+    event_signal(&fifo_free.event);
 }
 
-struct mag_buf *fifo_acquire(uint32_t timeout_ms) {
-    struct timespec deadline;
-    if (timeout_ms) {
-        get_deadline(timeout_ms, &deadline);
-    }
+// Adaptive depth, producer side. Called with the buffer fifo_acquire got
+// (NULL if there was none); returns the buffer to hand out instead.
 
-    pthread_mutex_lock(&fifo_mutex);
+static struct mag_buf *adapt_depth(struct mag_buf *buf, uint32_t timeout_ms) {
+    unsigned depth = atomic_load_explicit(&fifo_current_depth, memory_order_relaxed);
+    uint64_t now;
 
-    struct mag_buf *result = NULL;
-    while (!fifo_halted && !fifo_freelist) {
-        if (!timeout_ms) {
-            // Non-blocking
-            goto done;
-        }
+    if (!buf) {
+        // only a caller that would otherwise drop samples makes the FIFO grow
+        if (timeout_ms || !fifo_spare_count || atomic_load(&fifo_halted))
+            return NULL;
 
-        // No free buffers, wait for one
-        if (pthread_cond_timedwait(&fifo_free_cond, &fifo_mutex, &deadline) < 0) {
-            if (errno != ETIMEDOUT)
-                return NULL; // unexpected error, mutex no longer held!
+        atomic_store_explicit(&fifo_current_depth, depth + 1, memory_order_relaxed);
+        fifo_busy_time = mstime();
+        return fifo_spares[--fifo_spare_count];
+    }
 
-            goto done; // timed out
-        }
+    if (depth <= fifo_min_depth)
+        return buf;
+
+    now = mstime();
+    if (ring_empty(&fifo_free)) {
+        // that was the last free buffer
+        fifo_busy_time = now;
+    } else if (now - fifo_busy_time >= FIFO_SHRINK_IDLE_MS) {
+        // plenty of buffers for a while, retire one (at most one per idle period)
+        fifo_spares[fifo_spare_count++] = buf;
+        atomic_store_explicit(&fifo_current_depth, depth - 1, memory_order_relaxed);
+        fifo_busy_time = now;
+        buf = ring_pop(&fifo_free);
     }
 
-    if (!fifo_halted) {
-        result = fifo_freelist;
-        fifo_freelist = result->next;
+    return buf;
+}
+
+struct mag_buf *fifo_acquire(uint32_t timeout_ms) {
+    struct mag_buf *result = ring_pop_wait(&fifo_free, timeout_ms);
+
+    if (fifo_spare_count || atomic_load_explicit(&fifo_current_depth, memory_order_relaxed) > fifo_min_depth)
+        result = adapt_depth(result, timeout_ms);
 
+    if (result) {
+        // view starting at the overlap, just before the write position
+        result->data = &sample_ring[(write_position - overlap_length) % sample_ring_size];
         result->overlap = overlap_length;
         result->validLength = result->overlap;
         result->sampleTimestamp = 0;
         result->sysTimestamp = 0;
         result->flags = 0;
-        result->next = NULL;
     }
 
-done:
-    pthread_mutex_unlock(&fifo_mutex);
     return result;
 }
 
@@ -167,85 +486,39 @@ void fifo_enqueue(struct mag_buf *buf) {
     assert(buf->validLength <= buf->totalLength);
     assert(buf->validLength >= overlap_length);
 
-    pthread_mutex_lock(&fifo_mutex);
-
-    if (fifo_halted) {
-        // Shutting down, just return the buffer to the freelist.
-        buf->next = fifo_freelist;
-        fifo_freelist = buf;
-        goto done;
-    }
-
-    // Populate the overlap region
-    if (buf->flags & MAGBUF_DISCONTINUOUS) {
-        // This buffer is discontinuous to the previous, so the overlap region is not valid; zero it out
-        memset(buf->data, 0, overlap_length * sizeof (buf->data[0]));
-    } else {
-        memcpy(buf->data, overlap_buffer, overlap_length * sizeof (buf->data[0]));
+    if (atomic_load(&fifo_halted)) {
+        // Shutting down, drop the buffer.
+        return;
     }
 
-    // Save the tail of the buffer for next time
-    memcpy(overlap_buffer, &buf->data[buf->validLength - overlap_length], overlap_length * sizeof (overlap_buffer[0]));
+    // The overlap region already holds the tail of the previous buffer;
+    // the next buffer starts right after this one
+    write_position += buf->validLength - overlap_length;
 
     // enqueue and tell the main thread
-    buf->next = NULL;
-    if (!fifo_head) {
-        fifo_head = fifo_tail = buf;
-        pthread_cond_signal(&fifo_notempty_cond);
-    } else {
-        fifo_tail->next = buf;
-    }
-
-done:
-    pthread_mutex_unlock(&fifo_mutex);
+    ring_push(&fifo_filled, buf);
 }
 
 struct mag_buf *fifo_dequeue(uint32_t timeout_ms) {
-    struct timespec deadline;
-    if (timeout_ms) {
-        get_deadline(timeout_ms, &deadline);
-    }
-
-    pthread_mutex_lock(&fifo_mutex);
-
-    struct mag_buf *result = NULL;
-    while (!fifo_head && !fifo_halted) {
-        if (!timeout_ms) {
-            // Non-blocking
-            goto done;
-        }
+    struct mag_buf *result = ring_pop_wait(&fifo_filled, timeout_ms);
 
-        // No data pending, wait for some
-        if (pthread_cond_timedwait(&fifo_notempty_cond, &fifo_mutex, &deadline) < 0) {
-            if (errno != ETIMEDOUT)
-                return NULL; // unexpected error, mutex no longer held!
-
-            goto done; // timed out
-        }
+    // This buffer is discontinuous to the previous, so the overlap region is not valid; zero it out.
+    // It is the tail of the previous buffer, so this must wait until the consumer is done with that.
+    if (result && (result->flags & MAGBUF_DISCONTINUOUS)) {
+        memset(result->data, 0, overlap_length * sizeof (result->data[0]));
     }
 
-    if (!fifo_halted) {
-        result = fifo_head;
-        fifo_head = result->next;
-        result->next = NULL;
-        if (!fifo_head) {
-            fifo_tail = NULL;
-            pthread_cond_broadcast(&fifo_empty_cond);
-        }
-    }
-
-done:
-    pthread_mutex_unlock(&fifo_mutex);
     return result;
 }
 
 void fifo_release(struct mag_buf *buf) {
-    pthread_mutex_lock(&fifo_mutex);
-    if (!fifo_freelist) {
-        pthread_cond_signal(&fifo_free_cond);
-    }
-    buf->next = fifo_freelist;
-    fifo_freelist = buf;
-    pthread_mutex_unlock(&fifo_mutex);
+    ring_push(&fifo_free, buf);
 }
 
+unsigned fifo_depth() {
+    return atomic_load_explicit(&fifo_current_depth, memory_order_relaxed);
+}
+
+unsigned fifo_queued() {
+    return atomic_load_explicit(&fifo_filled.tail, memory_order_relaxed) - atomic_load_explicit(&fifo_filled.head, memory_order_relaxed);
+}
@@ -52,10 +52,13 @@ typedef enum {
 // The demodulator looks for signals starting at offsets 0 .. validLength-overlap-1,
 // with the trailing overlap region allowing decoding of a maximally-sized message that starts
 // at validLength-overlap-1. Signals that start after this point are not decoded, but they will
-// be copied into the starting overlap of the next buffer and decoded on the next iteration.
+// be in the starting overlap of the next buffer and decoded on the next iteration.
+//
+// "data" is a view into the FIFO's sample ring, and consecutive buffers overlap in memory:
+// the starting overlap of a buffer is the trailing overlap of the previous one, not a copy.
 
 struct mag_buf {
-    uint16_t *data; // Magnitude data, starting with overlap from the previous block
+    uint16_t *data; // Magnitude data, starting with overlap from the previous block (view into the sample ring)
     unsigned totalLength; // Maximum number of samples (allocated size of "data")
     unsigned validLength; // Number of valid samples in "data", including overlap samples
     unsigned overlap; // Number of leading overlap samples at the start of "data";
@@ -68,16 +71,21 @@ struct mag_buf {
     double mean_level; // Mean of normalized (0..1) signal level
     double mean_power; // Mean of normalized (0..1) power level
     unsigned dropped; // (approx) number of dropped samples
-
-    struct mag_buf *next; // linked list forward link
 };
 
+// The FIFO is lock-free and supports exactly one producer thread, calling
+// fifo_acquire(), fifo_enqueue() and fifo_drain(), and one consumer thread,
+// calling fifo_dequeue() and fifo_release(). fifo_halt() may be called from
+// any thread.
+
 // Create the queue structures. Not threadsafe. Returns true on success.
 //
 //   buffer_count - the number of buffers to preallocate
+//   max_count    - if larger than buffer_count, the FIFO grows up to this many buffers
+//                  when fifo_acquire(0) finds none free, and shrinks back when idle
 //   buffer_size  - the size of each magnitude buffer, in samples, including overlap
 //   overlap      - the number of samples to overlap between adjacent buffers
-bool fifo_create(unsigned buffer_count, unsigned buffer_size, unsigned overlap);
+bool fifo_create(unsigned buffer_count, unsigned max_count, unsigned buffer_size, unsigned overlap);
 
 // Destroy the fifo structures allocated in magbuf_fifo_create. Not threadsafe; ensure all FIFO users
 // are done before calling.
@@ -86,9 +94,9 @@ void fifo_destroy();
 // Block until the FIFO is empty.
 void fifo_drain();
 
-// Mark the FIFO as halted. Move any buffers in FIFO to the freelist immediately.
+// Mark the FIFO as halted. Any buffers in the FIFO are discarded.
 // Future calls to magbuf_acquire() will immediately return NULL.
-// Future calls to magbuf_produce() will immediately put the produced buffer on the freelist.
+// Future calls to magbuf_produce() will immediately discard the produced buffer.
 // Future alls to magbuf_consume() will immediately return NULL; if there are
 //   existing calls waiting on data, they will be immediately awoken and return NULL.
 void fifo_halt();
@@ -116,7 +124,13 @@ void fifo_enqueue(struct mag_buf *buf);
 //   for more data; return NULL if no data arrives within the timeout.
 struct mag_buf *fifo_dequeue(uint32_t timeout_ms);
 
-// Release a buffer previously returned by fifo_acquire() or fifo_pop() back to the freelist.
+// Release a buffer previously returned by fifo_dequeue() back to the freelist.
 void fifo_release(struct mag_buf *buf);
 
+// Number of buffers currently in circulation (the FIFO depth).
+unsigned fifo_depth();
+
+// Number of filled buffers waiting for the consumer. Consumer side.
+unsigned fifo_queued();
+
 #endif
@@ -55,6 +55,8 @@ static struct argp_option options[] = {
     {"interactive", OptInteractive, 0, 0, "Interactive mode refreshing data on screen. Implies --throttle", 1},
     {"raw", OptRaw, 0, 0, "Show only messages hex values", 1},
     {"preamble-threshold", OptPreambleThreshold, "<"stringize(PREAMBLE_THRESHOLD_MIN)"-"stringize(PREAMBLE_THRESHOLD_MAX)">", 0, "lower threshold --> more CPU usage (default: "stringize(PREAMBLE_THRESHOLD_DEFAULT)", pi zero / pi 1: "stringize(PREAMBLE_THRESHOLD_PIZERO)", hot CPU "stringize(PREAMBLE_THRESHOLD_HOT)")", 1},
+    {"demod-threads", OptDemodThreads, "<n>", 0, "Number of threads used for demodulation (default: 1)", 1},
+    {"sample-rate", OptSampleRate, "<MHz>", 0, "Sample rate: 2.0, 2.4, 6.0 or 8.0 (default: 2.4, Mode A/C only at 2.4)", 1},
     {"no-modeac-auto", OptNoModeAcAuto, 0, 0, "Don't enable Mode A/C if requested by a Beast connection", 1},
     {"forward-mlat", OptForwardMlat, 0, 0, "Allow forwarding of received mlat results to output ports", 1},
     {"mlat", OptMlat, 0, 0, "Display raw messages in Beast ASCII mode", 1},
@@ -66,6 +68,11 @@ static struct argp_option options[] = {
     {"snip", OptSnip, "<level>", 0, "Strip IQ file removing samples < level", 1},
     {"quiet", OptQuiet, 0, 0, "Disable output. Use for daemon applications", 1},
     {"dcfilter", OptDcFilter, 0, 0, "Apply a 1Hz DC filter to input data (requires more CPU)", 1},
+    {"iq-autotune", OptIqAutotune, 0, 0, "Benchmark the IQ sample converters at startup and use the fastest", 1},
+    {"fifo-depth", OptFifoDepth, "<buffers>", 0, "Number of sample blocks buffered for the demodulator (default: 12)", 1},
+    {"fifo-max-depth", OptFifoMaxDepth, "<buffers>", 0, "Grow the sample buffer up to this many blocks instead of dropping samples, shrink back when idle", 1},
+    {"fifo-block", OptFifoBlock, "<samples>", 0, "Samples per block read from the SDR (default: 131072, multiple of 16384)", 1},
+    {"pin-memory", OptPinMemory, 0, 0, "Put sample buffers and lookup tables on locked huge pages, on the demodulator's NUMA node", 1},
     {"enable-biastee", OptBiasTee, 0, 0, "Enable bias tee on supporting interfaces (default: disabled)", 1},
     {"write-output", OptOutputDir, "<dir>", 0, "Periodically write output to <dir> (for external webserver)", 1},
     {"write-output-every", OptOutputTime, "<t>", 0, "Write output every t seconds (default 1)", 1},
@@ -94,6 +101,7 @@ static struct argp_option options[] = {
     {"net-heartbeat", OptNetHeartbeat, "<rate>", 0, "TCP heartbeat rate in seconds (default: 60 sec; 0 to disable)", 2},
     {"net-buffer", OptNetBuffer, "<n>", 0, "TCP buffer size 64Kb * (2^n) (default: n=2, 256Kb)", 2},
     {"net-verbatim", OptNetVerbatim, 0, 0, "Forward messages unchanged", 2},
+    {"net-slow-policy", OptNetSlowPolicy, "<service=policy,...>", 0, "What to do with a client whose SendQ is full: disconnect (default), drop-oldest, drop-newest or coalesce (send only the latest position per aircraft until it caught up). Services: beast_out, beast_reduce_out, raw_out, sbs_out (e.g. beast_out=drop-oldest,sbs_out=coalesce)", 2},
 #ifdef ENABLE_RTLSDR
     {0, 0, 0, 0, "RTL-SDR options:", 3},
     {0, 0, 0, OPTION_DOC, "use with --device-type rtlsdr", 3},
@@ -128,15 +136,21 @@ static struct argp_option options[] = {
 
     {0, 0, 0, 0, "ifile-specific options:", 7},
     {0, 0, 0, OPTION_DOC, "use with --ifile", 7},
-    {"ifile", OptIfileName, "<path>", 0, "Read samples from given file ('-' for stdin)", 7},
+    {"ifile", OptIfileName, "<path>", 0, "Read samples from given file ('-' for stdin), gzip/xz/zstd compressed if built with support", 7},
     {"iformat", OptIfileFormat, "<type>", 0, "Set sample format (UC8, SC16, SC16Q11)", 7},
     {"throttle", OptIfileThrottle, 0, 0, "Process samples at the original capture speed", 7},
+    {"ifile-compression", OptIfileCompression, "<type>", 0, "Set input compression (auto, none, gzip, xz, zstd; default auto: detect from the first bytes)", 7},
+    {"batch", OptIfileBatch, "<blocks>", 0, "Without --throttle, demodulate up to <blocks> sample blocks in parallel (2.4MHz only)", 7},
 #ifdef ENABLE_PLUTOSDR
     {0, 0, 0, 0, "ADALM-Pluto SDR options:", 8},
     {0, 0, 0, OPTION_DOC, "use with --device-type plutosdr", 8},
     {"pluto-uri", OptPlutoUri, "<USB uri>", 0, "Create USB context from this URI.(eg. usb:1.2.5)", 8},
     {"pluto-network", OptPlutoNetwork, "<hostname or IP>", 0, "Hostname or IP to create networks context. (default pluto.local)", 8},
 #endif
+    {0, 0, 0, 0, "beastfile-specific options:", 9},
+    {0, 0, 0, OPTION_DOC, "use with --device-type beastfile", 9},
+    {"beastfile", OptBeastFileName, "<path>", 0, "Replay Beast binary messages from given file ('-' for stdin)", 9},
+    {"beastfile-speed", OptBeastFileSpeed, "<factor>", 0, "Replay at <factor> times the recorded speed by the 12MHz timestamps, 1 for real time (default 0: as fast as possible)", 9},
 #endif
     {0, 0, 0, 0, "Help options:", 100},
     { 0}
@@ -309,9 +309,30 @@ static int correct_aa_field(uint32_t *addr, struct errorinfo *ei) {
 static unsigned char all_zeros[14] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
 
 int scoreModesMessage(unsigned char *msg, int validbits) {
-    int msgtype, msgbits, crc, iid;
-    uint32_t addr;
-    struct errorinfo *ei;
+    int msgbits;
+
+    if (validbits < 56)
+        return -2;
+
+    msgbits = modesMessageLenByType(getbits(msg, 1, 5));
+
+    if (validbits < msgbits)
+        return -2;
+
+    return scoreModesMessageSyndrome(msg, validbits, modesChecksum(msg, msgbits));
+}
+
+// The part of scoreModesMessage() that does not depend on the ICAO filter:
+// returns -2 if the message can already be rejected based on its content
+// and CRC syndrome, 0 if it has to be scored. For DF11/17/18 *ei is set to
+// the error diagnosis to pass on to scoreModesMessagePrechecked(). As it
+// only reads the message and the CRC tables, it is safe to call from any
+// thread.
+
+int precheckModesMessage(unsigned char *msg, int validbits, uint32_t crc, struct errorinfo **ei) {
+    int msgtype, msgbits;
+
+    *ei = NULL;
 
     if (validbits < 56)
         return -2;
@@ -325,7 +346,34 @@ int scoreModesMessage(unsigned char *msg, int validbits) {
     if (!memcmp(all_zeros, msg, msgbits / 8))
         return -2;
 
-    crc = modesChecksum(msg, msgbits);
+    switch (msgtype) {
+        case 0: case 4: case 5: case 16: case 20: case 21:
+        case 24: case 25: case 26: case 27: case 28: case 29: case 30: case 31:
+            return 0; // address/parity, depends on the ICAO filter
+
+        case 11: // All-call reply
+            *ei = modesChecksumDiagnose(crc & 0xffff80, msgbits);
+            return (*ei && (*ei)->errors <= 1) ? 0 : -2;
+
+        case 17: // Extended squitter
+        case 18: // Extended squitter/non-transponder
+            *ei = modesChecksumDiagnose(crc, msgbits);
+            return *ei ? 0 : -2;
+
+        default:
+            // unknown message type
+            return -2;
+    }
+}
+
+// Score a message that passed the length and content checks, given its
+// CRC syndrome and, for DF11 (without the IID bits) and DF17/18, the
+// result of modesChecksumDiagnose()
+
+static int scoreModesMessageDiagnosed(unsigned char *msg, int msgtype, uint32_t syndrome, struct errorinfo *ei) {
+    int crc = syndrome;
+    int iid;
+    uint32_t addr;
 
     switch (msgtype) {
         case 0: // short air-air surveillance
@@ -344,10 +392,8 @@ int scoreModesMessage(unsigned char *msg, int validbits) {
 
         case 11: // All-call reply
             iid = crc & 0x7f;
-            crc = crc & 0xffff80;
             addr = getbits(msg, 9, 32);
 
-            ei = modesChecksumDiagnose(crc, msgbits);
             if (!ei)
                 return -2; // can't correct errors
 
@@ -375,7 +421,6 @@ int scoreModesMessage(unsigned char *msg, int validbits) {
 
         case 17: // Extended squitter
         case 18: // Extended squitter/non-transponder
-            ei = modesChecksumDiagnose(crc, msgbits);
             if (!ei)
                 return -2; // can't correct errors
 
@@ -384,7 +429,7 @@ int scoreModesMessage(unsigned char *msg, int validbits) {
             correct_aa_field(&addr, ei);
 
             if (icaoFilterTest(addr))
-                return 1800 / (ei->errors + 1);
+                return MODES_MAX_SCORE / (ei->errors + 1);
             else
                 return 1400 / (ei->errors + 1);
 
@@ -408,6 +453,40 @@ int scoreModesMessage(unsigned char *msg, int validbits) {
     }
 }
 
+// Same as scoreModesMessage(), with the CRC syndrome of the message
+// already computed (e.g. while demodulating)
+
+int scoreModesMessageSyndrome(unsigned char *msg, int validbits, uint32_t syndrome) {
+    int msgtype, msgbits;
+    struct errorinfo *ei = NULL;
+
+    if (validbits < 56)
+        return -2;
+
+    msgtype = getbits(msg, 1, 5); // Downlink Format
+    msgbits = modesMessageLenByType(msgtype);
+
+    if (validbits < msgbits)
+        return -2;
+
+    if (!memcmp(all_zeros, msg, msgbits / 8))
+        return -2;
+
+    if (msgtype == 11)
+        ei = modesChecksumDiagnose(syndrome & 0xffff80, msgbits);
+    else if (msgtype == 17 || msgtype == 18)
+        ei = modesChecksumDiagnose(syndrome, msgbits);
+
+    return scoreModesMessageDiagnosed(msg, msgtype, syndrome, ei);
+}
+
+// Same as scoreModesMessage(), for a message that passed
+// precheckModesMessage(), with the diagnosis that returned
+
+int scoreModesMessagePrechecked(unsigned char *msg, uint32_t syndrome, struct errorinfo *ei) {
+    return scoreModesMessageDiagnosed(msg, getbits(msg, 1, 5), syndrome, ei);
+}
+
 //
 //=========================================================================
 //
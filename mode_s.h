@@ -27,11 +27,18 @@
 
 #include <assert.h>
 
+// Highest score scoreModesMessage() returns (DF17 with good CRC from a known aircraft),
+// see the table in mode_s.c
+#define MODES_MAX_SCORE 1800
+
 //
 // Functions exported from mode_s.c
 //
 int modesMessageLenByType(int type);
 int scoreModesMessage(unsigned char *msg, int validbits);
+int scoreModesMessageSyndrome(unsigned char *msg, int validbits, uint32_t syndrome);
+int precheckModesMessage(unsigned char *msg, int validbits, uint32_t crc, struct errorinfo **ei);
+int scoreModesMessagePrechecked(unsigned char *msg, uint32_t syndrome, struct errorinfo *ei);
 int decodeModesMessage(struct modesMessage *mm, unsigned char *msg);
 void displayModesMessage(struct modesMessage *mm);
 void useModesMessage(struct modesMessage *mm);
@@ -64,6 +64,10 @@
 #include <netdb.h>
 #include <poll.h>
 #include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/uio.h>
+#include <stdatomic.h>
 
 #include <linux/serial.h>
 
@@ -75,19 +79,35 @@
 //
 // 1) We only rely on the kernel buffers for our I/O without any kind of
 //    user space buffering.
-// 2) We don't register any kind of event handler, from time to time a
-//    function gets called and we accept new connections. All the rest is
-//    handled via non-blocking I/O and manually polling clients to see if
-//    they have something new to share with us when reading is needed.
+// 2) Listeners, clients and outgoing connections in progress are registered
+//    with a level-triggered epoll instance. From time to time a function
+//    gets called that collects the ready sockets and accepts, reads or
+//    flushes only those. Clients wait for EPOLLOUT only while their SendQ
+//    holds data the kernel wouldn't take.
+// 3) Output services are handled by a network thread with an epoll
+//    instance of its own, so slow clients never hold up demodulation. The
+//    main thread still formats the output into the writer buffers and hands
+//    each full buffer over through a bounded lock-free queue; if the network
+//    thread falls that far behind, buffers are dropped rather than waited
+//    for. Input services stay on the main thread, which decodes what they
+//    deliver.
+// 4) A buffer handed to the network thread is not copied per client: each
+//    client's SendQ holds references to the shared buffers and sends them
+//    with writev(), so fanning out to many clients costs no more memory
+//    traffic than one.
+// 5) Clients of the per-message outputs may ask for a subset of the
+//    messages with a FILTER line. Clients asking for the same filter share
+//    writers of their own, so each message is matched once per distinct
+//    filter and formatted once for all of its clients.
 
 static int handleBeastCommand(struct client *c, char *p, int remote);
 static int decodeBinMessage(struct client *c, char *p, int remote);
 static int decodeHexMessage(struct client *c, char *hex, int remote);
 static int decodeSbsLine(struct client *c, char *line, int remote);
 
-static void send_raw_heartbeat(struct net_service *service);
-static void send_beast_heartbeat(struct net_service *service);
-static void send_sbs_heartbeat(struct net_service *service);
+static void send_raw_heartbeat(struct net_writer *writer);
+static void send_beast_heartbeat(struct net_writer *writer);
+static void send_sbs_heartbeat(struct net_writer *writer);
 
 static void writeFATSVEvent(struct modesMessage *mm, struct aircraft *a);
 static void writeFATSVPositionUpdate(float lat, float lon, float alt);
@@ -96,6 +116,280 @@ static void autoset_modeac();
 static int hexDigitVal(int c);
 static void *pthreadGetaddrinfo(void *param);
 static void flushClient(struct client *c, uint64_t now);
+static void clientFreeSendQ(struct client *c);
+static void *netThreadEntryPoint(void *arg);
+
+#define MODES_NET_EVENTS 64 // epoll events handled per wait
+#define MODES_NET_QUEUE_CHUNKS 64 // writer buffers in flight to the network thread, a power of two
+#define MODES_NET_IOV 64 // SendQ chunks passed to one writev()
+#define MODES_NET_BEAST_BATCH 64 // Beast input frames decoded at a time
+#define MODES_NET_CHUNK_POSITIONS 64 // position messages recorded per buffer for NET_SLOW_COALESCE
+#define MODES_NET_STALL_DROP_MS 60000 // clients that may drop output are only disconnected when they take nothing for this long
+#define MODES_NET_MAX_FILTERS 64 // distinct output filters
+
+// The sockets of a service are only ever touched by the thread of its reactor
+
+struct net_reactor {
+    int epfd; // epoll instance, created on first use
+    uint64_t accept_resume; // when to listen again after running out of file descriptors, 0 = listening
+    char aneterr[ANET_ERR_LEN]; // error messages of the anet calls of this thread
+    // system calls, collected into the stats by the main thread
+    atomic_uint epoll_wait;
+    atomic_uint read;
+    atomic_uint write;
+    atomic_uint accept;
+    atomic_uint epoll_ctl;
+    atomic_uint sendq_high; // most data queued for one client
+};
+
+static struct net_reactor net_main = {.epfd = -1}; // input services, main thread
+static struct net_reactor net_output = {.epfd = -1}; // output services, network thread
+
+// A writer buffer on its way to the network thread. The network thread
+// queues the same chunk to every client of the writer's service; the chunk
+// goes back to the main thread once each of them has sent it. Usually that
+// happens right away. If a client can't take it all, the data is moved to a
+// buffer of its own size and the chunk lives on until the last client is
+// done with it, while the main thread gets the full sized buffer back.
+
+struct net_chunk {
+    struct net_writer *writer; // whose clients get the data
+    uint64_t queued; // when it was handed over, monotonic microseconds
+    int len;
+    int refs; // SendQs holding the chunk, plus one while it is being delivered (network thread only)
+    char *data; // MODES_OUT_BUF_SIZE bytes while the chunk is in the pool, len bytes once held by a slow client
+    int messages; // number of messages in data
+    int npositions;
+    struct net_chunk_pos {
+        uint32_t key; // see output_position_key
+        uint16_t offset;
+        uint16_t len;
+    } positions[MODES_NET_CHUNK_POSITIONS]; // position messages, only recorded for NET_SLOW_COALESCE writers
+};
+
+// An entry of a client's SendQ
+
+struct net_chunk_ref {
+    struct net_chunk *chunk;
+    int offset; // bytes of the chunk already sent
+};
+
+// The latest position messages of each aircraft, held back from a
+// NET_SLOW_COALESCE client until its SendQ has room again. Open addressing
+// on the message key.
+
+struct net_latest {
+    uint32_t key;
+    int len; // 0 = free slot
+    int alloc;
+    char *data;
+};
+
+struct net_coalesce {
+    struct net_latest *slots;
+    int alloc; // a power of two
+    int count;
+    int bytes; // in all held messages
+};
+
+// Single producer, single consumer ring of chunks, as the ones in fifo.c
+
+struct net_ring {
+    _Alignas(64) atomic_uint head; // next slot to read, written by the reader only
+    _Alignas(64) atomic_uint tail; // next slot to write, written by the writer only
+    struct net_chunk *slots[MODES_NET_QUEUE_CHUNKS];
+};
+
+static struct net_ring net_filled; // buffers to send, main thread -> network thread
+static struct net_ring net_free; // sent buffers for reuse, network thread -> main thread
+
+static pthread_t net_thread;
+static bool net_thread_started;
+static atomic_bool net_thread_stop;
+static atomic_bool net_thread_sleeping; // the network thread waits in epoll_wait, wake it through net_wakeup
+static struct net_epoll net_wakeup = {NET_EPOLL_WAKEUP, -1, NULL}; // eventfd
+
+// hand-off stats of the network thread, collected by the main thread
+static atomic_uint net_queue_chunks;
+static atomic_uint_fast64_t net_queue_latency_sum;
+static atomic_uint_fast64_t net_queue_latency_max;
+
+static atomic_int net_modeac; // Mode A/C requested by a Beast output client
+
+// Set by modesQueueOutput() while it writes a message that carries a
+// position: aircraft address and CPR format, so NET_SLOW_COALESCE keeps the
+// latest odd and even one. 0 for any other message.
+static uint32_t output_position_key;
+
+static const char *net_slow_policy_names[] = { "disconnect", "drop-oldest", "drop-newest", "coalesce" };
+
+// The outputs a client can filter, in the order of net_filter.writers
+
+enum {
+    NET_FILTER_BEAST,
+    NET_FILTER_BEAST_REDUCE,
+    NET_FILTER_RAW,
+    NET_FILTER_SBS,
+    NET_FILTER_OUTPUTS
+};
+
+static struct net_writer *net_filter_outputs[NET_FILTER_OUTPUTS] = { &Modes.beast_out, &Modes.beast_reduce_out, &Modes.raw_out, &Modes.sbs_out };
+
+// An output filter, asked for by a client with
+//
+//   FILTER allow=<hex>,... deny=<hex>,... df=<n>,... bbox=<south>,<west>,<north>,<east> radius=<lat>,<lon>,<nmi> signal=<dBFS>
+//
+// as the first line it sends, any of the terms may be left out. The network
+// thread parses the filters and puts them in net_filters, the main thread
+// writes their output. A filter is shared by every client asking for the
+// same, its slot is reused once the last of them is gone:
+//
+//   ACTIVE    the network thread found it without clients -> UNUSED
+//   UNUSED    a client asked for it again -> ACTIVE, or the main thread
+//             stopped writing to it -> RELEASED
+//   RELEASED  the network thread sent what was queued before -> FREE
+//   FREE      the network thread puts the next new filter here -> ACTIVE
+
+struct net_filter {
+    char *key; // canonical form of the criteria
+    uint32_t *allow; // sorted addresses, none = any
+    int nallow;
+    uint32_t *deny; // sorted addresses
+    int ndeny;
+    uint32_t df_mask; // downlink formats, 0 = any
+    bool bbox; // the tracked position must be inside the box
+    double south, west, north, east; // west > east crosses the antimeridian
+    bool radius; // the tracked position must be within radius_m of lat, lon
+    double lat, lon, radius_m;
+    double min_signal; // power in the range [0..1], 0 = any
+    struct net_writer writers[NET_FILTER_OUTPUTS];
+};
+
+enum {
+    NET_FILTER_FREE, // also slots never used
+    NET_FILTER_ACTIVE,
+    NET_FILTER_UNUSED,
+    NET_FILTER_RELEASED
+};
+
+struct net_filter_slot {
+    struct net_filter *filter; // written by the network thread outside of ACTIVE and UNUSED
+    atomic_int state; // NET_FILTER_*, a new filter is published with release order
+    bool ready; // the main thread set up the writers of filter
+};
+
+static struct net_filter_slot net_filters[MODES_NET_MAX_FILTERS]; // no more than 64, see netFiltersReclaim()
+static atomic_int net_filter_count; // slots in use, written by the network thread
+
+static int netEpollFd(struct net_reactor *r) {
+    if (r->epfd < 0 && (r->epfd = epoll_create1(EPOLL_CLOEXEC)) < 0) {
+        fprintf(stderr, "Fatal: epoll_create1 failed: %s\n", strerror(errno));
+        exit(1);
+    }
+    return r->epfd;
+}
+
+static void netEpollCtl(struct net_reactor *r, int op, struct net_epoll *ep, uint32_t events) {
+    struct epoll_event ev;
+
+    ev.events = events;
+    ev.data.ptr = ep;
+    atomic_fetch_add_explicit(&r->epoll_ctl, 1, memory_order_relaxed);
+    if (epoll_ctl(netEpollFd(r), op, ep->fd, &ev) < 0 && op != EPOLL_CTL_DEL) {
+        fprintf(stderr, "epoll_ctl failed on fd %d: %s\n", ep->fd, strerror(errno));
+    }
+}
+
+static void netCount(atomic_uint *counter) {
+    atomic_fetch_add_explicit(counter, 1, memory_order_relaxed);
+}
+
+// Wait for EPOLLOUT only while there is queued data the socket didn't take
+
+static void clientWantWrite(struct client *c, int want) {
+    if (c->epoll_out == want)
+        return;
+    c->epoll_out = want;
+    netEpollCtl(c->service->reactor, EPOLL_CTL_MOD, &c->epoll, EPOLLIN | (want ? EPOLLOUT : 0));
+}
+
+static void listenersEpoll(struct net_reactor *r, int op) {
+    for (struct net_service *s = Modes.services; s; s = s->next) {
+        if (s->reactor != r)
+            continue;
+        for (int i = 0; i < s->listener_count; ++i)
+            netEpollCtl(r, op, &s->listener_epoll[i], EPOLLIN);
+    }
+}
+
+static uint64_t netMicros(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static struct net_chunk *netChunkNew(void) {
+    struct net_chunk *chunk = calloc(1, sizeof (struct net_chunk));
+
+    if (chunk && !(chunk->data = malloc(MODES_OUT_BUF_SIZE))) {
+        free(chunk);
+        return NULL;
+    }
+    return chunk;
+}
+
+static void netChunkFree(struct net_chunk *chunk) {
+    free(chunk->data);
+    free(chunk);
+}
+
+// Drop a SendQ's reference, the last one frees a chunk no longer in the pool
+
+static void netChunkRelease(struct net_chunk *chunk) {
+    if (--chunk->refs == 0)
+        netChunkFree(chunk);
+}
+
+// Writer side
+
+static void netRingPush(struct net_ring *ring, struct net_chunk *chunk) {
+    unsigned tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+    assert(tail - atomic_load_explicit(&ring->head, memory_order_acquire) < MODES_NET_QUEUE_CHUNKS);
+    ring->slots[tail & (MODES_NET_QUEUE_CHUNKS - 1)] = chunk;
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+}
+
+static unsigned netRingCount(struct net_ring *ring) {
+    return atomic_load_explicit(&ring->tail, memory_order_relaxed) - atomic_load_explicit(&ring->head, memory_order_acquire);
+}
+
+// Reader side
+
+static struct net_chunk *netRingPop(struct net_ring *ring) {
+    unsigned head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+
+    if (head == atomic_load_explicit(&ring->tail, memory_order_acquire))
+        return NULL;
+
+    struct net_chunk *chunk = ring->slots[head & (MODES_NET_QUEUE_CHUNKS - 1)];
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    return chunk;
+}
+
+// Wake the network thread if it sleeps. The thread announces its sleep
+// before its last look at the queue, and we look at the announcement only
+// after publishing, so either it sees the new chunk or we see it sleeping.
+
+static void netThreadWake(void) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_exchange(&net_thread_sleeping, false)) {
+        uint64_t one = 1;
+        if (write(net_wakeup.fd, &one, sizeof (one)) < 0 && errno != EAGAIN)
+            fprintf(stderr, "Network thread wakeup failed: %s\n", strerror(errno));
+    }
+}
 
 //
 //=========================================================================
@@ -131,13 +425,15 @@ struct net_service *serviceInit(const char *descr, struct net_writer *writer, he
     service->read_mode = mode;
     service->read_handler = handler;
     service->clients = NULL;
+    service->reactor = writer ? &net_output : &net_main;
 
     if (service->writer) {
-        if (!service->writer->data) {
-            if (!(service->writer->data = malloc(MODES_OUT_BUF_SIZE))) {
+        if (!service->writer->chunk) {
+            if (!(service->writer->chunk = netChunkNew())) {
                 fprintf(stderr, "Out of memory allocating output buffer for service %s\n", descr);
                 exit(1);
             }
+            service->writer->data = service->writer->chunk->data;
         }
 
         service->writer->service = service;
@@ -152,7 +448,7 @@ struct net_service *serviceInit(const char *descr, struct net_writer *writer, he
 // Create a client attached to the given service using the provided socket FD
 
 struct client *createSocketClient(struct net_service *service, int fd) {
-    anetSetSendBuffer(Modes.aneterr, fd, (MODES_NET_SNDBUF_SIZE << Modes.net_sndbuf_size));
+    anetSetSendBuffer(service->reactor->aneterr, fd, (MODES_NET_SNDBUF_SIZE << Modes.net_sndbuf_size));
     return createGenericClient(service, fd);
 }
 
@@ -160,10 +456,10 @@ struct client *createSocketClient(struct net_service *service, int fd) {
 
 struct client *createGenericClient(struct net_service *service, int fd) {
     struct client *c;
-    uint64_t now = mstime();
+    uint64_t now = system_mstime();
 
-    if (anetNonBlock(Modes.aneterr, fd) == ANET_ERR) {
-        fprintf(stderr, "%s fd %d: Failed to set non-block: %s\n", service->descr, fd, Modes.aneterr);
+    if (anetNonBlock(service->reactor->aneterr, fd) == ANET_ERR) {
+        fprintf(stderr, "%s fd %d: Failed to set non-block: %s\n", service->descr, fd, service->reactor->aneterr);
     }
 
     if (!service || fd == -1) {
@@ -181,46 +477,64 @@ struct client *createGenericClient(struct net_service *service, int fd) {
     c->fd = fd;
     c->buflen = 0;
     c->modeac_requested = 0;
+    c->handshake = 0;
+    c->writer = service->writer;
     c->last_flush = now;
     c->last_send = now;
     c->sendq_len = 0;
     c->sendq_max = 0;
     c->sendq = NULL;
+    c->sendq_head = 0;
+    c->sendq_count = 0;
+    c->sendq_alloc = 0;
+    c->sendq_high = 0;
     c->con = NULL;
+    c->epoll.type = NET_EPOLL_CLIENT;
+    c->epoll.fd = fd;
+    c->epoll.owner = c;
+    c->epoll_out = 0;
 
     if (service->writer) {
-        if (!(c->sendq = malloc(MODES_NET_SNDBUF_SIZE << Modes.net_sndbuf_size))) {
+        c->sendq_alloc = 16; // doubles as needed
+        if (!(c->sendq = malloc(c->sendq_alloc * sizeof (struct net_chunk_ref)))) {
             fprintf(stderr, "Out of memory allocating client SendQ\n");
             exit(1);
         }
         // Have to keep track of this manually
         c->sendq_max = MODES_NET_SNDBUF_SIZE << Modes.net_sndbuf_size;
+        atomic_fetch_add_explicit(&c->writer->clients, 1, memory_order_relaxed);
+        for (int i = 0; i < NET_FILTER_OUTPUTS; i++) {
+            if (service->writer == net_filter_outputs[i])
+                c->handshake = 1; // may ask for a filter
+        }
     }
     service->clients = c;
+    netEpollCtl(service->reactor, EPOLL_CTL_ADD, &c->epoll, EPOLLIN);
 
     ++service->connections;
-    if (service->writer && service->connections == 1) {
-        service->writer->lastWrite = now; // suppress heartbeat initially
-    }
 
     return c;
 }
 
 // Timer callback checking periodically whether the push service lost its server
-// connection and requires a re-connect.
+// connection and requires a re-connect. Each reactor looks after the connectors
+// of its own services.
 
-void serviceReconnectCallback(uint64_t now) {
+static void serviceReconnectCallback(struct net_reactor *r, uint64_t now) {
     // Loop through the connectors, and
     //  - If it's not connected:
-    //    - If it's "connecting", check to see if the fd is ready
+    //    - If it's "connecting", check whether it timed out
     //    - Otherwise, if enough time has passed, try reconnecting
 
     for (int i = 0; i < Modes.net_connectors_count; i++) {
         struct net_connector *con = Modes.net_connectors[i];
+        if (con->service->reactor != r)
+            continue;
         if (!con->connected) {
             if (con->connecting) {
-                // Check to see...
-                checkServiceConnected(con);
+                // Completion is reported by epoll, only check for the timeout here
+                if (now >= con->connect_timeout)
+                    checkServiceConnected(con);
             } else {
                 if (con->next_reconnect <= now) {
                     serviceConnect(con);
@@ -245,7 +559,7 @@ struct client *checkServiceConnected(struct net_connector *con) {
 
     if (rv == 0) {
         // If we've exceeded our connect timeout, bail but try again.
-        if (mstime() >= con->connect_timeout) {
+        if (system_mstime() >= con->connect_timeout) {
             fprintf(stderr, "%s: Connection timed out: %s:%s port %s\n",
                     con->service->descr, con->address, con->port, con->resolved_addr);
             con->connecting = 0;
@@ -277,6 +591,8 @@ struct client *checkServiceConnected(struct net_connector *con) {
     // If we're able to create this "client", save the sockaddr info and print a msg
     struct client *c;
 
+    // the client registers the fd again for its own events
+    netEpollCtl(con->service->reactor, EPOLL_CTL_DEL, &con->epoll, 0);
     c = createSocketClient(con->service, con->fd);
     if (!c) {
         con->connecting = 0;
@@ -320,32 +636,32 @@ struct client *serviceConnect(struct net_connector *con) {
             }
 
             if (pthread_create(&con->thread, NULL, pthreadGetaddrinfo, con)) {
-                con->next_reconnect = mstime() + 15000;
+                con->next_reconnect = system_mstime() + 15000;
                 fprintf(stderr, "%s: pthread_create ERROR for %s port %s: %s\n", con->service->descr, con->address, con->port, strerror(errno));
                 return NULL;
             }
 
             con->gai_request_in_progress = 1;
-            con->next_reconnect = mstime() + 10;
+            con->next_reconnect = system_mstime() + 10;
             return NULL;
         } else {
 
             if (pthread_mutex_trylock(con->mutex)) {
                 // couldn't acquire lock, request not finished
-                con->next_reconnect = mstime() + 50;
+                con->next_reconnect = system_mstime() + 50;
                 return NULL;
             }
 
             if (pthread_join(con->thread, NULL)) {
                 fprintf(stderr, "%s: pthread_join ERROR for %s port %s: %s\n", con->service->descr, con->address, con->port, strerror(errno));
-                con->next_reconnect = mstime() + 15000;
+                con->next_reconnect = system_mstime() + 15000;
                 return NULL;
             }
             con->gai_request_in_progress = 0;
 
             if (con->gai_error) {
                 fprintf(stderr, "%s: Name resolution for %s failed: %s\n", con->service->descr, con->address, gai_strerror(con->gai_error));
-                con->next_reconnect = mstime() + Modes.net_connector_delay;
+                con->next_reconnect = system_mstime() + Modes.net_connector_delay;
                 return NULL;
             }
 
@@ -368,23 +684,27 @@ struct client *serviceConnect(struct net_connector *con) {
     }
 
     if (!con->try_addr->ai_next) {
-        con->next_reconnect = mstime() + Modes.net_connector_delay;
+        con->next_reconnect = system_mstime() + Modes.net_connector_delay;
     } else {
-        con->next_reconnect = mstime() + 100;
+        con->next_reconnect = system_mstime() + 100;
     }
 
-    fd = anetTcpNonBlockConnectAddr(Modes.aneterr, con->try_addr);
+    fd = anetTcpNonBlockConnectAddr(con->service->reactor->aneterr, con->try_addr);
     if (fd == ANET_ERR) {
         fprintf(stderr, "%s: Connection to %s%s port %s failed: %s\n",
-                con->service->descr, con->address, con->resolved_addr, con->port, Modes.aneterr);
+                con->service->descr, con->address, con->resolved_addr, con->port, con->service->reactor->aneterr);
         return NULL;
     }
 
     con->connecting = 1;
-    con->connect_timeout = mstime() + 10 * 1000; // 10 sec TODO: Move to var
+    con->connect_timeout = system_mstime() + 10 * 1000; // 10 sec TODO: Move to var
     con->fd = fd;
+    con->epoll.type = NET_EPOLL_CONNECTOR;
+    con->epoll.fd = fd;
+    con->epoll.owner = con;
+    netEpollCtl(con->service->reactor, EPOLL_CTL_ADD, &con->epoll, EPOLLOUT);
 
-    if (anetTcpKeepAlive(Modes.aneterr, fd) != ANET_OK) {
+    if (anetTcpKeepAlive(con->service->reactor->aneterr, fd) != ANET_OK) {
         fprintf(stderr, "%s: Unable to set keepalive: connection to %s port %s ...\n", con->service->descr, con->address, con->port);
     }
 
@@ -451,6 +771,17 @@ void serviceListen(struct net_service *service, char *bind_addr, char *bind_port
         }
     }
 
+    if (!(service->listener_epoll = calloc(n, sizeof (struct net_epoll)))) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    for (int i = 0; i < n; ++i) {
+        service->listener_epoll[i].type = NET_EPOLL_LISTENER;
+        service->listener_epoll[i].fd = fds[i];
+        service->listener_epoll[i].owner = service;
+        netEpollCtl(service->reactor, EPOLL_CTL_ADD, &service->listener_epoll[i], EPOLLIN);
+    }
+
     service->listener_count = n;
     service->listener_fds = fds;
 }
@@ -463,6 +794,60 @@ struct net_service *makeFatsvOutputService(void) {
     return serviceInit("FATSV TCP output", &Modes.fatsv_out, NULL, READ_MODE_IGNORE, NULL, NULL);
 }
 
+// Parse --net-slow-policy service=policy[,service=policy...]
+// vrs_out always disconnects: its JSON documents span several buffers, and
+// dropping one of them would leave the client a broken document.
+
+bool netParseSlowPolicy(const char *arg) {
+    char *args = strdup(arg);
+    char *saveptr = NULL;
+    bool ok = true;
+
+    for (char *tok = strtok_r(args, ",", &saveptr); tok && ok; tok = strtok_r(NULL, ",", &saveptr)) {
+        char *policy = strchr(tok, '=');
+        struct net_writer *writer;
+        unsigned i;
+
+        if (!policy) {
+            fprintf(stderr, "--net-slow-policy: Wrong format: %s\n", tok);
+            fprintf(stderr, "Correct syntax: --net-slow-policy=service=policy[,service=policy...]\n");
+            ok = false;
+            break;
+        }
+        *policy++ = '\0';
+
+        if (strcmp(tok, "beast_out") == 0)
+            writer = &Modes.beast_out;
+        else if (strcmp(tok, "beast_reduce_out") == 0)
+            writer = &Modes.beast_reduce_out;
+        else if (strcmp(tok, "raw_out") == 0)
+            writer = &Modes.raw_out;
+        else if (strcmp(tok, "sbs_out") == 0)
+            writer = &Modes.sbs_out;
+        else {
+            fprintf(stderr, "--net-slow-policy: Unknown service: %s\n", tok);
+            fprintf(stderr, "Supported services: beast_out, beast_reduce_out, raw_out, sbs_out\n");
+            ok = false;
+            break;
+        }
+
+        for (i = 0; i < sizeof (net_slow_policy_names) / sizeof (net_slow_policy_names[0]); i++) {
+            if (strcmp(policy, net_slow_policy_names[i]) == 0)
+                break;
+        }
+        if (i == sizeof (net_slow_policy_names) / sizeof (net_slow_policy_names[0])) {
+            fprintf(stderr, "--net-slow-policy: Unknown policy: %s\n", policy);
+            fprintf(stderr, "Supported policies: disconnect, drop-oldest, drop-newest, coalesce\n");
+            ok = false;
+            break;
+        }
+        writer->slow_policy = (net_slow_policy_t) i;
+    }
+
+    free(args);
+    return ok;
+}
+
 void modesInitNet(void) {
     struct net_service *beast_out;
     struct net_service *beast_reduce_out;
@@ -505,11 +890,6 @@ void modesInitNet(void) {
     beast_in = makeBeastInputService();
     serviceListen(beast_in, Modes.net_bind_address, Modes.net_input_beast_ports);
 
-    /* Beast input from local Modes-S Beast via USB */
-    if (Modes.sdr_type == SDR_MODESBEAST || Modes.sdr_type == SDR_GNS) {
-        createGenericClient(beast_in, Modes.beast_fd);
-    }
-
     for (int i = 0; i < Modes.net_connectors_count; i++) {
         struct net_connector *con = Modes.net_connectors[i];
         if (strcmp(con->protocol, "beast_out") == 0)
@@ -536,60 +916,80 @@ void modesInitNet(void) {
         }
         pthread_mutex_lock(con->mutex);
     }
-    serviceReconnectCallback(now);
+    serviceReconnectCallback(&net_main, now);
+    serviceReconnectCallback(&net_output, now);
+
+    // Start the network thread for the output services
+    for (int i = 0; i < MODES_NET_QUEUE_CHUNKS; i++) {
+        struct net_chunk *chunk = netChunkNew();
+        if (!chunk) {
+            fprintf(stderr, "Out of memory allocating network output queue\n");
+            exit(1);
+        }
+        netRingPush(&net_free, chunk);
+    }
+    if ((net_wakeup.fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0) {
+        fprintf(stderr, "Fatal: eventfd failed: %s\n", strerror(errno));
+        exit(1);
+    }
+    netEpollCtl(&net_output, EPOLL_CTL_ADD, &net_wakeup, EPOLLIN);
+    if (pthread_create(&net_thread, NULL, netThreadEntryPoint, NULL)) {
+        fprintf(stderr, "Fatal: unable to start the network thread: %s\n", strerror(errno));
+        exit(1);
+    }
+    net_thread_started = true;
 }
 
 
 //
 //=========================================================================
 //
-// This function gets called from time to time when the decoding thread is
-// awakened by new data arriving. This usually happens a few times every second
+// This function gets called when a listening socket is readable,
+// i.e. has connections waiting to be accepted
 //
 
-static uint64_t modesAcceptClients(uint64_t now) {
+static void modesAcceptClients(struct net_service *s, int listen_fd, uint64_t now) {
     int fd;
-    struct net_service *s;
     struct client *c;
+    struct sockaddr_storage storage;
+    struct sockaddr *saddr = (struct sockaddr *) &storage;
+    socklen_t slen = sizeof (storage);
+
+    for (;;) {
+        netCount(&s->reactor->accept);
+        fd = anetGenericAccept(s->reactor->aneterr, listen_fd, saddr, &slen);
+        if (fd < 0)
+            break;
 
-    for (s = Modes.services; s; s = s->next) {
-        int i;
-        for (i = 0; i < s->listener_count; ++i) {
-            struct sockaddr_storage storage;
-            struct sockaddr *saddr = (struct sockaddr *) &storage;
-            socklen_t slen = sizeof (storage);
-
-            while ((fd = anetGenericAccept(Modes.aneterr, s->listener_fds[i], saddr, &slen)) >= 0) {
-                c = createSocketClient(s, fd);
-                if (c) {
-                    // We created the client, save the sockaddr info and 'hostport'
-                    getnameinfo(saddr, slen,
-                            c->host, sizeof (c->host),
-                            c->port, sizeof (c->port),
-                            NI_NUMERICHOST | NI_NUMERICSERV);
-
-                    if (anetTcpKeepAlive(Modes.aneterr, fd) != ANET_OK) {
-                        fprintf(stderr, "%s: Unable to set keepalive on connection from %s port %s (fd %d)\n", c->service->descr, c->host, c->port, fd);
-                    }
-                } else {
-                    fprintf(stderr, "%s: Fatal: createSocketClient shouldn't fail!\n", s->descr);
-                    exit(1);
-                }
-            }
+        c = createSocketClient(s, fd);
+        if (c) {
+            // We created the client, save the sockaddr info and 'hostport'
+            getnameinfo(saddr, slen,
+                    c->host, sizeof (c->host),
+                    c->port, sizeof (c->port),
+                    NI_NUMERICHOST | NI_NUMERICSERV);
 
-            if (errno != EMFILE && errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK) {
-                fprintf(stderr, "%s: Error accepting new connection: %s\n", s->descr, Modes.aneterr);
+            if (anetTcpKeepAlive(s->reactor->aneterr, fd) != ANET_OK) {
+                fprintf(stderr, "%s: Unable to set keepalive on connection from %s port %s (fd %d)\n", c->service->descr, c->host, c->port, fd);
             }
+        } else {
+            fprintf(stderr, "%s: Fatal: createSocketClient shouldn't fail!\n", s->descr);
+            exit(1);
         }
+        slen = sizeof (storage);
     }
-    // temporarily stop trying to accept new clients if we are limited by file descriptors
-    if (errno == EMFILE) {
-        fprintf(stderr, "Accepting new connections suspended for 3 seconds: %s\n", Modes.aneterr);
-        return (now + 3000);
+
+    if (errno != EMFILE && errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK) {
+        fprintf(stderr, "%s: Error accepting new connection: %s\n", s->descr, s->reactor->aneterr);
     }
 
-    // only check for new clients not sooner than 150 ms from now
-    return (now + 150);
+    // temporarily stop trying to accept new clients if we are limited by file descriptors,
+    // the listeners would stay readable and wake us up all the time otherwise
+    if (errno == EMFILE && !s->reactor->accept_resume) {
+        fprintf(stderr, "Accepting new connections suspended for 3 seconds: %s\n", s->reactor->aneterr);
+        listenersEpoll(s->reactor, EPOLL_CTL_DEL);
+        s->reactor->accept_resume = now + 3000;
+    }
 }
 
 //
@@ -604,33 +1004,111 @@ static void modesCloseClient(struct client *c) {
         return;
     }
 
-    if (Modes.exit == 0 && c->fd == Modes.beast_fd) {
-        fprintf(stderr, "Closing client: USB handle failed?\n");
-        Modes.exit = 3;
+    struct net_reactor *r = c->service->reactor;
+    if (c->dropped_messages) {
+        fprintf(stderr, "%s: %llu messages (%llu bytes) were dropped for %s port %s (fd %d)\n",
+                c->service->descr, (unsigned long long) c->dropped_messages, (unsigned long long) c->dropped_bytes,
+                c->host, c->port, c->fd);
     }
-
     anetCloseSocket(c->fd);
     c->service->connections--;
+    if (c->writer)
+        atomic_fetch_sub_explicit(&c->writer->clients, 1, memory_order_relaxed);
     if (c->con) {
         // Clean this up and set the next_reconnect timer for another try.
         // If the connection had been established and the connect didn't fail,
         // only wait a short time to reconnect
         c->con->connecting = 0;
         c->con->connected = 0;
-        c->con->next_reconnect = mstime() + Modes.net_connector_delay / 10;
+        c->con->next_reconnect = system_mstime() + Modes.net_connector_delay / 10;
     }
 
     // mark it as inactive and ready to be freed
     c->fd = -1;
     c->service = NULL;
+    c->writer = NULL;
     c->modeac_requested = 0;
+    clientFreeSendQ(c);
+
+    if (r == &net_output)
+        autoset_modeac();
+}
+
+//
+// Release the chunks still queued for a client and the positions held back
+//
+
+static void clientFreeSendQ(struct client *c) {
+    for (int i = 0; i < c->sendq_count; i++)
+        netChunkRelease(c->sendq[(c->sendq_head + i) & (c->sendq_alloc - 1)].chunk);
+    c->sendq_head = 0;
+    c->sendq_count = 0;
     c->sendq_len = 0;
-    if (c->sendq) {
-        free(c->sendq);
-        c->sendq = NULL;
+    free(c->sendq);
+    c->sendq = NULL;
+
+    if (c->coalesce) {
+        for (int i = 0; i < c->coalesce->alloc; i++)
+            free(c->coalesce->slots[i].data);
+        free(c->coalesce->slots);
+        free(c->coalesce);
+        c->coalesce = NULL;
     }
+}
 
-    autoset_modeac();
+//
+// Queue a chunk for a client
+//
+
+static void clientQueueChunk(struct client *c, struct net_chunk *chunk) {
+    if (c->sendq_count == c->sendq_alloc) {
+        // Double the ring. The entries before the head wrapped around, move
+        // them up behind the old end so the queue is contiguous again.
+        int alloc = c->sendq_alloc * 2;
+        struct net_chunk_ref *sendq = realloc(c->sendq, alloc * sizeof (struct net_chunk_ref));
+        if (!sendq) {
+            fprintf(stderr, "Out of memory allocating client SendQ\n");
+            exit(1);
+        }
+        memcpy(sendq + c->sendq_alloc, sendq, c->sendq_head * sizeof (struct net_chunk_ref));
+        c->sendq = sendq;
+        c->sendq_alloc = alloc;
+    }
+    struct net_chunk_ref *ref = &c->sendq[(c->sendq_head + c->sendq_count) & (c->sendq_alloc - 1)];
+    ref->chunk = chunk;
+    ref->offset = 0;
+    c->sendq_count++;
+    c->sendq_len += chunk->len;
+    chunk->refs++;
+
+    if (c->sendq_len > c->sendq_high)
+        c->sendq_high = c->sendq_len;
+    // the peak since the last stats collection, only the network thread writes it
+    struct net_reactor *r = c->service->reactor;
+    if ((unsigned) c->sendq_len > atomic_load_explicit(&r->sendq_high, memory_order_relaxed))
+        atomic_store_explicit(&r->sendq_high, c->sendq_len, memory_order_relaxed);
+}
+
+//
+// Drop the first nwritten bytes of a client's SendQ, they have been sent
+//
+
+static void clientSent(struct client *c, int nwritten) {
+    c->sendq_len -= nwritten;
+    while (nwritten > 0) {
+        struct net_chunk_ref *ref = &c->sendq[c->sendq_head];
+        int left = ref->chunk->len - ref->offset;
+        if (nwritten < left) {
+            ref->offset += nwritten;
+            break;
+        }
+        nwritten -= left;
+        netChunkRelease(ref->chunk);
+        c->sendq_head = (c->sendq_head + 1) & (c->sendq_alloc - 1);
+        c->sendq_count--;
+    }
+    if (!c->sendq_count)
+        c->sendq_head = 0;
 }
 
 //
@@ -638,17 +1116,25 @@ static void modesCloseClient(struct client *c) {
 //
 
 static void flushClient(struct client *c, uint64_t now) {
-    int towrite = c->sendq_len;
-    char *psendq = c->sendq;
+    struct net_reactor *r = c->service->reactor;
+    struct iovec iov[MODES_NET_IOV];
     int loops = 0;
     int max_loops = 2;
     int total_nwritten = 0;
     int done = 0;
 
     do {
-        int nwritten = write(c->fd, psendq, towrite);
+        int iovcnt = 0;
+        for (; iovcnt < c->sendq_count && iovcnt < MODES_NET_IOV; iovcnt++) {
+            struct net_chunk_ref *ref = &c->sendq[(c->sendq_head + iovcnt) & (c->sendq_alloc - 1)];
+            iov[iovcnt].iov_base = ref->chunk->data + ref->offset;
+            iov[iovcnt].iov_len = ref->chunk->len - ref->offset;
+        }
+
+        int nwritten = writev(c->fd, iov, iovcnt);
         int err = errno;
         loops++;
+        netCount(&r->write);
         // If we get -1, it's only fatal if it's not EAGAIN/EWOULDBLOCK
         if (nwritten < 0) {
             if (err != EAGAIN && err != EWOULDBLOCK) {
@@ -662,11 +1148,9 @@ static void flushClient(struct client *c, uint64_t now) {
             if (nwritten > 0) {
                 // We've written something, add it to the total
                 total_nwritten += nwritten;
-                // Advance buffer
-                psendq += nwritten;
-                towrite -= nwritten;
+                clientSent(c, nwritten);
             }
-            if (total_nwritten == c->sendq_len) {
+            if (c->sendq_len == 0) {
                 done = 1;
             }
         }
@@ -674,20 +1158,216 @@ static void flushClient(struct client *c, uint64_t now) {
 
     if (total_nwritten > 0) {
         c->last_send = now; // If we wrote anything, update this.
-        if (total_nwritten == c->sendq_len) {
-            c->sendq_len = 0;
-        } else {
-            c->sendq_len -= total_nwritten;
-            memmove((void*) c->sendq, c->sendq + total_nwritten, towrite);
-        }
         c->last_flush = now;
     }
 
-    // If writing has failed for 5 seconds, disconnect.
-    if (c->last_flush + 5000 < now) {
-        fprintf(stderr, "%s: Unable to send data, disconnecting: %s port %s (fd %d, SendQ %d)\n", c->service->descr, c->host, c->port, c->fd, c->sendq_len);
+    // If writing has failed for 5 seconds, disconnect. Clients that may
+    // drop output instead of being disconnected get longer.
+    if (c->service && c->last_flush + (c->service->writer->slow_policy == NET_SLOW_DISCONNECT ? 5000 : MODES_NET_STALL_DROP_MS) < now) {
+        fprintf(stderr, "%s: Unable to send data, disconnecting: %s port %s (fd %d, SendQ %d, SendQ high %d)\n", c->service->descr, c->host, c->port, c->fd, c->sendq_len, c->sendq_high);
         modesCloseClient(c);
     }
+
+    if (c->service)
+        clientWantWrite(c, c->sendq_len > 0);
+}
+
+//
+// Count output a slow client didn't get
+//
+
+static void clientDropped(struct client *c, int bytes, int messages) {
+    struct net_writer *writer = c->service->writer;
+
+    if (!bytes && !messages)
+        return;
+    if (!c->dropped_bytes) {
+        fprintf(stderr, "%s: SendQ full, %s: %s port %s (fd %d, SendQ %d)\n",
+                c->service->descr, net_slow_policy_names[c->service->writer->slow_policy],
+                c->host, c->port, c->fd, c->sendq_len);
+    }
+    c->dropped_bytes += bytes;
+    c->dropped_messages += messages;
+    atomic_fetch_add_explicit(&writer->dropped_bytes, bytes, memory_order_relaxed);
+    atomic_fetch_add_explicit(&writer->dropped_messages, messages, memory_order_relaxed);
+}
+
+//
+// NET_SLOW_DROP_OLDEST: drop queued chunks that weren't started yet, oldest
+// first, until len more bytes fit
+//
+
+static void clientDropOldest(struct client *c, int len) {
+    int mask = c->sendq_alloc - 1;
+
+    while (c->sendq_len + len >= c->sendq_max && c->sendq_count) {
+        struct net_chunk_ref *head = &c->sendq[c->sendq_head];
+        struct net_chunk_ref *victim = head;
+
+        if (head->offset) {
+            // partly sent, the client would get a broken message; drop the next one
+            if (c->sendq_count < 2)
+                break;
+            victim = &c->sendq[(c->sendq_head + 1) & mask];
+        }
+
+        struct net_chunk *chunk = victim->chunk;
+        clientDropped(c, chunk->len, chunk->messages);
+        c->sendq_len -= chunk->len;
+        netChunkRelease(chunk);
+
+        // the partly sent head moves up into the free slot
+        if (victim != head)
+            *victim = *head;
+        c->sendq_head = (c->sendq_head + 1) & mask;
+        c->sendq_count--;
+    }
+}
+
+//
+// NET_SLOW_COALESCE: the slot of a position message key, free if not held yet
+//
+
+static struct net_latest *coalesceSlot(struct net_coalesce *co, uint32_t key) {
+    int mask = co->alloc - 1;
+    int i = (key * 2654435761U) & mask;
+
+    while (co->slots[i].len && co->slots[i].key != key)
+        i = (i + 1) & mask;
+    return &co->slots[i];
+}
+
+//
+// NET_SLOW_COALESCE: hold back the latest position messages of a chunk
+// instead of queueing it, everything else in it is dropped
+//
+
+static void clientCoalesce(struct client *c, struct net_chunk *chunk) {
+    struct net_coalesce *co = c->coalesce;
+    int held = 0;
+    int kept = 0;
+
+    if (!co) {
+        if (!(co = c->coalesce = calloc(1, sizeof (struct net_coalesce))) ||
+                !(co->slots = calloc(co->alloc = 64, sizeof (struct net_latest)))) {
+            fprintf(stderr, "Out of memory allocating client SendQ\n");
+            exit(1);
+        }
+    }
+
+    for (int i = 0; i < chunk->npositions; i++) {
+        struct net_chunk_pos *pos = &chunk->positions[i];
+
+        if (co->count * 2 >= co->alloc) {
+            // keep the table at most half full
+            struct net_coalesce grown = { NULL, co->alloc * 2, co->count, co->bytes };
+            if (!(grown.slots = calloc(grown.alloc, sizeof (struct net_latest)))) {
+                fprintf(stderr, "Out of memory allocating client SendQ\n");
+                exit(1);
+            }
+            for (int j = 0; j < co->alloc; j++) {
+                if (co->slots[j].len)
+                    *coalesceSlot(&grown, co->slots[j].key) = co->slots[j];
+                else
+                    free(co->slots[j].data);
+            }
+            free(co->slots);
+            *co = grown;
+        }
+
+        struct net_latest *latest = coalesceSlot(co, pos->key);
+        if (co->bytes - latest->len + pos->len >= c->sendq_max / 2) {
+            // hold back no more than half a SendQ, so it always fits once
+            // the client caught up
+            continue;
+        }
+        if (latest->len) {
+            // superseded
+            clientDropped(c, latest->len, 1);
+            co->bytes -= latest->len;
+        } else {
+            co->count++;
+        }
+        if (latest->alloc < pos->len) {
+            if (!(latest->data = realloc(latest->data, pos->len))) {
+                fprintf(stderr, "Out of memory allocating client SendQ\n");
+                exit(1);
+            }
+            latest->alloc = pos->len;
+        }
+        memcpy(latest->data, chunk->data + pos->offset, pos->len);
+        latest->key = pos->key;
+        latest->len = pos->len;
+        co->bytes += pos->len;
+        held += pos->len;
+        kept++;
+    }
+
+    clientDropped(c, chunk->len - held, chunk->messages - kept);
+}
+
+//
+// NET_SLOW_COALESCE: queue the positions held back, the client has room again
+//
+
+static void clientCatchUp(struct client *c) {
+    struct net_coalesce *co = c->coalesce;
+    struct net_chunk *chunk = calloc(1, sizeof (struct net_chunk));
+    char *p;
+
+    if (!chunk || !(p = chunk->data = malloc(co->bytes))) {
+        fprintf(stderr, "Out of memory allocating client SendQ\n");
+        exit(1);
+    }
+    chunk->writer = c->service->writer;
+    chunk->len = co->bytes;
+    chunk->messages = co->count;
+
+    for (int i = 0; i < co->alloc; i++) {
+        struct net_latest *latest = &co->slots[i];
+        if (latest->len) {
+            memcpy(p, latest->data, latest->len);
+            p += latest->len;
+            latest->len = 0;
+        }
+    }
+    co->count = 0;
+    co->bytes = 0;
+
+    // the SendQ holds the only reference
+    clientQueueChunk(c, chunk);
+}
+
+//
+// Apply the slow consumer policy to a client whose SendQ has no room for a
+// chunk. Returns true if the chunk fits now.
+//
+
+static bool clientSendQFull(struct client *c, struct net_chunk *chunk) {
+    switch (c->service->writer->slow_policy) {
+        case NET_SLOW_DROP_OLDEST:
+            clientDropOldest(c, chunk->len);
+            if (c->sendq_len + chunk->len < c->sendq_max)
+                return true;
+            clientDropped(c, chunk->len, chunk->messages);
+            return false;
+
+        case NET_SLOW_DROP_NEWEST:
+            clientDropped(c, chunk->len, chunk->messages);
+            return false;
+
+        case NET_SLOW_COALESCE:
+            clientCoalesce(c, chunk);
+            return false;
+
+        default:
+            // Drop client - SendQ exceeded.
+            fprintf(stderr, "%s: Dropped due to full SendQ: %s port %s (fd %d, SendQ %d, SendQ high %d, RecvQ %d)\n",
+                    c->service->descr, c->host, c->port,
+                    c->fd, c->sendq_len, c->sendq_high, c->buflen);
+            modesCloseClient(c);
+            return false;
+    }
 }
 
 //
@@ -697,34 +1377,115 @@ static void flushClient(struct client *c, uint64_t now) {
 //
 
 static void flushWrites(struct net_writer *writer) {
+    struct net_chunk *chunk = writer->chunk, *next;
+
+    if (writer->dataUsed) {
+        // Never wait for the network thread here, that would hold up
+        // dequeueing the sample buffers
+        if ((next = netRingPop(&net_free))) {
+            chunk->writer = writer;
+            chunk->len = writer->dataUsed;
+            chunk->queued = netMicros();
+            netRingPush(&net_filled, chunk);
+            Modes.stats_current.net_queue_high_water = max(Modes.stats_current.net_queue_high_water, netRingCount(&net_filled));
+            netThreadWake();
+
+            writer->chunk = next;
+            writer->data = next->data;
+        } else {
+            // All buffers are still with the network thread, drop this one
+            Modes.stats_current.net_queue_dropped++;
+        }
+    }
+    writer->dataUsed = 0;
+    writer->chunk->messages = 0;
+    writer->chunk->npositions = 0;
+    writer->lastWrite = mstime();
+    return;
+}
+
+//
+//=========================================================================
+//
+// Append a buffer handed over by flushWrites() to the SendQ of each client
+// of its writer and try to send it (network thread)
+//
+
+static void netDeliverChunk(struct net_chunk *chunk, uint64_t now) {
+    struct net_writer *writer = chunk->writer;
     struct client *c;
-    uint64_t now = mstime();
 
     for (c = writer->service->clients; c; c = c->next) {
         if (!c->service)
             continue;
-        if (c->service->writer == writer->service->writer) {
-            uintptr_t psendq_end = (uintptr_t) c->sendq + c->sendq_len; // Pointer to end of sendq
+        if (c->writer == writer) {
+            int waiting = c->sendq_len; // still waiting for EPOLLOUT?
+            int held = c->coalesce ? c->coalesce->bytes : 0; // positions held back, they go first
+
+            if (!waiting)
+                c->last_flush = now;
+
+            // Queue the positions held back as soon as they fit
+            if (held && c->sendq_len + held < c->sendq_max) {
+                clientCatchUp(c);
+                held = 0;
+            }
 
             // Add the buffer to the client's SendQ
-            if ((c->sendq_len + writer->dataUsed) >= c->sendq_max) {
-                // Too much data in client SendQ.  Drop client - SendQ exceeded.
-                fprintf(stderr, "%s: Dropped due to full SendQ: %s port %s (fd %d, SendQ %d, RecvQ %d)\n",
-                        c->service->descr, c->host, c->port,
-                        c->fd, c->sendq_len, c->buflen);
-                modesCloseClient(c);
-                continue; // Go to the next client
+            if ((c->sendq_len + held + chunk->len) >= c->sendq_max) {
+                // Too much data in client SendQ
+                if (!clientSendQFull(c, chunk)) {
+                    // send what was caught up, unless the socket is known to be full
+                    if (!waiting && c->service && c->sendq_len)
+                        flushClient(c, now);
+                    continue; // Go to the next client
+                }
             }
-            // Append the data to the end of the queue, increment len
-            memcpy((void*) psendq_end, writer->data, writer->dataUsed);
-            c->sendq_len += writer->dataUsed;
-            // Try flushing...
-            flushClient(c, now);
+            // Append the chunk to the end of the queue
+            clientQueueChunk(c, chunk);
+            // Try flushing, unless the socket is known to be full
+            if (!waiting)
+                flushClient(c, now);
         }
     }
-    writer->dataUsed = 0;
-    writer->lastWrite = mstime();
-    return;
+}
+
+// Deliver all queued buffers and give them back to the main thread
+
+static void netThreadDeliver(uint64_t now) {
+    struct net_chunk *chunk;
+
+    while ((chunk = netRingPop(&net_filled))) {
+        uint64_t latency = netMicros() - chunk->queued;
+        uint_fast64_t latency_max = atomic_load_explicit(&net_queue_latency_max, memory_order_relaxed);
+
+        atomic_fetch_add_explicit(&net_queue_chunks, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&net_queue_latency_sum, latency, memory_order_relaxed);
+        while (latency > latency_max && !atomic_compare_exchange_weak(&net_queue_latency_max, &latency_max, latency))
+            ;
+
+        chunk->refs = 1;
+        netDeliverChunk(chunk, now);
+
+        if (--chunk->refs == 0) {
+            // sent to everybody
+            netRingPush(&net_free, chunk);
+            continue;
+        }
+
+        // Some clients still have it queued, keep the data in a buffer of its
+        // own size and give the full sized one back under a new chunk
+        struct net_chunk *fresh = calloc(1, sizeof (struct net_chunk));
+        char *data = malloc(chunk->len);
+        if (!fresh || !data) {
+            fprintf(stderr, "Out of memory allocating client SendQ\n");
+            exit(1);
+        }
+        memcpy(data, chunk->data, chunk->len);
+        fresh->data = chunk->data;
+        chunk->data = data;
+        netRingPush(&net_free, fresh);
+    }
 }
 
 // Prepare to write up to 'len' bytes to the given net_writer.
@@ -733,7 +1494,7 @@ static void flushWrites(struct net_writer *writer) {
 static void *prepareWrite(struct net_writer *writer, int len) {
     if (!writer ||
             !writer->service ||
-            !writer->service->connections ||
+            !atomic_load_explicit(&writer->clients, memory_order_relaxed) ||
             !writer->data)
         return NULL;
 
@@ -753,9 +1514,20 @@ static void *prepareWrite(struct net_writer *writer, int len) {
 // to the buffer returned from prepareWrite.
 
 static void completeWrite(struct net_writer *writer, void *endptr) {
+    struct net_chunk *chunk = writer->chunk;
+    int start = writer->dataUsed;
+
     writer->dataUsed = endptr - writer->data;
+    chunk->messages++;
 
-    if (writer->dataUsed >= Modes.net_output_flush_size) {
+    if (output_position_key && writer->slow_policy == NET_SLOW_COALESCE) {
+        struct net_chunk_pos *pos = &chunk->positions[chunk->npositions++];
+        pos->key = output_position_key;
+        pos->offset = start;
+        pos->len = writer->dataUsed - start;
+    }
+
+    if (writer->dataUsed >= Modes.net_output_flush_size || chunk->npositions == MODES_NET_CHUNK_POSITIONS) {
         flushWrites(writer);
     }
 }
@@ -834,19 +1606,16 @@ static void modesSendBeastOutput(struct modesMessage *mm, struct net_writer *wri
     completeWrite(writer, p);
 }
 
-static void send_beast_heartbeat(struct net_service *service) {
+static void send_beast_heartbeat(struct net_writer *writer) {
     static char heartbeat_message[] = {0x1a, '1', 0, 0, 0, 0, 0, 0, 0, 0, 0};
     char *data;
 
-    if (!service->writer)
-        return;
-
-    data = prepareWrite(service->writer, sizeof (heartbeat_message));
+    data = prepareWrite(writer, sizeof (heartbeat_message));
     if (!data)
         return;
 
     memcpy(data, heartbeat_message, sizeof (heartbeat_message));
-    completeWrite(service->writer, data + sizeof (heartbeat_message));
+    completeWrite(writer, data + sizeof (heartbeat_message));
 }
 
 //
@@ -867,9 +1636,9 @@ static void printHexDigit(char *p, unsigned char c) {
 // Write raw output to TCP clients
 //
 
-static void modesSendRawOutput(struct modesMessage *mm) {
+static void modesSendRawOutput(struct modesMessage *mm, struct net_writer *writer) {
     int msgLen = mm->msgbits / 8;
-    char *p = prepareWrite(&Modes.raw_out, msgLen * 2 + 15);
+    char *p = prepareWrite(writer, msgLen * 2 + 15);
     int j;
     unsigned char *msg = (Modes.net_verbatim ? mm->verbatim : mm->msg);
 
@@ -892,23 +1661,20 @@ static void modesSendRawOutput(struct modesMessage *mm) {
     *p++ = ';';
     *p++ = '\n';
 
-    completeWrite(&Modes.raw_out, p);
+    completeWrite(writer, p);
 }
 
-static void send_raw_heartbeat(struct net_service *service) {
+static void send_raw_heartbeat(struct net_writer *writer) {
     static char *heartbeat_message = "*0000;\n";
     char *data;
     int len = strlen(heartbeat_message);
 
-    if (!service->writer)
-        return;
-
-    data = prepareWrite(service->writer, len);
+    data = prepareWrite(writer, len);
     if (!data)
         return;
 
     memcpy(data, heartbeat_message, len);
-    completeWrite(service->writer, data + len);
+    completeWrite(writer, data + len);
 }
 
 //
@@ -1035,7 +1801,7 @@ static int decodeSbsLine(struct client *c, char *line, int remote) {
 // Write SBS output to TCP clients
 //
 
-static void modesSendSBSOutput(struct modesMessage *mm, struct aircraft *a) {
+static void modesSendSBSOutput(struct modesMessage *mm, struct aircraft *a, struct net_writer *writer) {
     char *p;
     struct timespec now;
     struct tm stTime_receive, stTime_now;
@@ -1045,7 +1811,7 @@ static void modesSendSBSOutput(struct modesMessage *mm, struct aircraft *a) {
     if (mm->addr & MODES_NON_ICAO_ADDRESS)
         return;
 
-    p = prepareWrite(&Modes.sbs_out, 200);
+    p = prepareWrite(writer, 200);
     if (!p)
         return;
 
@@ -1237,56 +2003,396 @@ static void modesSendSBSOutput(struct modesMessage *mm, struct aircraft *a) {
 
     p += sprintf(p, "\r\n");
 
-    completeWrite(&Modes.sbs_out, p);
+    completeWrite(writer, p);
 }
 
-static void send_sbs_heartbeat(struct net_service *service) {
+static void send_sbs_heartbeat(struct net_writer *writer) {
     static char *heartbeat_message = "\r\n"; // is there a better one?
     char *data;
     int len = strlen(heartbeat_message);
 
-    if (!service->writer)
-        return;
+    data = prepareWrite(writer, len);
+    if (!data)
+        return;
+
+    memcpy(data, heartbeat_message, len);
+    completeWrite(writer, data + len);
+}
+
+//
+//=========================================================================
+//
+
+// Output filters
+
+static int netFilterCompareAddr(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *) a;
+    uint32_t y = *(const uint32_t *) b;
+    return (x > y) - (x < y);
+}
+
+// Parse a comma separated list of hex addresses into a sorted array
+
+static bool netFilterParseAddrs(char *arg, uint32_t **addrs, int *count) {
+    char *saveptr = NULL;
+    int n = 1;
+
+    for (char *p = arg; *p; p++)
+        n += (*p == ',');
+
+    free(*addrs);
+    if (!(*addrs = malloc(n * sizeof (uint32_t)))) {
+        fprintf(stderr, "Out of memory allocating output filter\n");
+        exit(1);
+    }
+
+    n = 0;
+    for (char *tok = strtok_r(arg, ",", &saveptr); tok; tok = strtok_r(NULL, ",", &saveptr)) {
+        char *end;
+        unsigned long addr = strtoul(tok, &end, 16);
+        if (end == tok || *end || addr > 0xFFFFFF)
+            return false;
+        (*addrs)[n++] = addr;
+    }
+    qsort(*addrs, n, sizeof (uint32_t), netFilterCompareAddr);
+
+    // drop duplicates, so equal filters get the same key
+    *count = 0;
+    for (int i = 0; i < n; i++) {
+        if (!*count || (*addrs)[*count - 1] != (*addrs)[i])
+            (*addrs)[(*count)++] = (*addrs)[i];
+    }
+    return *count > 0;
+}
+
+// Parse exactly count comma separated numbers
+
+static bool netFilterParseNumbers(const char *arg, double *values, int count) {
+    for (int i = 0; i < count; i++) {
+        char *end;
+        values[i] = strtod(arg, &end);
+        if (end == arg || !isfinite(values[i]) || *end != (i == count - 1 ? '\0' : ','))
+            return false;
+        arg = end + 1;
+    }
+    return true;
+}
+
+// Parse the terms of a FILTER line, print what is wrong with it otherwise
+
+static bool netFilterParse(struct client *c, struct net_filter *f, char *spec) {
+    char *saveptr = NULL;
+
+    for (char *tok = strtok_r(spec, " \t", &saveptr); tok; tok = strtok_r(NULL, " \t", &saveptr)) {
+        char *arg = strchr(tok, '=');
+        double v[4];
+        bool ok = false;
+
+        if (arg)
+            *arg++ = '\0';
+
+        if (!arg) {
+            // not a term
+        } else if (strcmp(tok, "allow") == 0) {
+            ok = netFilterParseAddrs(arg, &f->allow, &f->nallow);
+        } else if (strcmp(tok, "deny") == 0) {
+            ok = netFilterParseAddrs(arg, &f->deny, &f->ndeny);
+        } else if (strcmp(tok, "df") == 0) {
+            char *dfptr = NULL;
+            f->df_mask = 0;
+            ok = true;
+            for (char *num = strtok_r(arg, ",", &dfptr); num && ok; num = strtok_r(NULL, ",", &dfptr)) {
+                char *end;
+                unsigned long df = strtoul(num, &end, 10);
+                ok = (end != num && !*end && df <= 31);
+                f->df_mask |= 1U << (df & 31);
+            }
+            ok = ok && f->df_mask;
+        } else if (strcmp(tok, "bbox") == 0) {
+            if ((ok = netFilterParseNumbers(arg, v, 4) &&
+                    v[0] >= -90 && v[0] <= v[2] && v[2] <= 90 &&
+                    v[1] >= -180 && v[1] <= 180 && v[3] >= -180 && v[3] <= 180)) {
+                f->bbox = true;
+                f->south = v[0];
+                f->west = v[1];
+                f->north = v[2];
+                f->east = v[3];
+            }
+        } else if (strcmp(tok, "radius") == 0) {
+            if ((ok = netFilterParseNumbers(arg, v, 3) &&
+                    v[0] >= -90 && v[0] <= 90 && v[1] >= -180 && v[1] <= 180 && v[2] > 0)) {
+                f->radius = true;
+                f->lat = v[0];
+                f->lon = v[1];
+                f->radius_m = v[2] * 1852;
+            }
+        } else if (strcmp(tok, "signal") == 0) {
+            if ((ok = netFilterParseNumbers(arg, v, 1) && v[0] <= 0))
+                f->min_signal = pow(10, v[0] / 10);
+        }
+
+        if (!ok) {
+            fprintf(stderr, "%s: Bad output filter term %s from %s port %s (fd %d)\n",
+                    c->service->descr, tok, c->host, c->port, c->fd);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Canonical form of a filter's criteria
+
+static char *netFilterKey(const struct net_filter *f) {
+    char *key = malloc(256 + 7 * (f->nallow + f->ndeny));
+    char *p = key;
+
+    if (!key) {
+        fprintf(stderr, "Out of memory allocating output filter\n");
+        exit(1);
+    }
+
+    p += sprintf(p, "allow=");
+    for (int i = 0; i < f->nallow; i++)
+        p += sprintf(p, "%06X,", f->allow[i]);
+    p += sprintf(p, " deny=");
+    for (int i = 0; i < f->ndeny; i++)
+        p += sprintf(p, "%06X,", f->deny[i]);
+    p += sprintf(p, " df=%X", f->df_mask);
+    if (f->bbox)
+        p += sprintf(p, " bbox=%a,%a,%a,%a", f->south, f->west, f->north, f->east);
+    if (f->radius)
+        p += sprintf(p, " radius=%a,%a,%a", f->lat, f->lon, f->radius_m);
+    sprintf(p, " signal=%a", f->min_signal);
+    return key;
+}
+
+static void netFilterFree(struct net_filter *f) {
+    for (int i = 0; i < NET_FILTER_OUTPUTS; i++) {
+        if (f->writers[i].chunk)
+            netChunkFree(f->writers[i].chunk);
+    }
+    free(f->allow);
+    free(f->deny);
+    free(f->key);
+    free(f);
+}
+
+static bool netFilterHasClients(struct net_filter *f) {
+    for (int i = 0; i < NET_FILTER_OUTPUTS; i++) {
+        if (atomic_load_explicit(&f->writers[i].clients, memory_order_relaxed))
+            return true;
+    }
+    return false;
+}
+
+// Find the filter asked for by a FILTER line or add it (network thread)
+
+static struct net_filter *netFilterGet(struct client *c, char *spec) {
+    int count = atomic_load_explicit(&net_filter_count, memory_order_relaxed);
+    struct net_filter *f = calloc(1, sizeof (struct net_filter));
+
+    if (!f) {
+        fprintf(stderr, "Out of memory allocating output filter\n");
+        exit(1);
+    }
+
+    if (!netFilterParse(c, f, spec)) {
+        netFilterFree(f);
+        return NULL;
+    }
+    f->key = netFilterKey(f);
+
+    struct net_filter_slot *slot = NULL;
+
+    for (int i = 0; i < count; i++) {
+        struct net_filter_slot *other = &net_filters[i];
+        int state = atomic_load_explicit(&other->state, memory_order_relaxed);
+
+        if (state == NET_FILTER_FREE && !slot)
+            slot = other;
+        if (state != NET_FILTER_ACTIVE && state != NET_FILTER_UNUSED)
+            continue;
+        if (strcmp(other->filter->key, f->key) != 0)
+            continue;
+
+        // take it back, unless the main thread just let go of it
+        if (state == NET_FILTER_ACTIVE ||
+                atomic_compare_exchange_strong_explicit(&other->state, &state, NET_FILTER_ACTIVE, memory_order_relaxed, memory_order_relaxed)) {
+            netFilterFree(f);
+            return other->filter;
+        }
+    }
+
+    if (!slot && count == MODES_NET_MAX_FILTERS) {
+        fprintf(stderr, "%s: No more than %d different output filters, refusing %s port %s (fd %d)\n",
+                c->service->descr, MODES_NET_MAX_FILTERS, c->host, c->port, c->fd);
+        netFilterFree(f);
+        return NULL;
+    }
+
+    // The main thread sets up the buffers, see netFiltersReady()
+    for (int i = 0; i < NET_FILTER_OUTPUTS; i++) {
+        f->writers[i].service = net_filter_outputs[i]->service;
+        f->writers[i].send_heartbeat = net_filter_outputs[i]->send_heartbeat;
+        f->writers[i].slow_policy = net_filter_outputs[i]->slow_policy;
+    }
+    if (slot) {
+        netFilterFree(slot->filter);
+    } else {
+        slot = &net_filters[count];
+        atomic_store_explicit(&net_filter_count, count + 1, memory_order_relaxed);
+    }
+    slot->filter = f;
+    atomic_store_explicit(&slot->state, NET_FILTER_ACTIVE, memory_order_release);
+    return f;
+}
+
+// Set up the writers of new filters and stop writing to unused ones, return
+// the number of slots to look at for net_filters[].ready (main thread)
+
+static int netFiltersReady(void) {
+    int count = atomic_load_explicit(&net_filter_count, memory_order_relaxed);
+
+    for (int n = 0; n < count; n++) {
+        struct net_filter_slot *slot = &net_filters[n];
+        int state = atomic_load_explicit(&slot->state, memory_order_acquire);
+        struct net_filter *f = slot->filter;
+
+        if (state == NET_FILTER_ACTIVE && !slot->ready) {
+            for (int i = 0; i < NET_FILTER_OUTPUTS; i++) {
+                struct net_writer *writer = &f->writers[i];
+                if (!(writer->chunk = netChunkNew())) {
+                    fprintf(stderr, "Out of memory allocating output buffer for filter %s\n", f->key);
+                    exit(1);
+                }
+                writer->data = writer->chunk->data;
+                writer->dataUsed = 0;
+                writer->lastWrite = mstime();
+            }
+            slot->ready = true;
+        } else if (state == NET_FILTER_UNUSED) {
+            // nobody to send it to, drop what wasn't flushed yet
+            if (slot->ready) {
+                for (int i = 0; i < NET_FILTER_OUTPUTS; i++) {
+                    struct net_writer *writer = &f->writers[i];
+                    netChunkFree(writer->chunk);
+                    writer->chunk = NULL;
+                    writer->data = NULL;
+                    writer->dataUsed = 0;
+                }
+                slot->ready = false;
+            }
+            // everything flushed so far is in net_filled before the release
+            atomic_compare_exchange_strong_explicit(&slot->state, &state, NET_FILTER_RELEASED, memory_order_release, memory_order_relaxed);
+        }
+    }
+    return count;
+}
+
+// Find the filters nobody gets any more and free the slots the main thread
+// released (network thread, once a second)
+
+static void netFiltersReclaim(uint64_t now) {
+    int count = atomic_load_explicit(&net_filter_count, memory_order_relaxed);
+    uint64_t released = 0;
 
-    data = prepareWrite(service->writer, len);
-    if (!data)
+    for (int n = 0; n < count; n++) {
+        struct net_filter_slot *slot = &net_filters[n];
+        int state = atomic_load_explicit(&slot->state, memory_order_acquire);
+
+        if (state == NET_FILTER_ACTIVE && !netFilterHasClients(slot->filter))
+            atomic_compare_exchange_strong_explicit(&slot->state, &state, NET_FILTER_UNUSED, memory_order_relaxed, memory_order_relaxed);
+        else if (state == NET_FILTER_RELEASED)
+            released |= (uint64_t) 1 << n;
+    }
+    if (!released)
         return;
 
-    memcpy(data, heartbeat_message, len);
-    completeWrite(service->writer, data + len);
+    // Buffers of a released filter still queued would go to whoever gets
+    // the slot next
+    netThreadDeliver(now);
+
+    for (int n = 0; n < count; n++) {
+        if (released & ((uint64_t) 1 << n))
+            atomic_store_explicit(&net_filters[n].state, NET_FILTER_FREE, memory_order_relaxed);
+    }
 }
 
-//
-//=========================================================================
-//
+static bool netFilterMatch(const struct net_filter *f, struct modesMessage *mm, struct aircraft *a) {
+    if (f->nallow && !bsearch(&mm->addr, f->allow, f->nallow, sizeof (uint32_t), netFilterCompareAddr))
+        return false;
+    if (f->ndeny && bsearch(&mm->addr, f->deny, f->ndeny, sizeof (uint32_t), netFilterCompareAddr))
+        return false;
+    if (f->df_mask && (mm->msgtype > 31 || !(f->df_mask & (1U << mm->msgtype))))
+        return false;
+    if (mm->signalLevel < f->min_signal)
+        return false;
+
+    if (f->bbox || f->radius) {
+        if (!a || !trackDataValid(&a->position_valid))
+            return false;
+
+        double lat = a->meta.lat;
+        double lon = a->meta.lon;
+        if (f->bbox && (lat < f->south || lat > f->north))
+            return false;
+        if (f->bbox && (f->west <= f->east ? (lon < f->west || lon > f->east) : (lon < f->west && lon > f->east)))
+            return false;
+        if (f->radius && greatcircle(f->lat, f->lon, lat, lon) > f->radius_m)
+            return false;
+    }
+    return true;
+}
 
-void modesQueueOutput(struct modesMessage *mm, struct aircraft *a) {
+// Write a message to one set of per-message outputs
+
+static void modesWriteOutput(struct modesMessage *mm, struct aircraft *a, struct net_writer *beast, struct net_writer *beast_reduce, struct net_writer *raw, struct net_writer *sbs) {
     int is_mlat = (mm->source == SOURCE_MLAT);
 
     if (a && !is_mlat && mm->correctedbits < 2) {
         // Don't ever forward 2-bit-corrected messages via SBS output.
         // Don't ever forward mlat messages via SBS output.
-        modesSendSBSOutput(mm, a);
+        modesSendSBSOutput(mm, a, sbs);
     }
 
     if (!is_mlat && (Modes.net_verbatim || mm->correctedbits < 2)) {
         // Forward 2-bit-corrected messages via raw output only if --net-verbatim is set
         // Don't ever forward mlat messages via raw output.
-        modesSendRawOutput(mm);
+        modesSendRawOutput(mm, raw);
     }
 
     if ((!is_mlat || Modes.forward_mlat) && (Modes.net_verbatim || mm->correctedbits < 2)) {
         // Forward 2-bit-corrected messages via beast output only if --net-verbatim is set
         // Forward mlat messages via beast output only if --forward-mlat is set
-        modesSendBeastOutput(mm, &Modes.beast_out);
+        modesSendBeastOutput(mm, beast);
         if (mm->reduce_forward) {
-            modesSendBeastOutput(mm, &Modes.beast_reduce_out);
+            modesSendBeastOutput(mm, beast_reduce);
+        }
+    }
+}
+
+void modesQueueOutput(struct modesMessage *mm, struct aircraft *a) {
+    int filters = netFiltersReady();
+
+    output_position_key = mm->cpr_valid ? ((mm->addr << 1 | mm->cpr_odd) + 1) : 0;
+
+    modesWriteOutput(mm, a, &Modes.beast_out, &Modes.beast_reduce_out, &Modes.raw_out, &Modes.sbs_out);
+
+    // Match the message once for each filter in use, however many clients
+    // asked for it
+    for (int i = 0; i < filters; i++) {
+        struct net_filter *f = net_filters[i].filter;
+        if (net_filters[i].ready && netFilterHasClients(f) && netFilterMatch(f, mm, a)) {
+            modesWriteOutput(mm, a, &f->writers[NET_FILTER_BEAST], &f->writers[NET_FILTER_BEAST_REDUCE],
+                    &f->writers[NET_FILTER_RAW], &f->writers[NET_FILTER_SBS]);
         }
     }
 
-    if (a && !is_mlat) {
+    if (a && mm->source != SOURCE_MLAT) {
         writeFATSVEvent(mm, a);
     }
+
+    output_position_key = 0;
 }
 
 // Decode a little-endian IEEE754 float (binary32)
@@ -1340,22 +2446,27 @@ static void handle_radarcape_position(float lat, float lon, float alt) {
 
 // recompute global Mode A/C setting
 
+// (network thread, the main thread picks up the result in modesNetPeriodicWork)
+
 static void autoset_modeac() {
     struct net_service *s;
     struct client *c;
+    int modeac = 0;
 
     if (!Modes.mode_ac_auto)
         return;
 
-    Modes.mode_ac = 0;
     for (s = Modes.services; s; s = s->next) {
+        if (s->reactor != &net_output)
+            continue;
         for (c = s->clients; c; c = c->next) {
             if (c->modeac_requested) {
-                Modes.mode_ac = 1;
+                modeac = 1;
                 break;
             }
         }
     }
+    atomic_store(&net_modeac, modeac);
 }
 
 // Send some Beast settings commands to a client
@@ -1427,13 +2538,7 @@ static void decodeHulcMessage(char *p) {
 
     if (id == 0x01 && len == 0x18) {
         // HULC Status message
-        for (int j = 0; j < len; j++) {
-            hsm.buf[j] = *p++;
-            // unescape
-            if (*p == 0x1A) {
-                p++;
-            }
-        }
+        memcpy(hsm.buf, p, len);
         // Antenna serial
         Modes.receiver.antenna_serial = __bswap_32(hsm.status.serial);
         // Antenna status flags
@@ -1472,7 +2577,8 @@ static void decodeHulcMessage(char *p) {
 //
 //=========================================================================
 //
-// This function decodes a Beast binary format message
+// This function decodes a Beast binary format message, unescaped by
+// beastDeframe() and starting at its type byte
 //
 // The message is passed to the higher level layers, so it feeds
 // the selected screen output, the network output and so forth.
@@ -1513,12 +2619,7 @@ static int decodeBinMessage(struct client *c, char *p, int remote) {
         // Special case for Radarcape position messages.
         float lat, lon, alt;
 
-        for (j = 0; j < 21; j++) { // and the data
-            msg[j] = ch = *p++;
-            if (0x1A == ch) {
-                p++;
-            }
-        }
+        memcpy(msg, p, 21);
 
         lat = ieee754_binary32_le_to_float(msg + 4);
         lon = ieee754_binary32_le_to_float(msg + 8);
@@ -1548,9 +2649,6 @@ static int decodeBinMessage(struct client *c, char *p, int remote) {
         for (j = 0; j < 6; j++) {
             ch = *p++;
             mm.timestampMsg = mm.timestampMsg << 8 | (ch & 255);
-            if (0x1A == ch) {
-                p++;
-            }
         }
 
         // record reception time as the time we read it.
@@ -1561,7 +2659,7 @@ static int decodeBinMessage(struct client *c, char *p, int remote) {
         mm.signalLevel = mm.signalLevel * mm.signalLevel;
 
         /* In case of Mode-S Beast use the signal level per message for statistics */
-        if (Modes.sdr_type == SDR_MODESBEAST) {
+        if (Modes.sdr_type == SDR_MODESBEAST || Modes.sdr_type == SDR_BEASTFILE) {
             Modes.stats_current.signal_power_sum += mm.signalLevel;
             Modes.stats_current.signal_power_count += 1;
 
@@ -1571,16 +2669,7 @@ static int decodeBinMessage(struct client *c, char *p, int remote) {
                 Modes.stats_current.strong_signal_count++; // signal power above -3dBFS
         }
 
-        if (0x1A == ch) {
-            p++;
-        }
-
-        for (j = 0; j < msgLen; j++) { // and the data
-            msg[j] = ch = *p++;
-            if (0x1A == ch) {
-                p++;
-            }
-        }
+        memcpy(msg, p, msgLen); // and the data
 
         if (msgLen == MODEAC_MSG_BYTES) { // ModeA or ModeC
             if (remote) {
@@ -1625,6 +2714,13 @@ static int decodeBinMessage(struct client *c, char *p, int remote) {
     }
     return (0);
 }
+
+// Decode a Beast binary message that wasn't read from a network client,
+// p points at the type byte of a frame from beastDeframe()
+
+void decodeBeastMessage(char *p, int remote) {
+    decodeBinMessage(NULL, p, remote);
+}
 //
 //=========================================================================
 //
@@ -2188,6 +3284,15 @@ static void createStatisticEntry(StatisticEntry *e, struct stats *st) {
     if (!Modes.net_only) {
         e->local_samples_processed = st->samples_processed;
         e->local_samples_dropped = st->samples_dropped;
+        e->local_fifo_depth = st->fifo_depth;
+        e->local_fifo_high_water = st->fifo_high_water;
+        e->local_beast_batches = st->beast_batches;
+        e->local_beast_batch_messages = st->beast_batch_msgs;
+        e->local_beast_batch_max = st->beast_batch_max;
+        if (st->beast_batch_msgs > 0) {
+            e->local_beast_latency_mean = (double) st->beast_latency_sum / st->beast_batch_msgs;
+        }
+        e->local_beast_latency_max = st->beast_latency_max;
         e->local_modeac = st->demod_modeac;
         e->local_modes = st->demod_preambles;
         e->local_bad = st->remote_rejected_bad;
@@ -2220,6 +3325,29 @@ static void createStatisticEntry(StatisticEntry *e, struct stats *st) {
         for (i = 0; i <= Modes.nfix_crc; ++i) {
             e->remote_accepted += st->remote_accepted[i];
         }
+
+        e->net_epoll_wait = st->net_epoll_wait;
+        e->net_read = st->net_read;
+        e->net_write = st->net_write;
+        e->net_accept = st->net_accept;
+        e->net_epoll_ctl = st->net_epoll_ctl;
+        e->net_queue_chunks = st->net_queue_chunks;
+        e->net_queue_high_water = st->net_queue_high_water;
+        e->net_queue_dropped = st->net_queue_dropped;
+        if (st->net_queue_chunks)
+            e->net_queue_latency_mean = (float) st->net_queue_latency_sum / st->net_queue_chunks;
+        e->net_queue_latency_max = st->net_queue_latency_max;
+        e->net_sendq_high_water = st->net_sendq_high_water;
+        e->net_slow_dropped_messages = st->net_slow_dropped_messages;
+        e->net_slow_dropped_bytes = st->net_slow_dropped_bytes;
+        e->net_slow_dropped_beast_out_messages = st->net_slow_dropped_beast_out_messages;
+        e->net_slow_dropped_beast_out_bytes = st->net_slow_dropped_beast_out_bytes;
+        e->net_slow_dropped_beast_reduce_out_messages = st->net_slow_dropped_beast_reduce_out_messages;
+        e->net_slow_dropped_beast_reduce_out_bytes = st->net_slow_dropped_beast_reduce_out_bytes;
+        e->net_slow_dropped_raw_out_messages = st->net_slow_dropped_raw_out_messages;
+        e->net_slow_dropped_raw_out_bytes = st->net_slow_dropped_raw_out_bytes;
+        e->net_slow_dropped_sbs_out_messages = st->net_slow_dropped_sbs_out_messages;
+        e->net_slow_dropped_sbs_out_bytes = st->net_slow_dropped_sbs_out_bytes;
     }
 
     e->cpr_surface = st->cpr_surface;
@@ -2292,6 +3420,8 @@ void generateStatsProtoBuf() {
     stats.last_5min = &last_5min;
     stats.last_15min = &last_15min;
     stats.total = &total;
+    stats.converter = Modes.converter_name;
+    stats.converter_rate = Modes.converter_rate / 1e6;
 
     // Inlcude maximum range polar values if enabled
     if (Modes.stats_polar_range) {
@@ -2409,6 +3539,7 @@ static void periodicReadFromClient(struct client *c) {
 
     nread = read(c->fd, buf, sizeof (buf));
     err = errno;
+    netCount(&c->service->reactor->read);
 
     if (nread < 0 && (err == EAGAIN || err == EWOULDBLOCK)) {
         return;
@@ -2422,6 +3553,138 @@ static void periodicReadFromClient(struct client *c) {
     }
 }
 
+//
+//=========================================================================
+//
+// Length of a Beast frame from its type byte, unescaped; 3 for a GNS HULC
+// message whose length isn't known yet, 0 for no valid frame type
+//
+
+static int beastFrameLength(char type) {
+    switch (type) {
+        case '1':
+            return MODEAC_MSG_BYTES + 8;
+        case '2':
+            return MODES_SHORT_MSG_BYTES + 8;
+        case '3':
+        case '4':
+        case '5':
+            return MODES_LONG_MSG_BYTES + 8;
+        case 'H':
+            return 3; // type, message id and length
+        default:
+            return 0;
+    }
+}
+
+//
+// Take the next complete Beast binary frame from the data [*p, end) and
+// unescape it into out. Returns true with *p advanced past the frame, or
+// false with *p == end if the data ran out first; a frame in progress then
+// carries on in the next call, which may be given a different out.
+// Garbage between frames is skipped and counted in d->skipped.
+//
+
+bool beastDeframe(struct beast_deframer *d, char **p, char *end, struct beast_frame *out) {
+    // work on copies, the frame bytes written through out could alias *d
+    beast_state_t state = d->state;
+    int len = d->len;
+    int need = d->need;
+    unsigned skipped = d->skipped;
+    char *in = *p;
+    bool done = false;
+
+    if (len)
+        memcpy(out->data, d->partial, len);
+
+    while (in < end) {
+        if (state == BEAST_SYNC) {
+            char *sep = memchr(in, (char) 0x1a, end - in);
+            if (!sep) {
+                skipped += end - in;
+                in = end;
+                break;
+            }
+            skipped += sep - in;
+            in = sep + 1;
+            state = BEAST_TYPE;
+            continue;
+        }
+
+        if (state == BEAST_TYPE) {
+            char ch = *in++;
+            if (ch == 0x1a) {
+                // a stray 0x1a, this one may start the frame
+                skipped++;
+            } else if ((need = beastFrameLength(ch))) {
+                out->data[0] = ch;
+                len = 1;
+                state = BEAST_BODY;
+            } else {
+                // Not a valid beast message, look for the next 0x1a
+                skipped += 2;
+                state = BEAST_SYNC;
+            }
+            continue;
+        }
+
+        if (state == BEAST_ESCAPE) {
+            if (*in != 0x1a) {
+                // A lone 0x1a: the frame was cut short and the next one starts here
+                skipped += len + 1;
+                len = 0;
+                state = BEAST_TYPE;
+                continue;
+            }
+            out->data[len++] = *in++;
+            state = BEAST_BODY;
+        }
+
+        // copy up to the end of the frame or the next 0x1a
+        while (len < need && in < end) {
+            char ch = *in++;
+            if (ch == 0x1a) {
+                state = BEAST_ESCAPE;
+                break;
+            }
+            out->data[len++] = ch;
+        }
+
+        if (len < need)
+            continue;
+
+        if (len == 3 && out->data[0] == 'H' && need == 3) {
+            // GNS HULC protocol message, now we know its length
+            int hulc_len = (unsigned char) out->data[2];
+            if (hulc_len > 24) {
+                // Length doesn't match, skip message
+                skipped += len + 1;
+                len = 0;
+                state = BEAST_SYNC;
+                continue;
+            }
+            need = hulc_len + 3;
+            if (len < need)
+                continue;
+        }
+
+        out->len = len;
+        len = 0;
+        state = BEAST_SYNC;
+        done = true;
+        break;
+    }
+
+    d->state = state;
+    d->len = len;
+    d->need = need;
+    d->skipped = skipped;
+    if (len)
+        memcpy(d->partial, out->data, len);
+    *p = in;
+    return done;
+}
+
 //
 //=========================================================================
 //
@@ -2438,6 +3701,51 @@ static void periodicReadFromClient(struct client *c) {
 // close the connection with the client in case of non-recoverable errors.
 //
 
+// Look for a FILTER line at the start of the data of an output client and
+// move the client over to the filter's writer. Returns 0 while the line is
+// incomplete, 1 once the handshake is over and -1 to close the client.
+
+static int clientHandshake(struct client *c) {
+    static const char hello[] = "FILTER ";
+    int len = sizeof (hello) - 1;
+    char *eol;
+
+    if (memcmp(c->buf, hello, min(c->buflen, len))) {
+        // no filter wanted, the data is for the service
+        c->handshake = 0;
+        return 1;
+    }
+
+    if (!(eol = memchr(c->buf, '\n', c->buflen))) {
+        if (c->buflen < MODES_CLIENT_BUF_SIZE - 1)
+            return 0;
+        fprintf(stderr, "%s: Output filter too long from %s port %s (fd %d)\n",
+                c->service->descr, c->host, c->port, c->fd);
+        return -1;
+    }
+
+    *eol = '\0';
+    if (eol > c->buf && eol[-1] == '\r')
+        eol[-1] = '\0';
+
+    struct net_filter *f = netFilterGet(c, c->buf + len);
+    if (!f)
+        return -1;
+
+    for (int i = 0; i < NET_FILTER_OUTPUTS; i++) {
+        if (c->writer == net_filter_outputs[i]) {
+            atomic_fetch_sub_explicit(&c->writer->clients, 1, memory_order_relaxed);
+            c->writer = &f->writers[i];
+            atomic_fetch_add_explicit(&c->writer->clients, 1, memory_order_relaxed);
+        }
+    }
+
+    c->buflen -= eol + 1 - c->buf;
+    memmove(c->buf, eol + 1, c->buflen);
+    c->handshake = 0;
+    return 1;
+}
+
 static void modesReadFromClient(struct client *c) {
     int left;
     int nread;
@@ -2456,6 +3764,7 @@ static void modesReadFromClient(struct client *c) {
 
         nread = read(c->fd, c->buf + c->buflen, left);
         int err = errno;
+        netCount(&c->service->reactor->read);
 
         // If we didn't get all the data we asked for, then return once we've processed what we did get.
         if (nread != left) {
@@ -2486,14 +3795,20 @@ static void modesReadFromClient(struct client *c) {
 
         c->buflen += nread;
 
+        if (c->handshake) {
+            int done = clientHandshake(c);
+            if (done < 0) {
+                modesCloseClient(c);
+                return;
+            }
+            if (!done)
+                return; // wait for the rest of the line
+        }
+
         char *som = c->buf; // first byte of next message
         char *eod = som + c->buflen; // one byte past end of data
         char *p;
-        int remote = 1; // Messages will be marked remote by default
-        if ((c->fd == Modes.beast_fd) && (Modes.sdr_type == SDR_MODESBEAST || Modes.sdr_type == SDR_GNS)) {
-            /* Message from a local connected Modes-S beast or GNS5894 are passed off the internet */
-            remote = 0;
-        }
+        int remote = 1; // Messages from network clients are marked remote; a local Beast is read by sdr_beast.c
 
         switch (c->service->read_mode) {
             case READ_MODE_IGNORE:
@@ -2502,69 +3817,25 @@ static void modesReadFromClient(struct client *c) {
                 break;
 
             case READ_MODE_BEAST:
-                // This is the Beast Binary scanning case.
-                // If there is a complete message still in the buffer, there must be the separator 'sep'
-                // in the buffer, note that we full-scan the buffer at every read for simplicity.
-
-                while (som < eod && ((p = memchr(som, (char) 0x1a, eod - som)) != NULL)) { // The first byte of buffer 'should' be 0x1a
-
-                    Modes.stats_current.remote_rejected_bad += ((p - som) / (8 + MODES_SHORT_MSG_BYTES));
-                    som = p; // consume garbage up to the 0x1a
-                    ++p; // skip 0x1a
-
-                    if (p >= eod) {
-                        // Incomplete message in buffer, retry later
-                        break;
-                    }
-
-                    char *eom; // one byte past end of message
-                    if (*p == '1') {
-                        eom = p + MODEAC_MSG_BYTES + 8; // point past remainder of message
-                    } else if (*p == '2') {
-                        eom = p + MODES_SHORT_MSG_BYTES + 8;
-                    } else if (*p == '3') {
-                        eom = p + MODES_LONG_MSG_BYTES + 8;
-                    } else if (*p == '4') {
-                        eom = p + MODES_LONG_MSG_BYTES + 8;
-                    } else if (*p == '5') {
-                        eom = p + MODES_LONG_MSG_BYTES + 8;
-                    } else if (*p == 'H') {
-                        // GNS HULC protocol message
-                        if (p + 2 >= eod) { // Incomplete message in buffer, retry later
-                            break;
-                        }
-                        int len = *(unsigned char *) (p + 2);
-                        if (len > 24) {
-                            ++som; // Length doesn't match, skip message
-                            continue;
-                        }
-                        eom = p + len + 3;
-                    } else {
-                        // Not a valid beast message, skip 0x1a and try again
-                        ++som;
-                        continue;
-                    }
-
-                    // we need to be careful of double escape characters in the message body
-                    for (p = som + 1; p < eod && p < eom; p++) {
-                        if (0x1A == *p) {
-                            p++;
-                            eom++;
+                // This is the Beast Binary scanning case. All of the data is
+                // consumed, a partial frame waits in c->beast for the next read.
+                while (som < eod) {
+                    struct beast_frame frames[MODES_NET_BEAST_BATCH];
+                    int n = 0;
+
+                    while (n < MODES_NET_BEAST_BATCH && beastDeframe(&c->beast, &som, eod, &frames[n]))
+                        n++;
+
+                    Modes.stats_current.remote_rejected_bad += c->beast.skipped / (8 + MODES_SHORT_MSG_BYTES);
+                    c->beast.skipped %= 8 + MODES_SHORT_MSG_BYTES;
+
+                    // Pass the batch of frames to the handler.
+                    for (int i = 0; i < n; i++) {
+                        if (c->service->read_handler(c, frames[i].data, remote)) {
+                            modesCloseClient(c);
+                            return;
                         }
                     }
-
-                    if (eom > eod) { // Incomplete message in buffer, retry later
-                        break;
-                    }
-
-                    // Have a 0x1a followed by 1/2/3/4/5 - pass message to handler.
-                    if (c->service->read_handler(c, som + 1, remote)) {
-                        modesCloseClient(c);
-                        return;
-                    }
-
-                    // advance to next message
-                    som = eom;
                 }
                 break;
 
@@ -3085,41 +4356,98 @@ static void writeFATSV() {
     }
 }
 
-void modesNetSecondWork(void) {
-    struct client *c, **prev;
-    struct net_service *s;
-    uint64_t now = mstime();
+//
+//=========================================================================
+//
+// Wait up to timeout_ms for socket events of the reactor and accept, read
+// from or flush the sockets that are ready
+//
 
-    for (s = Modes.services; s; s = s->next) {
-        if (s->read_handler)
-            continue;
-        for (c = s->clients; c; c = c->next) {
-            if (!c->service)
-                continue;
-            if (c->last_read + 30000 < now) {
-                // This is called if there is no read handler - we just read and discard to try to trigger socket errors
-                // (if 30 sec have passed)
-                periodicReadFromClient(c);
-                c->last_read = now;
-            }
-        }
+static void netPoll(struct net_reactor *r, int timeout_ms) {
+    struct epoll_event events[MODES_NET_EVENTS];
+    uint64_t now;
+    int n;
+
+    netCount(&r->epoll_wait);
+    n = epoll_wait(netEpollFd(r), events, MODES_NET_EVENTS, timeout_ms);
+    if (n < 0) {
+        if (errno != EINTR)
+            fprintf(stderr, "epoll_wait failed: %s\n", strerror(errno));
+        return;
     }
 
-    // If we have generated no messages for a while, send
-    // a heartbeat
-    if (Modes.net_heartbeat_interval) {
-        for (s = Modes.services; s; s = s->next) {
-            if (s->writer &&
-                    s->connections &&
-                    s->writer->send_heartbeat &&
-                    (s->writer->lastWrite + Modes.net_heartbeat_interval) <= now) {
-                s->writer->send_heartbeat(s);
+    now = system_mstime();
+    for (int i = 0; i < n; i++) {
+        struct net_epoll *ep = events[i].data.ptr;
+        uint32_t ev = events[i].events;
+
+        switch (ep->type) {
+            case NET_EPOLL_LISTENER:
+                if (!r->accept_resume)
+                    modesAcceptClients(ep->owner, ep->fd, now);
+                break;
+
+            case NET_EPOLL_CONNECTOR:
+            {
+                struct net_connector *con = ep->owner;
+                if (con->connecting && con->fd == ep->fd)
+                    checkServiceConnected(con);
+                break;
+            }
+
+            case NET_EPOLL_CLIENT:
+            {
+                struct client *c = ep->owner;
+                // closed earlier in this batch; its memory is only freed by netFreeClients()
+                if (!c->service)
+                    break;
+                if (ev & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                    if (c->service->read_handler || c->handshake) {
+                        modesReadFromClient(c);
+                    } else {
+                        // Nothing is expected from this client - read and discard to pick up socket errors
+                        periodicReadFromClient(c);
+                        c->last_read = now;
+                    }
+                }
+                if (c->service && (ev & EPOLLOUT) && c->sendq_len)
+                    flushClient(c, now);
+                break;
+            }
+
+            case NET_EPOLL_WAKEUP:
+            {
+                uint64_t count;
+                if (read(ep->fd, &count, sizeof (count)) < 0 && errno != EAGAIN)
+                    fprintf(stderr, "Network thread wakeup failed: %s\n", strerror(errno));
+                break;
             }
         }
     }
 
-    // Unlink and free closed clients
-    for (s = Modes.services; s; s = s->next) {
+    // Listen again once the file descriptor shortage had some time to pass
+    if (r->accept_resume && now >= r->accept_resume) {
+        listenersEpoll(r, EPOLL_CTL_ADD);
+        r->accept_resume = 0;
+    }
+}
+
+//
+// Wait up to timeout_ms for activity on the input sockets and handle it
+//
+
+void modesNetWait(int timeout_ms) {
+    netPoll(&net_main, timeout_ms);
+}
+
+// Unlink and free the closed clients of the reactor's services
+
+static void netFreeClients(struct net_reactor *r) {
+    struct client *c, **prev;
+
+    for (struct net_service *s = Modes.services; s; s = s->next) {
+        if (s->reactor != r)
+            continue;
         for (prev = &s->clients, c = *prev; c; c = *prev) {
             if (c->fd == -1) {
                 // Recently closed, prune from list
@@ -3133,41 +4461,145 @@ void modesNetSecondWork(void) {
 }
 
 //
-// Perform periodic network work
+//=========================================================================
+//
+// The network thread: sends the output handed over by the main thread and
+// looks after the sockets of the output services
 //
 
-void modesNetPeriodicWork(void) {
-    struct client *c;
-    struct net_service *s;
-    uint64_t now = mstime();
-    static uint64_t next_tcp_json;
-    static uint64_t next_accept;
+static void *netThreadEntryPoint(void *arg) {
+    MODES_NOTUSED(arg);
+    uint64_t next_second = 0;
 
-    // Accept new connections
-    if (now > next_accept) {
-        next_accept = modesAcceptClients(now);
-    }
+    worker_thread_init("readsb-net");
 
-    // Read from clients, and if any need flushing, do so.
-    for (s = Modes.services; s; s = s->next) {
-        for (c = s->clients; c; c = c->next) {
-            if (!c->service)
-                continue;
+    while (!atomic_load(&net_thread_stop)) {
+        uint64_t now = system_mstime();
 
-            if (s->read_handler) {
-                modesReadFromClient(c);
-            }
+        netThreadDeliver(now);
 
-            // If there is a sendq, try to flush it
-            if (s->writer) {
-                if (c->sendq_len == 0) {
-                    c->last_flush = now;
+        if (now >= next_second) {
+            // Disconnect clients that haven't taken any data for a while,
+            // flushClient() gives up on them after 5 seconds
+            for (struct net_service *s = Modes.services; s; s = s->next) {
+                if (s->reactor != &net_output)
                     continue;
+                for (struct client *c = s->clients; c; c = c->next) {
+                    if (c->service && c->sendq_len && c->last_flush + 5000 < now)
+                        flushClient(c, now);
                 }
-                flushClient(c, now);
             }
+            netFreeClients(&net_output);
+            netFiltersReclaim(now);
+            next_second = now + 1000;
+        }
+
+        serviceReconnectCallback(&net_output, now);
+
+        // Sleep until output is queued or a socket is ready
+        atomic_store(&net_thread_sleeping, true);
+        atomic_thread_fence(memory_order_seq_cst);
+        netPoll(&net_output, netRingCount(&net_filled) ? 0 : 100);
+        atomic_store(&net_thread_sleeping, false);
+    }
+
+    // send what is left
+    netThreadDeliver(system_mstime());
+    return NULL;
+}
+
+// If a writer generated no messages for a while, send a heartbeat
+
+static void writerHeartbeat(struct net_writer *writer, uint64_t now) {
+    if (!writer->send_heartbeat)
+        return;
+    if (!atomic_load_explicit(&writer->clients, memory_order_relaxed)) {
+        writer->lastWrite = now; // suppress heartbeat initially
+        return;
+    }
+    if ((writer->lastWrite + Modes.net_heartbeat_interval) <= now) {
+        writer->send_heartbeat(writer);
+    }
+}
+
+void modesNetSecondWork(void) {
+    struct net_service *s;
+    uint64_t now = mstime();
+
+    if (Modes.net_heartbeat_interval) {
+        for (s = Modes.services; s; s = s->next) {
+            if (s->writer)
+                writerHeartbeat(s->writer, now);
         }
+        for (int i = 0, filters = netFiltersReady(); i < filters; i++) {
+            for (int j = 0; net_filters[i].ready && j < NET_FILTER_OUTPUTS; j++)
+                writerHeartbeat(&net_filters[i].filter->writers[j], now);
+        }
+    }
+
+    netFreeClients(&net_main);
+}
+
+// Add the system call counts of a reactor to the stats
+
+static void netCollectStats(struct net_reactor *r, struct stats *st) {
+    st->net_epoll_wait += atomic_exchange_explicit(&r->epoll_wait, 0, memory_order_relaxed);
+    st->net_read += atomic_exchange_explicit(&r->read, 0, memory_order_relaxed);
+    st->net_write += atomic_exchange_explicit(&r->write, 0, memory_order_relaxed);
+    st->net_accept += atomic_exchange_explicit(&r->accept, 0, memory_order_relaxed);
+    st->net_epoll_ctl += atomic_exchange_explicit(&r->epoll_ctl, 0, memory_order_relaxed);
+    st->net_sendq_high_water = max(st->net_sendq_high_water, atomic_exchange_explicit(&r->sendq_high, 0, memory_order_relaxed));
+}
+
+// Add the output the slow consumer policies dropped to the stats, per
+// service and in total
+
+static void netCollectDropped(struct stats *st) {
+    struct {
+        struct net_writer *writer;
+        uint32_t *messages;
+        uint64_t *bytes;
+    } outputs[] = {
+        { &Modes.beast_out, &st->net_slow_dropped_beast_out_messages, &st->net_slow_dropped_beast_out_bytes },
+        { &Modes.beast_reduce_out, &st->net_slow_dropped_beast_reduce_out_messages, &st->net_slow_dropped_beast_reduce_out_bytes },
+        { &Modes.raw_out, &st->net_slow_dropped_raw_out_messages, &st->net_slow_dropped_raw_out_bytes },
+        { &Modes.sbs_out, &st->net_slow_dropped_sbs_out_messages, &st->net_slow_dropped_sbs_out_bytes }
+    };
+
+    for (unsigned i = 0; i < sizeof (outputs) / sizeof (outputs[0]); i++) {
+        unsigned messages = atomic_exchange_explicit(&outputs[i].writer->dropped_messages, 0, memory_order_relaxed);
+        unsigned bytes = atomic_exchange_explicit(&outputs[i].writer->dropped_bytes, 0, memory_order_relaxed);
+
+        *outputs[i].messages += messages;
+        *outputs[i].bytes += bytes;
+        st->net_slow_dropped_messages += messages;
+        st->net_slow_dropped_bytes += bytes;
     }
+}
+
+//
+// Perform periodic network work
+//
+
+void modesNetPeriodicWork(void) {
+    struct net_service *s;
+    uint64_t now = mstime();
+    static uint64_t next_tcp_json;
+
+    // Accept, read from and flush the input sockets that are ready
+    modesNetWait(0);
+
+    netCollectStats(&net_main, &Modes.stats_current);
+    netCollectStats(&net_output, &Modes.stats_current);
+    netCollectDropped(&Modes.stats_current);
+    Modes.stats_current.net_queue_chunks += atomic_exchange_explicit(&net_queue_chunks, 0, memory_order_relaxed);
+    Modes.stats_current.net_queue_latency_sum += atomic_exchange_explicit(&net_queue_latency_sum, 0, memory_order_relaxed);
+    uint64_t latency_max = atomic_exchange_explicit(&net_queue_latency_max, 0, memory_order_relaxed);
+    if (latency_max > Modes.stats_current.net_queue_latency_max)
+        Modes.stats_current.net_queue_latency_max = latency_max;
+
+    if (Modes.mode_ac_auto)
+        Modes.mode_ac = atomic_load(&net_modeac);
 
     // Generate FATSV output
     writeFATSV();
@@ -3191,8 +4623,15 @@ void modesNetPeriodicWork(void) {
             flushWrites(s->writer);
         }
     }
+    for (int i = 0, filters = netFiltersReady(); i < filters; i++) {
+        for (int j = 0; net_filters[i].ready && j < NET_FILTER_OUTPUTS; j++) {
+            struct net_writer *writer = &net_filters[i].filter->writers[j];
+            if (writer->dataUsed && (writer->lastWrite + Modes.net_output_flush_interval) <= now)
+                flushWrites(writer);
+        }
+    }
 
-    serviceReconnectCallback(now);
+    serviceReconnectCallback(&net_main, system_mstime());
 }
 
 void writeJsonToNet(struct net_writer *writer, struct char_buffer cb) {
@@ -3208,6 +4647,16 @@ void writeJsonToNet(struct net_writer *writer, struct char_buffer cb) {
         return;
     }
 
+    // flushWrites() drops a buffer if the network thread hasn't given one
+    // back, which would cut a piece out of the middle of the document: unless
+    // there are free buffers for all of it, drop it whole. Each piece flushes
+    // at most one buffer, plus one for data already pending.
+    if (netRingCount(&net_free) < (unsigned) ((len + bytes - 1) / bytes + 1)) {
+        Modes.stats_current.net_queue_dropped++;
+        free(content);
+        return;
+    }
+
     pos = content;
 
     while (p && written < len) {
@@ -3401,17 +4850,36 @@ static void *pthreadGetaddrinfo(void *param) {
 }
 
 inline void cleanupNetwork(void) {
+    struct net_chunk *chunk;
+
+    if (net_thread_started) {
+        atomic_store(&net_thread_stop, true);
+        atomic_store(&net_thread_sleeping, true); // wake it even if it is busy
+        netThreadWake();
+        pthread_join(net_thread, NULL);
+        net_thread_started = false;
+    }
+    while ((chunk = netRingPop(&net_free)))
+        netChunkFree(chunk);
+    for (int i = 0; i < atomic_load(&net_filter_count); i++) {
+        netFilterFree(net_filters[i].filter);
+        net_filters[i].filter = NULL;
+        atomic_store(&net_filters[i].state, NET_FILTER_FREE);
+        net_filters[i].ready = false;
+    }
+    atomic_store(&net_filter_count, 0);
+    if (net_wakeup.fd >= 0) {
+        close(net_wakeup.fd);
+        net_wakeup.fd = -1;
+    }
+
     for (struct net_service *s = Modes.services; s; s = s->next) {
         struct client *c = s->clients, *nc;
         while (c) {
             nc = c->next;
 
             anetCloseSocket(c->fd);
-            c->sendq_len = 0;
-            if (c->sendq) {
-                free(c->sendq);
-                c->sendq = NULL;
-            }
+            clientFreeSendQ(c);
             free(c);
 
             c = nc;
@@ -3422,8 +4890,10 @@ inline void cleanupNetwork(void) {
     while (s) {
         ns = s->next;
         free(s->listener_fds);
-        if (s->writer && s->writer->data) {
-            free(s->writer->data);
+        free(s->listener_epoll);
+        if (s->writer && s->writer->chunk) {
+            netChunkFree(s->writer->chunk);
+            s->writer->chunk = NULL;
             s->writer->data = NULL;
         }
         if (s) free(s);
@@ -3445,4 +4915,12 @@ inline void cleanupNetwork(void) {
         free(con);
     }
     free(Modes.net_connectors);
+
+    struct net_reactor *reactors[] = {&net_main, &net_output};
+    for (int i = 0; i < 2; i++) {
+        if (reactors[i]->epfd >= 0) {
+            close(reactors[i]->epfd);
+            reactors[i]->epfd = -1;
+        }
+    }
 }
@@ -25,6 +25,7 @@
 #define NETIO_H
 
 #include <sys/socket.h>
+#include <stdatomic.h>
 
 // Describes a networking service (group of connections)
 
@@ -32,8 +33,13 @@ struct aircraft;
 struct modesMessage;
 struct client;
 struct net_service;
+struct net_reactor;
+struct net_chunk;
+struct net_chunk_ref;
+struct net_coalesce;
+struct net_writer;
 typedef int (*read_fn)(struct client *, char *, int);
-typedef void (*heartbeat_fn)(struct net_service *);
+typedef void (*heartbeat_fn)(struct net_writer *);
 
 typedef enum {
     READ_MODE_IGNORE,
@@ -42,6 +48,55 @@ typedef enum {
     READ_MODE_ASCII
 } read_mode_t;
 
+/* What a registered epoll event refers to */
+typedef enum {
+    NET_EPOLL_LISTENER,
+    NET_EPOLL_CLIENT,
+    NET_EPOLL_CONNECTOR,
+    NET_EPOLL_WAKEUP
+} net_epoll_type_t;
+
+struct net_epoll {
+    net_epoll_type_t type;
+    int fd;
+    void *owner; // struct net_service, client or net_connector, by type
+};
+
+// Beast binary input is framed by a streaming deframer that unescapes the
+// frames as it finds them and keeps a frame cut short by the end of the
+// data for the next read, so no byte is looked at twice.
+
+#define BEAST_FRAME_MAX 27 // longest unescaped frame from its type byte, a 24 byte GNS HULC message
+
+struct beast_frame {
+    char data[BEAST_FRAME_MAX]; // unescaped, starting at the type byte
+    unsigned char len;
+};
+
+typedef enum {
+    BEAST_SYNC, // looking for a 0x1a
+    BEAST_TYPE, // next byte is a frame type
+    BEAST_BODY,
+    BEAST_ESCAPE // last byte was a 0x1a inside a frame
+} beast_state_t;
+
+// Zero-initialise to start with an empty stream
+struct beast_deframer {
+    beast_state_t state;
+    int len; // bytes of the frame in progress
+    int need; // its full length once known
+    unsigned skipped; // bytes of garbage skipped, for the caller to clear
+    char partial[BEAST_FRAME_MAX]; // frame in progress when the data ran out
+};
+
+/* What to do with a client whose SendQ is full */
+typedef enum {
+    NET_SLOW_DISCONNECT, // the default
+    NET_SLOW_DROP_OLDEST, // drop queued output that wasn't sent yet
+    NET_SLOW_DROP_NEWEST, // drop the output that doesn't fit
+    NET_SLOW_COALESCE // keep only the latest position of each aircraft until the client caught up
+} net_slow_policy_t;
+
 /* Data mode to feed push server */
 typedef enum {
     PUSH_MODE_RAW,
@@ -54,16 +109,18 @@ typedef enum {
 struct net_service {
     int listener_count; // number of listeners
     int pusher_count; // Number of push servers connected to
-    int connections; // number of active clients
+    atomic_int connections; // number of active clients, also read by the main thread
     read_mode_t read_mode;
     read_fn read_handler;
     struct net_writer *writer; // shared writer state
     struct net_service* next;
     int *listener_fds; // listening FDs
+    struct net_epoll *listener_epoll; // epoll registration of each listener
     const char *read_sep; // hander details for input data
     int read_sep_len;
     const char *descr;
     struct client *clients; // linked list of clients connected to this service
+    struct net_reactor *reactor; // thread handling the sockets of this service
 };
 
 // Client connection
@@ -85,6 +142,7 @@ struct net_connector {
     int gai_request_in_progress;
     pthread_t thread;
     pthread_mutex_t *mutex;
+    struct net_epoll epoll; // registered while connecting
 };
 
 // Structure used to describe a networking client
@@ -95,22 +153,35 @@ struct client {
     int fd; // File descriptor
     int buflen; // Amount of data on buffer
     int modeac_requested; // 1 if this Beast output connection has asked for A/C
+    int handshake; // 1 while an output client may still send a FILTER line
+    struct net_writer *writer; // Whose output the client gets, its service's or that of its filter
     uint64_t last_flush;
     uint64_t last_send;
     uint64_t last_read; // This is used on write-only clients to help check for dead connections
     char buf[MODES_CLIENT_BUF_SIZE + 4]; // Read buffer+padding
-    void *sendq; // Write buffer - allocated later
+    struct beast_deframer beast; // Beast binary input state between reads
+    struct net_chunk_ref *sendq; // Ring of output chunks waiting to be sent - allocated later
+    int sendq_head; // Oldest chunk in SendQ
+    int sendq_count; // Number of chunks in SendQ
+    int sendq_alloc; // Size of the ring, a power of two
     int sendq_len; // Amount of data in SendQ
     int sendq_max; // Max size of SendQ
+    int sendq_high; // Most data ever in SendQ
+    uint64_t dropped_bytes; // Output dropped by the slow consumer policy
+    uint64_t dropped_messages;
+    struct net_coalesce *coalesce; // Latest positions held back by NET_SLOW_COALESCE - allocated later
     char host[NI_MAXHOST]; // For logging
     char port[NI_MAXSERV];
     struct net_connector *con;
+    struct net_epoll epoll;
+    int epoll_out; // 1 while waiting for the socket to become writable
 };
 
 // Common writer state for all output sockets of one type
 
 struct net_writer {
-    void *data; // shared write buffer, sized MODES_OUT_BUF_SIZE
+    void *data; // write buffer, sized MODES_OUT_BUF_SIZE, the data of chunk
+    struct net_chunk *chunk; // buffer being filled, handed to the network thread when flushed
     int dataUsed; // number of bytes of write buffer currently used
 #if !defined(__arm__)
     uint32_t padding;
@@ -118,6 +189,10 @@ struct net_writer {
     struct net_service *service; // owning service
     heartbeat_fn send_heartbeat; // function that queues a heartbeat if needed
     uint64_t lastWrite; // time of last write to clients
+    net_slow_policy_t slow_policy; // for clients that can't keep up, set by --net-slow-policy
+    atomic_int clients; // number of clients getting this output, also read by the main thread
+    atomic_uint dropped_bytes; // by the slow consumer policy, collected into the stats by the main thread
+    atomic_uint dropped_messages;
 };
 
 // GNS HULC status message
@@ -140,7 +215,6 @@ typedef union __packed {
 
 struct net_service *serviceInit(const char *descr, struct net_writer *writer, heartbeat_fn hb_handler, read_mode_t mode, const char *sep, read_fn read_handler);
 struct client *serviceConnect(struct net_connector *con);
-void serviceReconnectCallback(uint64_t now);
 struct client *checkServiceConnected(struct net_connector *con);
 void serviceListen(struct net_service *service, char *bind_addr, char *bind_ports);
 struct client *createSocketClient(struct net_service *service, int fd);
@@ -148,6 +222,8 @@ struct client *createGenericClient(struct net_service *service, int fd);
 
 // viewadsb want to create these itselves
 struct net_service *makeBeastInputService(void);
+bool beastDeframe(struct beast_deframer *d, char **p, char *end, struct beast_frame *out);
+void decodeBeastMessage(char *p, int remote);
 struct net_service *makeFatsvOutputService(void);
 
 struct char_buffer {
@@ -156,11 +232,13 @@ struct char_buffer {
 };
 
 void sendBeastSettings(int fd, const char *settings);
+bool netParseSlowPolicy(const char *arg);
 
 void modesInitNet(void);
 void modesQueueOutput(struct modesMessage *mm, struct aircraft *a);
 void modesNetSecondWork(void);
 void modesNetPeriodicWork(void);
+void modesNetWait(int timeout_ms);
 void cleanupNetwork(void);
 
 struct char_buffer generateVRS(int part, int n_parts);
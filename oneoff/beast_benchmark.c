@@ -0,0 +1,239 @@
+// Part of readsb, a Mode-S/ADSB/TIS message decoder.
+//
+// beast_benchmark.c: speed benchmark for the Beast binary deframer
+//
+// Copyright (c) 2020 Michael Wolf <michael@mictronics.de>
+//
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// any later version.
+//
+// This file is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Feeds a captured Beast stream, e.g. recorded from a feeder with
+//
+//   nc feeder 30005 > capture.bin
+//
+// to beastDeframe() in read sized pieces and measures how fast it frames
+// and unescapes it. For comparison the same is done with the earlier
+// three pass parser: find the 0x1a, rescan the frame for doubled escapes,
+// then unescape it while copying, keeping partial frames by moving them to
+// the start of the buffer.
+//
+//   make oneoff/beast_benchmark && ./oneoff/beast_benchmark -r 1500 capture.bin
+
+#include "../readsb.h"
+
+#include <getopt.h>
+
+struct _Modes Modes;
+
+static struct {
+    unsigned read_size; // bytes handed over at a time, as by one read()
+    unsigned passes;
+} config = { 4096, 20 };
+
+static char *capture;
+static size_t capture_len;
+
+struct result {
+    uint64_t frames;
+    uint64_t checksum; // over the unescaped frames, both parsers must agree
+};
+
+static void checksum(struct result *r, const char *data, int len) {
+    for (int i = 0; i < len; i++)
+        r->checksum = r->checksum * 31 + (unsigned char) data[i];
+    r->frames++;
+}
+
+// The earlier parser
+
+static char *legacyNextMessage(char **som, char *eod, char **eom) {
+    char *p;
+
+    while (*som < eod && ((p = memchr(*som, (char) 0x1a, eod - *som)) != NULL)) {
+        *som = p;
+        ++p;
+
+        if (p >= eod)
+            return NULL;
+
+        if (*p == '1') {
+            *eom = p + MODEAC_MSG_BYTES + 8;
+        } else if (*p == '2') {
+            *eom = p + MODES_SHORT_MSG_BYTES + 8;
+        } else if (*p == '3' || *p == '4' || *p == '5') {
+            *eom = p + MODES_LONG_MSG_BYTES + 8;
+        } else if (*p == 'H') {
+            if (p + 2 >= eod)
+                return NULL;
+            int len = *(unsigned char *) (p + 2);
+            if (len > 24) {
+                ++*som;
+                continue;
+            }
+            *eom = p + len + 3;
+        } else {
+            ++*som;
+            continue;
+        }
+
+        for (p = *som + 1; p < eod && p < *eom; p++) {
+            if (0x1A == *p) {
+                p++;
+                ++*eom;
+            }
+        }
+
+        if (*eom > eod)
+            return NULL;
+
+        return *som + 1;
+    }
+
+    return NULL;
+}
+
+static void runLegacy(struct result *r) {
+    static char buf[MODES_CLIENT_BUF_SIZE + 4];
+    int buflen = 0;
+
+    for (size_t off = 0; off < capture_len; off += config.read_size) {
+        int nread = min(config.read_size, capture_len - off);
+        if (buflen + nread > MODES_CLIENT_BUF_SIZE)
+            buflen = 0;
+        memcpy(buf + buflen, capture + off, nread);
+        buflen += nread;
+
+        char *som = buf;
+        char *eod = buf + buflen;
+        char *p, *eom;
+        while ((p = legacyNextMessage(&som, eod, &eom))) {
+            char frame[BEAST_FRAME_MAX];
+            int len = 0;
+            while (p < eom && len < BEAST_FRAME_MAX) {
+                char ch = *p++;
+                frame[len++] = ch;
+                if (0x1A == ch)
+                    p++;
+            }
+            checksum(r, frame, len);
+            som = eom;
+        }
+
+        buflen = eod - som;
+        memmove(buf, som, buflen);
+    }
+}
+
+static void runDeframer(struct result *r) {
+    struct beast_deframer d = { 0 };
+    struct beast_frame frames[64];
+
+    for (size_t off = 0; off < capture_len; off += config.read_size) {
+        char *p = capture + off;
+        char *end = p + min(config.read_size, capture_len - off);
+
+        while (p < end) {
+            int n = 0;
+            while (n < 64 && beastDeframe(&d, &p, end, &frames[n]))
+                n++;
+            for (int i = 0; i < n; i++)
+                checksum(r, frames[i].data, frames[i].len);
+        }
+    }
+}
+
+static void measure(const char *name, void (*run)(struct result *), struct result *r) {
+    struct timespec total = { 0, 0 };
+
+    for (unsigned pass = 0; pass < config.passes; ++pass) {
+        struct timespec start;
+
+        memset(r, 0, sizeof (*r));
+        start_cpu_timing(&start);
+        run(r);
+        end_cpu_timing(&start, &total);
+    }
+
+    double nanos = (total.tv_sec * 1e9 + total.tv_nsec) / config.passes;
+    fprintf(stderr, "%s:\n", name);
+    fprintf(stderr, "  %llu frames in %.6f seconds\n", (unsigned long long) r->frames, nanos / 1e9);
+    fprintf(stderr, "  %.2f MB/second, %.2fM frames/second\n", capture_len / nanos * 1e3, r->frames / nanos * 1e3);
+}
+
+static void usage(const char *name) {
+    fprintf(stderr,
+            "Usage: %s [options] <capture file>\n"
+            "  -r <bytes>     bytes per read (default %u)\n"
+            "  -i <n>         passes for the speed measurement (default %u)\n",
+            name, config.read_size, config.passes);
+}
+
+static bool load(const char *filename) {
+    FILE *f = fopen(filename, "rb");
+    if (!f) {
+        fprintf(stderr, "%s: %s\n", filename, strerror(errno));
+        return false;
+    }
+
+    size_t alloc = 1024 * 1024;
+    capture = malloc(alloc);
+    for (size_t n; capture && (n = fread(capture + capture_len, 1, alloc - capture_len, f)) > 0; ) {
+        capture_len += n;
+        if (capture_len == alloc)
+            capture = realloc(capture, alloc *= 2);
+    }
+    fclose(f);
+
+    if (!capture) {
+        fprintf(stderr, "Out of memory loading %s\n", filename);
+        exit(1);
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    int opt;
+
+    while ((opt = getopt(argc, argv, "r:i:h")) != -1) {
+        switch (opt) {
+            case 'r':
+                config.read_size = max(1, min(atoi(optarg), MODES_CLIENT_BUF_SIZE / 2));
+                break;
+            case 'i':
+                config.passes = max(1, atoi(optarg));
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (optind != argc - 1) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (!load(argv[optind]))
+        return 1;
+
+    fprintf(stderr, "%zu bytes, %u bytes per read, %u passes\n", capture_len, config.read_size, config.passes);
+
+    struct result legacy, deframer;
+    measure("Three pass parser", runLegacy, &legacy);
+    measure("beastDeframe()", runDeframer, &deframer);
+
+    if (legacy.frames != deframer.frames || legacy.checksum != deframer.checksum)
+        fprintf(stderr, "Frames differ: the capture has broken escapes or a HULC message the parsers handle differently\n");
+
+    free(capture);
+    return 0;
+}
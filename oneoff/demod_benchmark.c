@@ -0,0 +1,454 @@
+// Part of readsb, a Mode-S/ADSB/TIS message decoder.
+//
+// demod_benchmark.c: speed and accuracy benchmark for the Mode S demodulator
+//
+// Copyright (c) 2020 Michael Wolf <michael@mictronics.de>
+//
+// This code is based on a detached fork of dump1090-fa.
+//
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// any later version.
+//
+// This file is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Synthesizes magnitude buffers with known DF11/DF17/DF20 frames, runs them
+// through the demodulator selected for the sample rate and compares what
+// comes out of it with what went in. No SDR needed:
+//
+//   make oneoff/demod_benchmark && ./oneoff/demod_benchmark -s 6:20 -c 0.1
+//
+// Decoded messages are intercepted by linking with --wrap=useModesMessage,
+// so the tracking and output layers are not part of the timing.
+
+#include "../readsb.h"
+
+#include <getopt.h>
+
+struct _Modes Modes;
+
+// 120MHz synthesis clock: one symbol (500ns) is 60 ticks, one sample is
+// 50 ticks at 2.4MHz, 60 at 2.0MHz, 20 at 6.0MHz, 15 at 8.0MHz
+#define TICKS_PER_US 120
+#define TICKS_PER_SYMBOL (TICKS_PER_US / 2)
+
+#define NUM_AIRCRAFT 50
+
+struct frame {
+    uint64_t start; // start of the preamble, in ticks
+    uint8_t msg[MODES_LONG_MSG_BYTES];
+    int bits;
+    int df;
+    int phase; // start offset within a sample, in 1/5 of a sample
+    bool decoded;
+};
+
+static struct {
+    unsigned nframes;
+    double snr_min, snr_max; // dB, signal power over noise power
+    int phase; // 0..4, -1 = random
+    double collision_rate; // fraction of frames that start while the previous one is still on air
+    double noise_floor; // dBFS
+    unsigned gap; // maximum idle time between frames, us
+    bool df11, df17, df20;
+    unsigned seed;
+    unsigned passes;
+} config = { 20000, 6, 20, -1, 0.05, -30, 400, true, true, true, 1, 5 };
+
+static struct frame *frames;
+static unsigned frame_count;
+static uint16_t *stream; // all magnitude samples
+static uint64_t stream_len;
+
+static struct mag_buf *bufs;
+static unsigned buf_count;
+
+static unsigned tps; // ticks per sample
+static bool counting; // match decoded messages against the frames (first pass only)
+static uint64_t decoded_total;
+static uint64_t decoded_false;
+
+static double uniform(void) {
+    return rand() / (RAND_MAX + 1.0);
+}
+
+static double gauss(void) {
+    double u = (rand() + 1.0) / (RAND_MAX + 2.0);
+    double v = (rand() + 1.0) / (RAND_MAX + 2.0);
+    return sqrt(-2 * log(u)) * cos(2 * M_PI * v);
+}
+
+static void make_message(struct frame *f, uint32_t addr) {
+    uint8_t *m = f->msg;
+    uint32_t crc;
+
+    memset(m, 0, sizeof (f->msg));
+    switch (f->df) {
+        case 11:
+            f->bits = MODES_SHORT_MSG_BITS;
+            m[0] = (11 << 3) | 5;
+            m[1] = addr >> 16;
+            m[2] = addr >> 8;
+            m[3] = addr;
+            break;
+        case 17:
+            f->bits = MODES_LONG_MSG_BITS;
+            m[0] = (17 << 3) | 5;
+            m[1] = addr >> 16;
+            m[2] = addr >> 8;
+            m[3] = addr;
+            for (int i = 4; i < 11; ++i)
+                m[i] = rand();
+            m[4] = (11 << 3) | (m[4] & 7); // airborne position
+            break;
+        case 20:
+            f->bits = MODES_LONG_MSG_BITS;
+            m[0] = 20 << 3;
+            for (int i = 1; i < 11; ++i)
+                m[i] = rand();
+            m[4] = 0x20; // BDS 2,0
+            break;
+    }
+
+    // with zero parity bytes the checksum is the CRC of the data bits
+    crc = modesChecksum(m, f->bits);
+    if (f->df == 20)
+        crc ^= addr; // address/parity
+
+    m[f->bits / 8 - 3] = crc >> 16;
+    m[f->bits / 8 - 2] = crc >> 8;
+    m[f->bits / 8 - 1] = crc;
+}
+
+// Add one pulse of amplitude (re, im) covering ticks t0..t1-1
+
+static void add_pulse(float *I, float *Q, uint64_t t0, uint64_t t1, float re, float im) {
+    for (uint64_t k = t0 / tps; k * tps < t1; ++k) {
+        uint64_t from = max(t0, k * tps);
+        uint64_t to = min(t1, (k + 1) * tps);
+        float frac = (float) (to - from) / tps;
+        I[k] += re * frac;
+        Q[k] += im * frac;
+    }
+}
+
+static void prepare(void) {
+    uint32_t icaos[NUM_AIRCRAFT];
+    int dfs[3], ndfs = 0;
+
+    srand(config.seed);
+    tps = (unsigned) (TICKS_PER_US * 1e6 / Modes.sample_rate + 0.5);
+
+    if (config.df11)
+        dfs[ndfs++] = 11;
+    if (config.df17)
+        dfs[ndfs++] = 17;
+    if (config.df20)
+        dfs[ndfs++] = 20;
+
+    for (int i = 0; i < NUM_AIRCRAFT; ++i)
+        icaos[i] = (rand() & 0xffffff) | 0x100000;
+
+    // generate the frames and their start times
+    frames = calloc(config.nframes, sizeof (*frames));
+    uint64_t t = 1000 * TICKS_PER_US;
+    uint64_t prev_end = 0;
+    for (unsigned n = 0; n < config.nframes; ++n) {
+        struct frame *f = &frames[n];
+
+        f->df = dfs[rand() % ndfs];
+        make_message(f, icaos[rand() % NUM_AIRCRAFT]);
+
+        if (n > 0 && uniform() < config.collision_rate) {
+            // start somewhere inside the previous frame
+            t = frames[n - 1].start + (uint64_t) (uniform() * (prev_end - frames[n - 1].start));
+        } else {
+            t = max(t, prev_end) + (uint64_t) (uniform() * config.gap * TICKS_PER_US);
+        }
+
+        f->phase = config.phase >= 0 ? config.phase : rand() % 5;
+        f->start = t / tps * tps + f->phase * tps / 5;
+        t = f->start;
+        prev_end = max(prev_end, f->start + (MODES_PREAMBLE_US + f->bits) * TICKS_PER_US);
+    }
+    frame_count = config.nframes;
+
+    // render the frames with noise
+    stream_len = prev_end / tps + 1000;
+    float *I = calloc(stream_len, sizeof (float));
+    float *Q = calloc(stream_len, sizeof (float));
+    stream = calloc(stream_len, sizeof (uint16_t));
+    if (!I || !Q || !stream) {
+        fprintf(stderr, "Out of memory allocating %llu samples\n", (unsigned long long) stream_len);
+        exit(1);
+    }
+
+    double sigma = sqrt(pow(10, config.noise_floor / 10) / 2); // per I/Q component
+    for (unsigned n = 0; n < frame_count; ++n) {
+        struct frame *f = &frames[n];
+        double snr = config.snr_min + uniform() * (config.snr_max - config.snr_min);
+        double amplitude = sigma * sqrt(2) * pow(10, snr / 20);
+        double carrier = uniform() * 2 * M_PI;
+        float re = amplitude * cos(carrier), im = amplitude * sin(carrier);
+        static const int preamble[] = { 0, 2, 7, 9 };
+
+        for (int i = 0; i < 4; ++i)
+            add_pulse(I, Q, f->start + preamble[i] * TICKS_PER_SYMBOL, f->start + (preamble[i] + 1) * TICKS_PER_SYMBOL, re, im);
+
+        for (int i = 0; i < f->bits; ++i) {
+            int bit = (f->msg[i / 8] >> (7 - i % 8)) & 1;
+            uint64_t symbol = f->start + (16 + 2 * i + (bit ? 0 : 1)) * TICKS_PER_SYMBOL;
+            add_pulse(I, Q, symbol, symbol + TICKS_PER_SYMBOL, re, im);
+        }
+    }
+
+    for (uint64_t k = 0; k < stream_len; ++k) {
+        double i = I[k] + sigma * gauss();
+        double q = Q[k] + sigma * gauss();
+        double mag = sqrt(i * i + q * q) * 65535.0;
+        stream[k] = mag > 65535 ? 65535 : (uint16_t) mag;
+    }
+    free(I);
+    free(Q);
+
+    // cut the stream into mag_bufs the way the SDR code does
+    unsigned overlap = Modes.trailing_samples;
+    buf_count = (stream_len + MODES_MAG_BUF_SAMPLES - 1) / MODES_MAG_BUF_SAMPLES;
+    bufs = calloc(buf_count, sizeof (*bufs));
+    for (unsigned b = 0; b < buf_count; ++b) {
+        struct mag_buf *buf = &bufs[b];
+        uint64_t first = (uint64_t) b * MODES_MAG_BUF_SAMPLES;
+        unsigned samples = min(MODES_MAG_BUF_SAMPLES, stream_len - first);
+        double sum_level = 0, sum_power = 0;
+
+        buf->totalLength = overlap + MODES_MAG_BUF_SAMPLES;
+        buf->data = calloc(buf->totalLength, sizeof (uint16_t));
+        buf->overlap = overlap;
+        buf->validLength = overlap + samples;
+        buf->sampleTimestamp = first * tps / 10; // 12MHz clock
+        buf->sysTimestamp = buf->sampleTimestamp / 12000U;
+
+        for (unsigned k = 0; k < overlap; ++k)
+            buf->data[k] = first + k >= overlap ? stream[first + k - overlap] : 0;
+        memcpy(&buf->data[overlap], &stream[first], samples * sizeof (uint16_t));
+
+        for (unsigned k = 0; k < samples; ++k) {
+            double level = stream[first + k] / 65535.0;
+            sum_level += level;
+            sum_power += level * level;
+        }
+        buf->mean_level = sum_level / samples;
+        buf->mean_power = sum_power / samples;
+    }
+}
+
+// Find the frame a decoded message came from, by content, among the
+// frames that started within 20us of the message
+
+void __real_useModesMessage(struct modesMessage *mm);
+void __wrap_useModesMessage(struct modesMessage *mm);
+
+void __wrap_useModesMessage(struct modesMessage *mm) {
+    if (!counting || mm->msgtype == 32)
+        return;
+
+    decoded_total++;
+
+    // the demodulator timestamps the end of bit 56, and like with the SDRs
+    // sampleTimestamp is the time of the first sample after the overlap
+    uint64_t t = (mm->timestampMsg - (MODES_PREAMBLE_US + 56) * 12) * 10 - Modes.trailing_samples * tps;
+    uint64_t window = 20 * TICKS_PER_US;
+    unsigned lo = 0, hi = frame_count;
+
+    while (lo < hi) {
+        unsigned mid = (lo + hi) / 2;
+        if (frames[mid].start + window < t)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    for (unsigned n = lo; n < frame_count && frames[n].start <= t + window; ++n) {
+        if (!frames[n].decoded && frames[n].bits == mm->msgbits && !memcmp(frames[n].msg, mm->msg, mm->msgbits / 8)) {
+            frames[n].decoded = true;
+            return;
+        }
+    }
+
+    decoded_false++;
+}
+
+static void run(void) {
+    struct timespec total = { 0, 0 };
+    uint64_t samples = 0;
+    uint32_t preambles = 0;
+
+    for (unsigned pass = 0; pass < config.passes; ++pass) {
+        struct timespec start;
+
+        memset(&Modes.stats_current, 0, sizeof (Modes.stats_current));
+        counting = (pass == 0);
+
+        start_cpu_timing(&start);
+        for (unsigned b = 0; b < buf_count; ++b)
+            demodulate(&bufs[b]);
+        end_cpu_timing(&start, &total);
+
+        samples += stream_len;
+        preambles += Modes.stats_current.demod_preambles;
+
+        if (pass == 0) {
+            struct stats *st = &Modes.stats_current;
+            unsigned sent[32] = { 0 }, got[32] = { 0 };
+            unsigned phase_sent[5] = { 0 }, phase_got[5] = { 0 };
+            unsigned decoded = 0;
+
+            for (unsigned n = 0; n < frame_count; ++n) {
+                sent[frames[n].df]++;
+                phase_sent[frames[n].phase]++;
+                if (frames[n].decoded) {
+                    got[frames[n].df]++;
+                    phase_got[frames[n].phase]++;
+                    decoded++;
+                }
+            }
+
+            fprintf(stderr, "Accuracy:\n");
+            fprintf(stderr, "  %u frames, %u decoded (%.2f%%)\n", frame_count, decoded, 100.0 * decoded / frame_count);
+            for (int df = 0; df < 32; ++df) {
+                if (sent[df])
+                    fprintf(stderr, "    DF%-2d %7u frames, %7u decoded (%.2f%%)\n", df, sent[df], got[df], 100.0 * got[df] / sent[df]);
+            }
+            fprintf(stderr, "  %llu messages out of the demodulator, %llu not matching any frame or duplicates\n",
+                    (unsigned long long) decoded_total, (unsigned long long) decoded_false);
+            fprintf(stderr, "  %u preambles, %u rejected bad, %u unknown ICAO\n",
+                    st->demod_preambles, st->demod_rejected_bad, st->demod_rejected_unknown_icao);
+
+            fprintf(stderr, "  decoded by frame phase offset (1/5 sample):\n   ");
+            for (int i = 0; i < 5; ++i)
+                fprintf(stderr, " %7d", i);
+            fprintf(stderr, "\n   ");
+            for (int i = 0; i < 5; ++i)
+                fprintf(stderr, " %6.2f%%", phase_sent[i] ? 100.0 * phase_got[i] / phase_sent[i] : 0.0);
+            fprintf(stderr, "\n  demodulator phase hits (tried / best):\n   ");
+            for (int i = 0; i < 5; ++i)
+                fprintf(stderr, " %7d", i + 4);
+            fprintf(stderr, "\n   ");
+            for (int i = 0; i < 5; ++i)
+                fprintf(stderr, " %7u", st->demod_preamblePhase[i]);
+            fprintf(stderr, "\n   ");
+            for (int i = 0; i < 5; ++i)
+                fprintf(stderr, " %7u", st->demod_bestPhase[i]);
+            fprintf(stderr, "\n");
+        }
+    }
+
+    double nanos = total.tv_sec * 1e9 + total.tv_nsec;
+    fprintf(stderr, "Speed:\n");
+    fprintf(stderr, "  %.2fM samples in %.6f seconds\n", samples / 1e6, nanos / 1e9);
+    fprintf(stderr, "  %.2fM samples/second\n", samples / nanos * 1e3);
+    fprintf(stderr, "  %.2fk preambles/second\n", preambles / nanos * 1e6);
+}
+
+static void usage(const char *name) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  -f <n>         number of frames (default %u)\n"
+            "  -s <min[:max]> SNR in dB, uniformly distributed (default %.0f:%.0f)\n"
+            "  -p <0-4>       phase offset in 1/5 sample, -1 = random (default %d)\n"
+            "  -c <rate>      fraction of frames colliding with the previous one (default %.2f)\n"
+            "  -n <dBFS>      noise floor (default %.0f)\n"
+            "  -g <us>        maximum gap between frames (default %u)\n"
+            "  -d <list>      downlink formats, any of 11,17,20 (default all)\n"
+            "  -r <MHz>       sample rate (default 2.4)\n"
+            "  -t <n>         demodulator threads (default 1)\n"
+            "  -i <n>         passes for the speed measurement (default %u)\n"
+            "  -S <seed>      random seed (default %u)\n",
+            name, config.nframes, config.snr_min, config.snr_max, config.phase,
+            config.collision_rate, config.noise_floor, config.gap, config.passes, config.seed);
+}
+
+int main(int argc, char **argv) {
+    int opt;
+
+    Modes.sample_rate = 2400000.0;
+    Modes.preambleThreshold = PREAMBLE_THRESHOLD_DEFAULT;
+    Modes.demod_threads = 1;
+    Modes.nfix_crc = 1;
+    Modes.check_crc = 1;
+    Modes.quiet = 1;
+
+    while ((opt = getopt(argc, argv, "f:s:p:c:n:g:d:r:t:i:S:h")) != -1) {
+        switch (opt) {
+            case 'f':
+                config.nframes = max(1, atoi(optarg));
+                break;
+            case 's':
+                if (sscanf(optarg, "%lf:%lf", &config.snr_min, &config.snr_max) == 1)
+                    config.snr_max = config.snr_min;
+                break;
+            case 'p':
+                config.phase = atoi(optarg) > 4 ? 4 : atoi(optarg);
+                break;
+            case 'c':
+                config.collision_rate = atof(optarg);
+                break;
+            case 'n':
+                config.noise_floor = atof(optarg);
+                break;
+            case 'g':
+                config.gap = atoi(optarg);
+                break;
+            case 'd':
+                config.df11 = strstr(optarg, "11") != NULL;
+                config.df17 = strstr(optarg, "17") != NULL;
+                config.df20 = strstr(optarg, "20") != NULL;
+                if (!config.df11 && !config.df17 && !config.df20) {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'r':
+                if (!demodParseSampleRate(optarg))
+                    return 1;
+                break;
+            case 't':
+                Modes.demod_threads = max(1, min(atoi(optarg), MODES_MAX_DEMOD_THREADS));
+                break;
+            case 'i':
+                config.passes = max(1, atoi(optarg));
+                break;
+            case 'S':
+                config.seed = atoi(optarg);
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    Modes.trailing_samples = (MODES_PREAMBLE_US + MODES_LONG_MSG_BITS + 16) * 1e-6 * Modes.sample_rate;
+
+    modesChecksumInit(Modes.nfix_crc);
+    icaoFilterInit();
+    modeACInit();
+    demodInit();
+
+    prepare();
+
+    fprintf(stderr, "%u frames in %.2f seconds of signal at %.1fMHz, SNR %.0f-%.0f dB, noise floor %.0f dBFS, collision rate %.2f\n",
+            frame_count, stream_len / Modes.sample_rate, Modes.sample_rate / 1e6,
+            config.snr_min, config.snr_max, config.noise_floor, config.collision_rate);
+
+    run();
+
+    demodCleanup();
+    return 0;
+}
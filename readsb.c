@@ -54,6 +54,7 @@
 #define READSB
 #include "readsb.h"
 #include "help.h"
+#include "sdr_beast.h"
 
 #include <stdarg.h>
 
@@ -146,6 +147,10 @@ static void modesInitConfig(void) {
     }
 
     Modes.preambleThreshold = PREAMBLE_THRESHOLD_DEFAULT;
+    Modes.demod_threads = 1;
+    Modes.mag_buffers = MODES_MAG_BUFFERS;
+    Modes.mag_buf_samples = MODES_MAG_BUF_SAMPLES;
+    Modes.sample_rate = (double) 2400000.0;
     if (nprocs < 2) {
         Modes.preambleThreshold = PREAMBLE_THRESHOLD_PIZERO;
     }
@@ -192,12 +197,10 @@ static void modesInit(void) {
         Modes.stats_semptr = NULL;
     }
 
-    Modes.sample_rate = (double) 2400000.0;
-
     // Allocate the various buffers used by Modes
     Modes.trailing_samples = (MODES_PREAMBLE_US + MODES_LONG_MSG_BITS + 16) * 1e-6 * Modes.sample_rate;
 
-    if (!fifo_create(MODES_MAG_BUFFERS, MODES_MAG_BUF_SAMPLES + Modes.trailing_samples, Modes.trailing_samples)) {
+    if (!fifo_create(Modes.mag_buffers, Modes.mag_buffers_max, Modes.mag_buf_samples + Modes.trailing_samples, Modes.trailing_samples)) {
         fprintf(stderr, "Out of memory allocating FIFO\n");
         exit(1);
     }
@@ -241,6 +244,7 @@ static void modesInit(void) {
     modesChecksumInit(Modes.nfix_crc);
     icaoFilterInit();
     modeACInit();
+    demodInit();
 
     if (Modes.show_only)
         icaoFilterAdd(Modes.show_only);
@@ -462,6 +466,8 @@ static void cleanup_and_exit(int code) {
         }
     }
 
+    demodCleanup();
+
     fifo_destroy();
 
     crcCleanupTables();
@@ -485,6 +491,22 @@ static error_t parse_opt(int key, char *arg, struct argp_state *state) {
         case OptDcFilter:
             Modes.dc_filter = 1;
             break;
+        case OptIqAutotune:
+            Modes.converter_autotune = 1;
+            break;
+        case OptPinMemory:
+            Modes.pin_memory = 1;
+            break;
+        case OptFifoDepth:
+            Modes.mag_buffers = (unsigned) max(min(strtoll(arg, NULL, 10), MODES_MAG_BUFFERS_LIMIT), 2);
+            break;
+        case OptFifoMaxDepth:
+            Modes.mag_buffers_max = (unsigned) max(min(strtoll(arg, NULL, 10), MODES_MAG_BUFFERS_LIMIT), 0);
+            break;
+        case OptFifoBlock:
+            Modes.mag_buf_samples = (unsigned) max(min(strtoll(arg, NULL, 10), MODES_MAG_BUF_SAMPLES_MAX), MODES_MAG_BUF_SAMPLES_MIN);
+            Modes.mag_buf_samples -= Modes.mag_buf_samples % MODES_MAG_BUF_SAMPLES_MIN;
+            break;
         case OptBiasTee:
             Modes.biastee = 1;
             break;
@@ -503,6 +525,13 @@ static error_t parse_opt(int key, char *arg, struct argp_state *state) {
         case OptPreambleThreshold:
             Modes.preambleThreshold = (uint32_t) (max(min(strtoll(arg, NULL, 10), PREAMBLE_THRESHOLD_MAX), PREAMBLE_THRESHOLD_MIN));
             break;
+        case OptDemodThreads:
+            Modes.demod_threads = (int) max(min(strtoll(arg, NULL, 10), MODES_MAX_DEMOD_THREADS), 1);
+            break;
+        case OptSampleRate:
+            if (!demodParseSampleRate(arg))
+                return 1;
+            break;
         case OptNet:
             Modes.net = 1;
             break;
@@ -641,6 +670,10 @@ static error_t parse_opt(int key, char *arg, struct argp_state *state) {
         case OptNetVerbatim:
             Modes.net_verbatim = 1;
             break;
+        case OptNetSlowPolicy:
+            if (!netParseSlowPolicy(arg))
+                return 1;
+            break;
         case OptNetConnector:
             if (!Modes.net_connectors || Modes.net_connectors_count + 1 > Modes.net_connectors_size) {
                 Modes.net_connectors_size = Modes.net_connectors_count * 2 + 8;
@@ -701,6 +734,10 @@ static error_t parse_opt(int key, char *arg, struct argp_state *state) {
         case OptIfileName:
         case OptIfileFormat:
         case OptIfileThrottle:
+        case OptIfileBatch:
+        case OptIfileCompression:
+        case OptBeastFileName:
+        case OptBeastFileSpeed:
 #ifdef ENABLE_BLADERF
         case OptBladeFpgaDir:
         case OptBladeDecim:
@@ -746,6 +783,7 @@ int main(int argc, char **argv) {
     /* On a multi-core CPU we run the main thread and reader thread on different cores.
      * Try sticking the main thread to core 1
      */
+    save_process_affinity();
     thread_to_core(1);
 
     // Parse the command line options
@@ -790,9 +828,8 @@ int main(int argc, char **argv) {
 
     /* If the user specifies --net-only, just run in order to serve network
      * clients without reading data from the RTL device.
-     * This rules also in case a local Mode-S Beast is connected via USB.
      */
-    if (Modes.sdr_type == SDR_NONE || Modes.sdr_type == SDR_MODESBEAST || Modes.sdr_type == SDR_GNS) {
+    if (Modes.sdr_type == SDR_NONE) {
         struct timespec slp = {0, 20 * 1000 * 1000};
         while (!Modes.exit) {
             int64_t sleep_millis = 100;
@@ -808,32 +845,70 @@ int main(int argc, char **argv) {
 
             //fprintf(stderr, "%ld\n", sleep_millis);
 
-            slp.tv_nsec = sleep_millis * 1000 * 1000;
-            nanosleep(&slp, NULL);
+            if (Modes.net) {
+                // handle network activity as it arrives rather than after the sleep
+                modesNetWait(sleep_millis);
+            } else {
+                slp.tv_nsec = sleep_millis * 1000 * 1000;
+                nanosleep(&slp, NULL);
+            }
+        }
+    } else if (Modes.sdr_type == SDR_MODESBEAST || Modes.sdr_type == SDR_GNS || Modes.sdr_type == SDR_BEASTFILE) {
+        // The reader thread frames the messages from the serial port or file in batches, we decode them
+        pthread_create(&Modes.reader_thread, NULL, readerThreadEntryPoint, NULL);
+
+        while (!Modes.exit) {
+            struct timespec start_time;
+
+            start_cpu_timing(&start_time);
+            beastProcess(100 /* milliseconds */);
+            backgroundTasks();
+            end_cpu_timing(&start_time, &Modes.stats_current.background_cpu);
         }
+
+        log_with_timestamp("Waiting for receive thread termination");
+        pthread_join(Modes.reader_thread, NULL); // Wait on reader thread exit
     } else {
         int watchdogCounter = 10; // about 1 second
 
         // Create the thread that will read the data from the device.
         pthread_create(&Modes.reader_thread, NULL, readerThreadEntryPoint, NULL);
 
-        while (!Modes.exit) {
-            // get the next sample buffer off the FIFO; wait only up to 100ms
-            // this is fairly aggressive as all our network I/O runs out of the background work!
-            struct mag_buf *buf = fifo_dequeue(100 /* milliseconds */);
+        int batch = demodBatch();
+        int in_flight = 0;
+
+        while (!Modes.exit || in_flight) {
+            struct mag_buf *buf;
             struct timespec start_time;
 
+            if (batch) {
+                // keep up to "batch" buffers in the demodulator, waiting only if it has none
+                // (demodInit() only allows this for inputs that never mark a buffer
+                // discontinuous, so buffers still being demodulated are never touched by
+                // fifo_dequeue)
+                while (!Modes.exit && in_flight < batch && (buf = fifo_dequeue(in_flight ? 0 : 100))) {
+                    demodSubmit(buf);
+                    ++in_flight;
+                }
+            } else {
+                // get the next sample buffer off the FIFO; wait only up to 100ms
+                // this is fairly aggressive as all our network I/O runs out of the background work!
+                buf = fifo_dequeue(100 /* milliseconds */);
+            }
+
+            start_cpu_timing(&start_time);
+            if (batch && (buf = demodComplete()))
+                --in_flight;
+
             if (buf) {
                 // Process one buffer
-                start_cpu_timing(&start_time);
-
-                demodulate2400(buf);
-                if (Modes.mode_ac) {
-                    demodulate2400AC(buf);
-                }
+                if (!batch)
+                    demodulate(buf);
 
                 Modes.stats_current.samples_processed += buf->validLength;
                 Modes.stats_current.samples_dropped += buf->dropped;
+                Modes.stats_current.fifo_depth = max(Modes.stats_current.fifo_depth, fifo_depth());
+                Modes.stats_current.fifo_high_water = max(Modes.stats_current.fifo_high_water, fifo_queued() + 1);
                 end_cpu_timing(&start_time, &Modes.stats_current.demod_cpu);
 
                 // Return the buffer to the FIFO freelist for reuse
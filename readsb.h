@@ -98,6 +98,10 @@
 #define MODES_RTL_BUF_SIZE      (16*16384)                 // 256k
 #define MODES_MAG_BUF_SAMPLES   (MODES_RTL_BUF_SIZE / 2)   // Each sample is 2 bytes
 #define MODES_MAG_BUFFERS       12                         // Number of magnitude buffers (should be smaller than RTL_BUFFERS for flowcontrol to work)
+#define MODES_MAG_BUFFERS_LIMIT 256                        // Maximum --fifo-depth / --fifo-max-depth
+#define MODES_MAG_BUF_SAMPLES_MIN (16*1024)                // Smallest --fifo-block, also its granularity
+#define MODES_MAG_BUF_SAMPLES_MAX (4*1024*1024)            // Largest --fifo-block
+#define MODES_MAX_DEMOD_THREADS 16                         // Maximum number of demodulation threads
 #define MODES_AUTO_GAIN         -100                       // Use automatic gain
 #define MODES_MAX_GAIN          999999                     // Use max available gain
 #define MODEAC_MSG_BYTES        2
@@ -221,6 +225,7 @@ typedef enum {
 #include "net_io.h"
 #include "crc.h"
 #include "demod_2400.h"
+#include "demod.h"
 #include "stats.h"
 #include "cpr.h"
 #include "icao_filter.h"
@@ -233,7 +238,7 @@ typedef enum {
 //======================== structure declarations =========================
 
 typedef enum {
-    SDR_NONE = 0, SDR_IFILE, SDR_RTLSDR, SDR_BLADERF, SDR_MICROBLADERF, SDR_MODESBEAST, SDR_PLUTOSDR, SDR_GNS
+    SDR_NONE = 0, SDR_IFILE, SDR_RTLSDR, SDR_BLADERF, SDR_MICROBLADERF, SDR_MODESBEAST, SDR_PLUTOSDR, SDR_GNS, SDR_BEASTFILE
 } sdr_type_t;
 
 // Program global state
@@ -247,6 +252,8 @@ struct _Modes { // Internal state
     int fd; // --ifile option file descriptor
     input_format_t input_format; // --iformat option
     iq_convert_fn converter_function;
+    char converter_name[64]; // IQ converter in use
+    double converter_rate; // its speed in samples/second if autotuned, else 0
     char * dev_name;
     int gain;
     int enable_agc;
@@ -276,6 +283,13 @@ struct _Modes { // Internal state
     int8_t net; // Enable networking
     int8_t net_only; // Enable just networking
     uint32_t preambleThreshold;
+    int demod_threads; // Number of threads used for demodulation
+    int demod_batch; // --ifile --batch: number of sample blocks demodulated in parallel, 0 = off
+    int8_t converter_autotune; // Time the IQ converters at startup and use the fastest
+    int8_t pin_memory; // Put hot buffers and tables on locked huge pages, see util.h
+    unsigned mag_buffers; // Magnitude FIFO depth (buffers)
+    unsigned mag_buffers_max; // Adaptive FIFO depth limit, 0 = fixed depth
+    unsigned mag_buf_samples; // Samples per magnitude buffer, excluding overlap
     int net_output_flush_size; // Minimum Size of output data
     uint32_t net_connector_delay;
     int filter_persistence; // Maximum number of consecutive implausible positions from global CPR to invalidate a known position.
@@ -286,7 +300,7 @@ struct _Modes { // Internal state
     uint32_t interactive_display_ttl; // Interactive mode: TTL display
     uint64_t stats; // Interval (millis) between stats dumps,
     uint64_t startup_time; // Readsb startup epoch
-    uint64_t ifile_now; // ifile timestamp
+    uint64_t ifile_now; // ifile and beastfile replay time
     uint32_t output_interval; // Interval between rewriting the aircraft file, in milliseconds; also the advertised map refresh interval
     char *net_output_raw_ports; // List of raw output TCP ports
     char *net_input_raw_ports; // List of raw input TCP ports
@@ -557,6 +571,13 @@ enum {
     OptInteractiveTTL,
     OptRaw,
     OptPreambleThreshold,
+    OptDemodThreads,
+    OptSampleRate,
+    OptIqAutotune,
+    OptPinMemory,
+    OptFifoDepth,
+    OptFifoMaxDepth,
+    OptFifoBlock,
     OptModeAc,
     OptNoModeAcAuto,
     OptForwardMlat,
@@ -602,6 +623,7 @@ enum {
     OptNetHeartbeat,
     OptNetBuffer,
     OptNetVerbatim,
+    OptNetSlowPolicy,
     OptRtlSdrEnableAgc,
     OptRtlSdrPpm,
     OptBeastSerial,
@@ -615,6 +637,10 @@ enum {
     OptIfileName,
     OptIfileFormat,
     OptIfileThrottle,
+    OptIfileBatch,
+    OptIfileCompression,
+    OptBeastFileName,
+    OptBeastFileSpeed,
     OptBladeFpgaDir,
     OptBladeDecim,
     OptBladeBw,
@@ -1979,7 +1979,7 @@ const ProtobufCMessageDescriptor receiver__descriptor =
   (ProtobufCMessageInit) receiver__init,
   NULL,NULL,NULL    /* reserved[123] */
 };
-static const ProtobufCFieldDescriptor statistic_entry__field_descriptors[44] =
+static const ProtobufCFieldDescriptor statistic_entry__field_descriptors[72] =
 {
   {
     "start",
@@ -2377,6 +2377,162 @@ static const ProtobufCFieldDescriptor statistic_entry__field_descriptors[44] =
     0,             /* flags */
     0,NULL,NULL    /* reserved1,reserved2, etc */
   },
+  {
+    "net_epoll_wait",
+    75,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT32,
+    0,   /* quantifier_offset */
+    offsetof(StatisticEntry, net_epoll_wait),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "net_read",
+    76,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT32,
+    0,   /* quantifier_offset */
+    offsetof(StatisticEntry, net_read),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "net_write",
+    77,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT32,
+    0,   /* quantifier_offset */
+    offsetof(StatisticEntry, net_write),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "net_accept",
+    78,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT32,
+    0,   /* quantifier_offset */
+    offsetof(StatisticEntry, net_accept),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "net_epoll_ctl",
+    79,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT32,
+    0,   /* quantifier_offset */
+    offsetof(StatisticEntry, net_epoll_ctl),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "net_queue_chunks",
+    80,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT32,
+    0,   /* quantifier_offset */
+    offsetof(StatisticEntry, net_queue_chunks),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "net_queue_high_water",
+    81,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT32,
+    0,   /* quantifier_offset */
+    offsetof(StatisticEntry, net_queue_high_water),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "net_queue_dropped",
+    82,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT32,
+    0,   /* quantifier_offset */
+    offsetof(StatisticEntry, net_queue_dropped),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "net_queue_latency_mean",
+    83,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_FLOAT,
+    0,   /* quantifier_offset */
+    offsetof(StatisticEntry, net_queue_latency_mean),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "net_queue_latency_max",
+    84,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT64,
+    0,   /* quantifier_offset */
+    offsetof(StatisticEntry, net_queue_latency_max),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "net_sendq_high_water",
+    85,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT32,
+    0,   /* quantifier_offset */
+    offsetof(StatisticEntry, net_sendq_high_water),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "net_slow_dropped_messages",
+    86,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT32,
+    0,   /* quantifier_offset */
+    offsetof(StatisticEntry, net_slow_dropped_messages),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "net_slow_dropped_bytes",
+    87,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT64,
+    0,   /* quantifier_offset */
+    offsetof(StatisticEntry, net_slow_dropped_bytes),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
   {
     "local_samples_processed",
     90,
@@ -2509,6 +2665,186 @@ static const ProtobufCFieldDescriptor statistic_entry__field_descriptors[44] =
     0,             /* flags */
     0,NULL,NULL    /* reserved1,reserved2, etc */
   },
+  {
+    "local_fifo_depth",
+    101,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT32,
+    0,   /* quantifier_offset */
+    offsetof(StatisticEntry, local_fifo_depth),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "local_fifo_high_water",
+    102,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT32,
+    0,   /* quantifier_offset */
+    offsetof(StatisticEntry, local_fifo_high_water),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "local_beast_batches",
+    103,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT32,
+    0,   /* quantifier_offset */
+    offsetof(StatisticEntry, local_beast_batches),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "local_beast_batch_messages",
+    104,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT32,
+    0,   /* quantifier_offset */
+    offsetof(StatisticEntry, local_beast_batch_messages),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "local_beast_batch_max",
+    105,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT32,
+    0,   /* quantifier_offset */
+    offsetof(StatisticEntry, local_beast_batch_max),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "local_beast_latency_mean",
+    106,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_FLOAT,
+    0,   /* quantifier_offset */
+    offsetof(StatisticEntry, local_beast_latency_mean),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "local_beast_latency_max",
+    107,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT64,
+    0,   /* quantifier_offset */
+    offsetof(StatisticEntry, local_beast_latency_max),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "net_slow_dropped_beast_out_messages",
+    108,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT32,
+    0,   /* quantifier_offset */
+    offsetof(StatisticEntry, net_slow_dropped_beast_out_messages),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "net_slow_dropped_beast_out_bytes",
+    109,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT64,
+    0,   /* quantifier_offset */
+    offsetof(StatisticEntry, net_slow_dropped_beast_out_bytes),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "net_slow_dropped_beast_reduce_out_messages",
+    110,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT32,
+    0,   /* quantifier_offset */
+    offsetof(StatisticEntry, net_slow_dropped_beast_reduce_out_messages),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "net_slow_dropped_beast_reduce_out_bytes",
+    111,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT64,
+    0,   /* quantifier_offset */
+    offsetof(StatisticEntry, net_slow_dropped_beast_reduce_out_bytes),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "net_slow_dropped_raw_out_messages",
+    112,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT32,
+    0,   /* quantifier_offset */
+    offsetof(StatisticEntry, net_slow_dropped_raw_out_messages),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "net_slow_dropped_raw_out_bytes",
+    113,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT64,
+    0,   /* quantifier_offset */
+    offsetof(StatisticEntry, net_slow_dropped_raw_out_bytes),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "net_slow_dropped_sbs_out_messages",
+    114,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT32,
+    0,   /* quantifier_offset */
+    offsetof(StatisticEntry, net_slow_dropped_sbs_out_messages),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "net_slow_dropped_sbs_out_bytes",
+    115,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_UINT64,
+    0,   /* quantifier_offset */
+    offsetof(StatisticEntry, net_slow_dropped_sbs_out_bytes),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
 };
 static const unsigned statistic_entry__field_indices_by_name[] = {
   5,   /* field[5] = altitude_suppressed */
@@ -2529,20 +2865,48 @@ static const unsigned statistic_entry__field_indices_by_name[] = {
   13,   /* field[13] = cpu_background */
   11,   /* field[11] = cpu_demod */
   12,   /* field[12] = cpu_reader */
-  43,   /* field[43] = local_accepted */
-  37,   /* field[37] = local_bad */
-  35,   /* field[35] = local_modeac */
-  36,   /* field[36] = local_modes */
-  41,   /* field[41] = local_noise */
-  42,   /* field[42] = local_peak_signal */
-  34,   /* field[34] = local_samples_dropped */
-  33,   /* field[33] = local_samples_processed */
-  40,   /* field[40] = local_signal */
-  39,   /* field[39] = local_strong_signals */
-  38,   /* field[38] = local_unknown_icao */
+  56,   /* field[56] = local_accepted */
+  50,   /* field[50] = local_bad */
+  61,   /* field[61] = local_beast_batch_max */
+  60,   /* field[60] = local_beast_batch_messages */
+  59,   /* field[59] = local_beast_batches */
+  63,   /* field[63] = local_beast_latency_max */
+  62,   /* field[62] = local_beast_latency_mean */
+  57,   /* field[57] = local_fifo_depth */
+  58,   /* field[58] = local_fifo_high_water */
+  48,   /* field[48] = local_modeac */
+  49,   /* field[49] = local_modes */
+  54,   /* field[54] = local_noise */
+  55,   /* field[55] = local_peak_signal */
+  47,   /* field[47] = local_samples_dropped */
+  46,   /* field[46] = local_samples_processed */
+  53,   /* field[53] = local_signal */
+  52,   /* field[52] = local_strong_signals */
+  51,   /* field[51] = local_unknown_icao */
   3,   /* field[3] = max_distance_in_metres */
   4,   /* field[4] = max_distance_in_nautical_miles */
   2,   /* field[2] = messages */
+  36,   /* field[36] = net_accept */
+  37,   /* field[37] = net_epoll_ctl */
+  33,   /* field[33] = net_epoll_wait */
+  38,   /* field[38] = net_queue_chunks */
+  40,   /* field[40] = net_queue_dropped */
+  39,   /* field[39] = net_queue_high_water */
+  42,   /* field[42] = net_queue_latency_max */
+  41,   /* field[41] = net_queue_latency_mean */
+  34,   /* field[34] = net_read */
+  43,   /* field[43] = net_sendq_high_water */
+  65,   /* field[65] = net_slow_dropped_beast_out_bytes */
+  64,   /* field[64] = net_slow_dropped_beast_out_messages */
+  67,   /* field[67] = net_slow_dropped_beast_reduce_out_bytes */
+  66,   /* field[66] = net_slow_dropped_beast_reduce_out_messages */
+  45,   /* field[45] = net_slow_dropped_bytes */
+  44,   /* field[44] = net_slow_dropped_messages */
+  69,   /* field[69] = net_slow_dropped_raw_out_bytes */
+  68,   /* field[68] = net_slow_dropped_raw_out_messages */
+  71,   /* field[71] = net_slow_dropped_sbs_out_bytes */
+  70,   /* field[70] = net_slow_dropped_sbs_out_messages */
+  35,   /* field[35] = net_write */
   32,   /* field[32] = remote_accepted */
   30,   /* field[30] = remote_bad */
   28,   /* field[28] = remote_modeac */
@@ -2562,8 +2926,8 @@ static const ProtobufCIntRange statistic_entry__number_ranges[5 + 1] =
   { 20, 11 },
   { 40, 14 },
   { 70, 28 },
-  { 90, 33 },
-  { 0, 44 }
+  { 90, 46 },
+  { 0, 72 }
 };
 const ProtobufCMessageDescriptor statistic_entry__descriptor =
 {
@@ -2573,7 +2937,7 @@ const ProtobufCMessageDescriptor statistic_entry__descriptor =
   "StatisticEntry",
   "",
   sizeof(StatisticEntry),
-  44,
+  72,
   statistic_entry__field_descriptors,
   statistic_entry__field_indices_by_name,
   5,  statistic_entry__number_ranges,
@@ -2631,7 +2995,7 @@ const ProtobufCMessageDescriptor statistics__polar_range_entry__descriptor =
   (ProtobufCMessageInit) statistics__polar_range_entry__init,
   NULL,NULL,NULL    /* reserved[123] */
 };
-static const ProtobufCFieldDescriptor statistics__field_descriptors[6] =
+static const ProtobufCFieldDescriptor statistics__field_descriptors[8] =
 {
   {
     "latest",
@@ -2705,8 +3069,34 @@ static const ProtobufCFieldDescriptor statistics__field_descriptors[6] =
     0,             /* flags */
     0,NULL,NULL    /* reserved1,reserved2, etc */
   },
+  {
+    "converter",
+    7,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_STRING,
+    0,   /* quantifier_offset */
+    offsetof(Statistics, converter),
+    NULL,
+    &protobuf_c_empty_string,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
+  {
+    "converter_rate",
+    8,
+    PROTOBUF_C_LABEL_NONE,
+    PROTOBUF_C_TYPE_FLOAT,
+    0,   /* quantifier_offset */
+    offsetof(Statistics, converter_rate),
+    NULL,
+    NULL,
+    0,             /* flags */
+    0,NULL,NULL    /* reserved1,reserved2, etc */
+  },
 };
 static const unsigned statistics__field_indices_by_name[] = {
+  6,   /* field[6] = converter */
+  7,   /* field[7] = converter_rate */
   3,   /* field[3] = last_15min */
   1,   /* field[1] = last_1min */
   2,   /* field[2] = last_5min */
@@ -2717,7 +3107,7 @@ static const unsigned statistics__field_indices_by_name[] = {
 static const ProtobufCIntRange statistics__number_ranges[1 + 1] =
 {
   { 1, 0 },
-  { 0, 6 }
+  { 0, 8 }
 };
 const ProtobufCMessageDescriptor statistics__descriptor =
 {
@@ -2727,7 +3117,7 @@ const ProtobufCMessageDescriptor statistics__descriptor =
   "Statistics",
   "",
   sizeof(Statistics),
-  6,
+  8,
   statistics__field_descriptors,
   statistics__field_indices_by_name,
   1,  statistics__number_ranges,
@@ -601,6 +601,58 @@ struct  _StatisticEntry
    * number of valid Mode S messages accepted with N-bit errors corrected.
    */
   uint64_t remote_accepted;
+  /*
+   * epoll_wait() calls of the network event loop.
+   */
+  uint32_t net_epoll_wait;
+  /*
+   * read() calls on network sockets.
+   */
+  uint32_t net_read;
+  /*
+   * write() calls on network sockets.
+   */
+  uint32_t net_write;
+  /*
+   * accept() calls on listening sockets, including the final one that finds none waiting.
+   */
+  uint32_t net_accept;
+  /*
+   * epoll_ctl() calls registering, changing or removing sockets.
+   */
+  uint32_t net_epoll_ctl;
+  /*
+   * output buffers handed from the decoder to the network thread and sent.
+   */
+  uint32_t net_queue_chunks;
+  /*
+   * most output buffers waiting for the network thread at once.
+   */
+  uint32_t net_queue_high_water;
+  /*
+   * output buffers dropped because the network thread fell behind.
+   */
+  uint32_t net_queue_dropped;
+  /*
+   * mean time from handing an output buffer over to sending it, in microseconds.
+   */
+  float net_queue_latency_mean;
+  /*
+   * longest time from handing an output buffer over to sending it, in microseconds.
+   */
+  uint64_t net_queue_latency_max;
+  /*
+   * most bytes queued for a single network client at once.
+   */
+  uint32_t net_sendq_high_water;
+  /*
+   * output messages dropped for clients that couldn't keep up, see --net-slow-policy.
+   */
+  uint32_t net_slow_dropped_messages;
+  /*
+   * bytes of those messages.
+   */
+  uint64_t net_slow_dropped_bytes;
   /*
    * statistics about messages received from a local SDR dongle. Not present in --net-only mode.
    */
@@ -648,10 +700,71 @@ struct  _StatisticEntry
    * the number of valid Mode S messages accepted with N-bit errors corrected.
    */
   uint64_t local_accepted;
+  /*
+   * largest number of sample buffers in the demodulator FIFO; grows with --fifo-max-depth.
+   */
+  uint32_t local_fifo_depth;
+  /*
+   * most sample buffers waiting for the demodulator at once. Close to local_fifo_depth means samples are about to be dropped.
+   */
+  uint32_t local_fifo_high_water;
+  /*
+   * batches of messages handed from the Beast serial or file reader thread to the decoder.
+   */
+  uint32_t local_beast_batches;
+  /*
+   * messages in those batches.
+   */
+  uint32_t local_beast_batch_messages;
+  /*
+   * most messages in one batch.
+   */
+  uint32_t local_beast_batch_max;
+  /*
+   * mean time from reading a message to decoding it, in microseconds.
+   */
+  float local_beast_latency_mean;
+  /*
+   * longest time from reading a message to decoding it, in microseconds.
+   */
+  uint64_t local_beast_latency_max;
+  /*
+   * output dropped by the slow consumer policies per output service, see --net-slow-policy. Filtered clients count to their service.
+   * output messages dropped for slow beast_out clients.
+   */
+  uint32_t net_slow_dropped_beast_out_messages;
+  /*
+   * bytes of those messages.
+   */
+  uint64_t net_slow_dropped_beast_out_bytes;
+  /*
+   * output messages dropped for slow beast_reduce_out clients.
+   */
+  uint32_t net_slow_dropped_beast_reduce_out_messages;
+  /*
+   * bytes of those messages.
+   */
+  uint64_t net_slow_dropped_beast_reduce_out_bytes;
+  /*
+   * output messages dropped for slow raw_out clients.
+   */
+  uint32_t net_slow_dropped_raw_out_messages;
+  /*
+   * bytes of those messages.
+   */
+  uint64_t net_slow_dropped_raw_out_bytes;
+  /*
+   * output messages dropped for slow sbs_out clients.
+   */
+  uint32_t net_slow_dropped_sbs_out_messages;
+  /*
+   * bytes of those messages.
+   */
+  uint64_t net_slow_dropped_sbs_out_bytes;
 };
 #define STATISTIC_ENTRY__INIT \
  { PROTOBUF_C_MESSAGE_INIT (&statistic_entry__descriptor) \
-    , 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 }
+    , 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 }
 
 
 struct  _Statistics__PolarRangeEntry
@@ -697,10 +810,18 @@ struct  _Statistics
    */
   size_t n_polar_range;
   Statistics__PolarRangeEntry **polar_range;
+  /*
+   * IQ sample converter in use. Empty without a local SDR.
+   */
+  char *converter;
+  /*
+   * speed of the converter measured by --iq-autotune, in million samples per second. Zero if not autotuned.
+   */
+  float converter_rate;
 };
 #define STATISTICS__INIT \
  { PROTOBUF_C_MESSAGE_INIT (&statistics__descriptor) \
-    , NULL, NULL, NULL, NULL, NULL, 0,NULL }
+    , NULL, NULL, NULL, NULL, NULL, 0,NULL, (char *)protobuf_c_empty_string, 0 }
 
 
 /* AircraftMeta__NavModes methods */
@@ -25,6 +25,7 @@
 #include "readsb.h"
 
 #include "sdr_ifile.h"
+#include "sdr_beastfile.h"
 #ifdef ENABLE_RTLSDR
 #include "sdr_rtlsdr.h"
 #endif
@@ -46,7 +47,7 @@ typedef struct {
     void (*close)();
     const char *name;
     sdr_type_t sdr_type;
-    uint32_t padding;
+    bool continuous; // never marks a buffer MAGBUF_DISCONTINUOUS, see sdrContinuous()
 } sdr_handler;
 
 static void noInitConfig() {
@@ -77,24 +78,25 @@ static bool unsupportedOpen() {
 
 static sdr_handler sdr_handlers[] = {
 #ifdef ENABLE_RTLSDR
-    { rtlsdrInitConfig, rtlsdrHandleOption, rtlsdrOpen, rtlsdrRun, rtlsdrClose, "rtlsdr", SDR_RTLSDR, 0},
+    { rtlsdrInitConfig, rtlsdrHandleOption, rtlsdrOpen, rtlsdrRun, rtlsdrClose, "rtlsdr", SDR_RTLSDR, false},
 #endif
 
 #ifdef ENABLE_BLADERF
-    { bladeRFInitConfig, bladeRFHandleOption, bladeRFOpen, bladeRFRun, bladeRFClose, "bladerf", SDR_BLADERF, 0},
-    { ubladeRFInitConfig, ubladeRFHandleOption, ubladeRFOpen, ubladeRFRun, ubladeRFClose, "ubladerf", SDR_MICROBLADERF, 0},
+    { bladeRFInitConfig, bladeRFHandleOption, bladeRFOpen, bladeRFRun, bladeRFClose, "bladerf", SDR_BLADERF, false},
+    { ubladeRFInitConfig, ubladeRFHandleOption, ubladeRFOpen, ubladeRFRun, ubladeRFClose, "ubladerf", SDR_MICROBLADERF, false},
 #endif
 
 #ifdef ENABLE_PLUTOSDR
-    { plutosdrInitConfig, plutosdrHandleOption, plutosdrOpen, plutosdrRun, plutosdrClose, "plutosdr", SDR_PLUTOSDR, 0},
+    { plutosdrInitConfig, plutosdrHandleOption, plutosdrOpen, plutosdrRun, plutosdrClose, "plutosdr", SDR_PLUTOSDR, false},
 #endif
 
-    { beastInitConfig, beastHandleOption, beastOpen, noRun, noClose, "modesbeast", SDR_MODESBEAST, 0},
-    { beastInitConfig, beastHandleOption, beastOpen, noRun, noClose, "gnshulc", SDR_GNS, 0},
-    { ifileInitConfig, ifileHandleOption, ifileOpen, ifileRun, ifileClose, "ifile", SDR_IFILE, 0},
-    { noInitConfig, noHandleOption, noOpen, noRun, noClose, "none", SDR_NONE, 0},
+    { beastInitConfig, beastHandleOption, beastOpen, beastRun, beastClose, "modesbeast", SDR_MODESBEAST, false},
+    { beastInitConfig, beastHandleOption, beastOpen, beastRun, beastClose, "gnshulc", SDR_GNS, false},
+    { ifileInitConfig, ifileHandleOption, ifileOpen, ifileRun, ifileClose, "ifile", SDR_IFILE, true},
+    { beastfileInitConfig, beastfileHandleOption, beastfileOpen, beastfileRun, beastfileClose, "beastfile", SDR_BEASTFILE, false},
+    { noInitConfig, noHandleOption, noOpen, noRun, noClose, "none", SDR_NONE, false},
 
-    { NULL, NULL, NULL, NULL, NULL, NULL, SDR_NONE, 0} /* must come last */
+    { NULL, NULL, NULL, NULL, NULL, NULL, SDR_NONE, false} /* must come last */
 };
 
 void sdrInitConfig() {
@@ -133,7 +135,7 @@ bool sdrHandleOption(int argc, char *argv) {
 }
 
 static sdr_handler *current_handler() {
-    static sdr_handler unsupported_handler = {noInitConfig, noHandleOption, unsupportedOpen, noRun, noClose, "unsupported", SDR_NONE, 0};
+    static sdr_handler unsupported_handler = {noInitConfig, noHandleOption, unsupportedOpen, noRun, noClose, "unsupported", SDR_NONE, false};
 
     for (int i = 0; sdr_handlers[i].name; ++i) {
         if (Modes.sdr_type == sdr_handlers[i].sdr_type) {
@@ -170,6 +172,10 @@ void sdrClose() {
     current_handler()->close();
 }
 
+bool sdrContinuous() {
+    return current_handler()->continuous;
+}
+
 void sdrMonitor() {
     pthread_mutex_lock(&Modes.reader_cpu_mutex);
     update_cpu_timing(&Modes.reader_cpu_start, &Modes.reader_cpu_accumulator);
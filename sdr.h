@@ -32,6 +32,10 @@ bool sdrHandleOption(int argc, char *argv);
 bool sdrOpen();
 void sdrRun();
 void sdrClose();
+// True if the input never drops samples, i.e. never marks a buffer
+// MAGBUF_DISCONTINUOUS. fifo_dequeue() zeroes the overlap of such a buffer,
+// which is the tail of the previous one, so --batch depends on this.
+bool sdrContinuous();
 // Call periodically from the SDR read thread to update reader thread CPU stats:
 void sdrMonitor();
 // Retrieve CPU stats and add new CPU time to *addTo
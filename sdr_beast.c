@@ -18,9 +18,17 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <termios.h>
+#include <poll.h>
 #include "readsb.h"
 #include "sdr_beast.h"
 
+// The serial port is read by a thread of its own that blocks on the tty,
+// frames whatever arrived into a batch and hands it to the main thread,
+// so message latency doesn't depend on the rest of the network work.
+
+#define BEAST_READ_SIZE (64 * 1024) // serial bytes read at a time
+#define BEAST_BATCHES 4 // batches read ahead of the decoder
+
 static struct {
     bool filter_df045;
     bool filter_df1117;
@@ -184,6 +192,9 @@ bool beastOpen(void) {
     int RTSDTR_flag = TIOCM_RTS | TIOCM_DTR;
     ioctl(Modes.beast_fd, TIOCMBIS, &RTSDTR_flag); //Set RTS&DTR pin
 
+    if (!beastBatchInit())
+        return false;
+
     if (Modes.sdr_type == SDR_MODESBEAST) {
         fprintf(stderr, "Running Mode-S Beast via USB.\n");
     } else {
@@ -192,12 +203,185 @@ bool beastOpen(void) {
     return true;
 }
 
+static struct {
+    struct beast_batch batches[BEAST_BATCHES];
+    unsigned head; // oldest filled batch
+    unsigned count; // number of filled batches
+    pthread_mutex_t mutex; // protects head and count
+    pthread_cond_t cond; // signalled when a batch is filled or freed
+} beastBatches;
+
+bool beastBatchInit(void) {
+    for (int i = 0; i < BEAST_BATCHES; ++i) {
+        if (!(beastBatches.batches[i].msgs = malloc(BEAST_BATCH_MSGS * sizeof (struct beast_msg)))) {
+            fprintf(stderr, "Beast: failed to allocate message buffers\n");
+            beastBatchCleanup();
+            return false;
+        }
+        beastBatches.batches[i].count = 0;
+    }
+
+    pthread_mutex_init(&beastBatches.mutex, NULL);
+    pthread_cond_init(&beastBatches.cond, NULL);
+    beastBatches.head = beastBatches.count = 0;
+    return true;
+}
+
+void beastBatchCleanup(void) {
+    for (int i = 0; i < BEAST_BATCHES; ++i) {
+        free(beastBatches.batches[i].msgs);
+        beastBatches.batches[i].msgs = NULL;
+    }
+}
+
+uint64_t beastMicros(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// Wait for an empty batch to fill, NULL if we are exiting
+
+struct beast_batch *beastBatchFree(void) {
+    struct beast_batch *batch = NULL;
+    struct timespec deadline;
+
+    pthread_mutex_lock(&beastBatches.mutex);
+    while (beastBatches.count == BEAST_BATCHES && !Modes.exit) {
+        get_deadline(100, &deadline);
+        pthread_cond_timedwait(&beastBatches.cond, &beastBatches.mutex, &deadline);
+    }
+    if (beastBatches.count < BEAST_BATCHES) {
+        batch = &beastBatches.batches[(beastBatches.head + beastBatches.count) % BEAST_BATCHES];
+        batch->count = 0;
+    }
+    pthread_mutex_unlock(&beastBatches.mutex);
+
+    return batch;
+}
+
+// Hand a filled batch to the main thread and get the next one
+
+struct beast_batch *beastBatchDeliver(struct beast_batch *batch) {
+    if (!batch->count)
+        return batch;
+
+    pthread_mutex_lock(&beastBatches.mutex);
+    beastBatches.count++;
+    pthread_cond_broadcast(&beastBatches.cond);
+    pthread_mutex_unlock(&beastBatches.mutex);
+
+    return beastBatchFree();
+}
+
+// Wait for the main thread to decode all delivered batches
+
+void beastBatchDrain(void) {
+    struct timespec deadline;
+
+    pthread_mutex_lock(&beastBatches.mutex);
+    while (beastBatches.count && !Modes.exit) {
+        get_deadline(100, &deadline);
+        pthread_cond_timedwait(&beastBatches.cond, &beastBatches.mutex, &deadline);
+    }
+    pthread_mutex_unlock(&beastBatches.mutex);
+}
+
+bool beastProcess(unsigned timeout_ms) {
+    struct beast_batch *batch;
+    struct timespec deadline;
+
+    get_deadline(timeout_ms, &deadline);
+
+    pthread_mutex_lock(&beastBatches.mutex);
+    while (!beastBatches.count && !Modes.exit) {
+        if (pthread_cond_timedwait(&beastBatches.cond, &beastBatches.mutex, &deadline) == ETIMEDOUT)
+            break;
+    }
+    batch = beastBatches.count ? &beastBatches.batches[beastBatches.head] : NULL;
+    pthread_mutex_unlock(&beastBatches.mutex);
+
+    if (!batch)
+        return false;
+
+    uint64_t now = beastMicros();
+    Modes.stats_current.beast_batches++;
+    Modes.stats_current.beast_batch_msgs += batch->count;
+    Modes.stats_current.beast_batch_max = max(Modes.stats_current.beast_batch_max, batch->count);
+
+    for (unsigned i = 0; i < batch->count; ++i) {
+        struct beast_msg *msg = &batch->msgs[i];
+        uint64_t latency = now - msg->received;
+
+        Modes.stats_current.beast_latency_sum += latency;
+        if (latency > Modes.stats_current.beast_latency_max)
+            Modes.stats_current.beast_latency_max = latency;
+
+        if (Modes.sdr_type == SDR_BEASTFILE)
+            Modes.ifile_now = msg->now;
+        decodeBeastMessage(msg->frame.data, 0);
+    }
+
+    pthread_mutex_lock(&beastBatches.mutex);
+    beastBatches.head = (beastBatches.head + 1) % BEAST_BATCHES;
+    beastBatches.count--;
+    pthread_cond_broadcast(&beastBatches.cond);
+    pthread_mutex_unlock(&beastBatches.mutex);
+
+    return true;
+}
+
 void beastRun() {
+    struct beast_batch *batch = beastBatchFree();
+    struct pollfd pfd = { Modes.beast_fd, POLLIN, 0 };
+    struct beast_deframer deframer = { 0 };
+    char *buf;
+
+    if (!(buf = malloc(BEAST_READ_SIZE))) {
+        fprintf(stderr, "Beast: failed to allocate read buffer\n");
+        return;
+    }
+
+    // poll() with a timeout so we notice an exit while the line is quiet
+    fcntl(Modes.beast_fd, F_SETFL, fcntl(Modes.beast_fd, F_GETFL) | O_NONBLOCK);
+
+    while (batch && !Modes.exit) {
+        if (poll(&pfd, 1, 100) <= 0)
+            continue;
+
+        ssize_t nread = read(Modes.beast_fd, buf, BEAST_READ_SIZE);
+        if (nread < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK))
+            continue;
+        if (nread <= 0) {
+            fprintf(stderr, "Beast: serial read failed: %s, USB handle failed?\n", nread ? strerror(errno) : "end of file");
+            Modes.exit = 3;
+            break;
+        }
+
+        uint64_t received = beastMicros();
+        char *p = buf;
+        char *eod = buf + nread; // one byte past end of data
+
+        // frames are unescaped straight into the batch, a partial one waits
+        // in the deframer for the next read
+        while (batch && beastDeframe(&deframer, &p, eod, &batch->msgs[batch->count].frame)) {
+            batch->msgs[batch->count++].received = received;
+            if (batch->count == BEAST_BATCH_MSGS)
+                batch = beastBatchDeliver(batch);
+        }
+
+        if (batch)
+            batch = beastBatchDeliver(batch);
+    }
 
+    free(buf);
 }
 
 void beastClose() {
-    /* Beast device will be closed in the main cleanup_and_exit function when
-     * clients are freed.
-     */
+    if (Modes.beast_fd >= 0) {
+        close(Modes.beast_fd);
+        Modes.beast_fd = -1;
+    }
+    beastBatchCleanup();
 }
@@ -26,5 +26,30 @@ bool beastOpen();
 void beastRun();
 void beastClose();
 
+// Batches of framed Beast messages, passed from a reader thread to the main thread
+
+#define BEAST_BATCH_MSGS 4096 // messages per batch
+
+struct beast_msg {
+    uint64_t now; // beastfile: replay time, milliseconds
+    uint64_t received; // monotonic time it was read, microseconds
+    struct beast_frame frame; // unescaped by the reader thread
+};
+
+struct beast_batch {
+    struct beast_msg *msgs;
+    unsigned count;
+};
+
+bool beastBatchInit(void);
+void beastBatchCleanup(void);
+struct beast_batch *beastBatchFree(void);
+struct beast_batch *beastBatchDeliver(struct beast_batch *batch);
+void beastBatchDrain(void);
+uint64_t beastMicros(void);
+
+// Decode the next batch, waiting up to timeout_ms for one; main thread only
+bool beastProcess(unsigned timeout_ms);
+
 #endif /* SDR_BEAST_H */
 
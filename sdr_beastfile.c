@@ -0,0 +1,217 @@
+// Part of readsb, a Mode-S/ADSB/TIS message decoder.
+//
+// sdr_beastfile.c: Beast binary capture file replay
+//
+// Copyright (c) 2020 Michael Wolf <michael@mictronics.de>
+//
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// any later version.
+//
+// This file is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "readsb.h"
+#include "sdr_beast.h"
+#include "sdr_beastfile.h"
+
+// The reader thread frames the recorded messages, works out the replay time
+// of each from its 12MHz timestamp, paces them if asked to and hands them to
+// the main thread in the same batches as the Beast serial reader. The main
+// thread sets the replay time before decoding each message, so messageNow()
+// and everything expiring by it follow the recording rather than the wall
+// clock.
+
+#define BEASTFILE_READ_SIZE (256 * 1024) // bytes read from the file at a time
+#define BEASTFILE_MAX_GAP (12000000ULL * 3600) // longer timestamp jumps are taken as a counter reset
+#define BEASTFILE_MAX_REORDER 12000000ULL // older timestamps than this are taken as a counter reset
+
+static struct {
+    const char *filename;
+    int fd;
+    double speed; // replay speed factor, 0 = as fast as possible
+    char *readbuf;
+    struct beast_deframer deframer;
+    uint64_t base_ts; // 12MHz timestamp at base_ms, 0 before the first one
+    uint64_t base_ms;
+    uint64_t last_ts; // latest timestamp seen
+    uint64_t now_ms; // replay time of the latest message
+} beastfile;
+
+void beastfileInitConfig(void) {
+    beastfile.filename = NULL;
+    beastfile.fd = -1;
+    beastfile.speed = 0;
+    beastfile.readbuf = NULL;
+}
+
+bool beastfileHandleOption(int argc, char *argv) {
+    switch (argc) {
+        case OptBeastFileName:
+            beastfile.filename = strdup(argv);
+            Modes.sdr_type = SDR_BEASTFILE;
+            break;
+        case OptBeastFileSpeed:
+            beastfile.speed = strtod(argv, NULL);
+            if (beastfile.speed < 0) {
+                fprintf(stderr, "beastfile: replay speed must not be negative\n");
+                return false;
+            }
+            break;
+    }
+    return true;
+}
+
+bool beastfileOpen(void) {
+    if (!beastfile.filename) {
+        fprintf(stderr, "SDR type 'beastfile' requires a --beastfile argument\n");
+        return false;
+    }
+
+    if (!strcmp(beastfile.filename, "-")) {
+        beastfile.fd = STDIN_FILENO;
+    } else if ((beastfile.fd = open(beastfile.filename, O_RDONLY)) < 0) {
+        fprintf(stderr, "beastfile: open(%s) failed: %s\n",
+                beastfile.filename,
+                strerror(errno));
+        return false;
+    }
+
+    if (!(beastfile.readbuf = malloc(BEASTFILE_READ_SIZE))) {
+        fprintf(stderr, "beastfile: failed to allocate read buffer\n");
+        beastfileClose();
+        return false;
+    }
+    if (!beastBatchInit()) {
+        beastfileClose();
+        return false;
+    }
+
+    // the recording carries no wall clock time, so it replays from our startup time
+    beastfile.base_ts = beastfile.last_ts = 0;
+    memset(&beastfile.deframer, 0, sizeof (beastfile.deframer));
+    beastfile.now_ms = Modes.ifile_now;
+
+    return true;
+}
+
+// Replay time of a message
+
+static uint64_t beastfileClock(const struct beast_frame *frame) {
+    uint64_t ts = 0;
+
+    if (frame->data[0] >= '1' && frame->data[0] <= '4') {
+        for (int j = 1; j <= 6; j++)
+            ts = ts << 8 | (unsigned char) frame->data[j];
+    }
+
+    if (!ts) {
+        // no timestamp (position message or mlat timestamps turned off)
+    } else if (beastfile.base_ts && ts >= beastfile.last_ts && ts - beastfile.last_ts < BEASTFILE_MAX_GAP) {
+        beastfile.now_ms = beastfile.base_ms + (ts - beastfile.base_ts) / 12000;
+        beastfile.last_ts = ts;
+    } else if (beastfile.base_ts && ts < beastfile.last_ts && beastfile.last_ts - ts < BEASTFILE_MAX_REORDER) {
+        // slightly out of order, as in merged feeds: keep the current time
+    } else {
+        // first timestamp, or the receiver's counter was reset: carry on from the current time
+        beastfile.base_ts = beastfile.last_ts = ts;
+        beastfile.base_ms = beastfile.now_ms;
+    }
+
+    return beastfile.now_ms;
+}
+
+// Milliseconds from now until the monotonic clock reaches due, rounded up
+
+static int64_t beastfileWaitMs(const struct timespec *due) {
+    struct timespec wall;
+
+    clock_gettime(CLOCK_MONOTONIC, &wall);
+    int64_t ns = (int64_t) (due->tv_sec - wall.tv_sec) * 1000000000 + (due->tv_nsec - wall.tv_nsec);
+    return (ns + 999999) / 1000000;
+}
+
+void beastfileRun(void) {
+    struct beast_batch *batch = beastBatchFree();
+
+    // replay time start_ms is due at wall clock time start
+    struct timespec start;
+    uint64_t start_ms = beastfile.now_ms;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    while (batch && !Modes.exit) {
+        ssize_t nread = read(beastfile.fd, beastfile.readbuf, BEASTFILE_READ_SIZE);
+        if (nread < 0) {
+            if (errno == EINTR)
+                continue;
+            fprintf(stderr, "beastfile: error reading input file: %s\n", strerror(errno));
+            break;
+        }
+        if (nread == 0)
+            break;
+
+        char *p = beastfile.readbuf;
+        char *eod = p + nread; // one byte past end of data
+
+        // frames are unescaped straight into the batch, a partial one waits
+        // in the deframer for the next read
+        while (batch && beastDeframe(&beastfile.deframer, &p, eod, &batch->msgs[batch->count].frame)) {
+            struct beast_msg *msg = &batch->msgs[batch->count];
+            uint64_t now = beastfileClock(&msg->frame);
+
+            if (beastfile.speed > 0) {
+                // the offset from the start of the replay exceeds what tv_nsec can hold
+                uint64_t offset_ns = (uint64_t) ((now - start_ms) * 1e6 / beastfile.speed);
+                struct timespec due = start;
+                due.tv_sec += offset_ns / 1000000000;
+                due.tv_nsec += offset_ns % 1000000000;
+                normalize_timespec(&due);
+
+                int64_t wait_ms = beastfileWaitMs(&due);
+                if (wait_ms > 0) {
+                    // deliver what is due now, then wait for this message's time
+                    struct beast_frame frame = msg->frame;
+                    if (!(batch = beastBatchDeliver(batch)))
+                        break;
+                    msg = &batch->msgs[batch->count];
+                    msg->frame = frame;
+                    // in short sleeps, so we notice an exit during long gaps in the recording
+                    for (; wait_ms > 0 && !Modes.exit; wait_ms = beastfileWaitMs(&due)) {
+                        struct timespec slp = {0, (wait_ms > 100 ? 100 : wait_ms) * 1000 * 1000};
+                        nanosleep(&slp, NULL);
+                    }
+                }
+            }
+
+            msg->now = now;
+            msg->received = beastMicros();
+            if (++batch->count == BEAST_BATCH_MSGS)
+                batch = beastBatchDeliver(batch);
+        }
+
+        if (batch)
+            batch = beastBatchDeliver(batch);
+    }
+
+    // Wait for the main thread to decode the trailing messages
+    beastBatchDrain();
+
+    Modes.exit = 1;
+}
+
+void beastfileClose(void) {
+    if (beastfile.fd >= 0 && beastfile.fd != STDIN_FILENO) {
+        close(beastfile.fd);
+    }
+    beastfile.fd = -1;
+
+    free(beastfile.readbuf);
+    beastfile.readbuf = NULL;
+    beastBatchCleanup();
+}
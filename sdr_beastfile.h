@@ -0,0 +1,31 @@
+// Part of readsb, a Mode-S/ADSB/TIS message decoder.
+//
+// sdr_beastfile.h: Beast binary capture file replay (header)
+//
+// Copyright (c) 2020 Michael Wolf <michael@mictronics.de>
+//
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// any later version.
+//
+// This file is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SDR_BEASTFILE_H
+#define SDR_BEASTFILE_H
+
+// Pseudo-SDR that replays a recorded Beast binary stream
+
+void beastfileInitConfig();
+bool beastfileHandleOption(int argc, char *argv);
+bool beastfileOpen();
+void beastfileRun();
+void beastfileClose();
+
+#endif /* SDR_BEASTFILE_H */
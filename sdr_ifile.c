@@ -55,13 +55,79 @@
 #include "readsb.h"
 #include "sdr_ifile.h"
 
+#include <sys/mman.h>
+
+#ifdef ENABLE_GZIP
+#include <zlib.h>
+#endif
+#ifdef ENABLE_XZ
+#include <lzma.h>
+#endif
+#ifdef ENABLE_ZSTD
+#include <zstd.h>
+#endif
+
+// Regular files are mapped rather than read(), and converted straight from
+// the mapping. The kernel is asked to read ahead a window at a time and
+// the pages behind the cursor are dropped again, both from our mapping and
+// from the page cache, so that a multi-GB recording doesn't push
+// everything else out of memory. stdin and pipes still use read().
+
+#define IFILE_READAHEAD (16 * 1024 * 1024) // MADV_WILLNEED window, in bytes
+#define IFILE_DROPBEHIND (16 * 1024 * 1024) // release consumed pages in chunks of this size
+
+// Compressed recordings, recognised by their magic bytes or named with
+// --ifile-compression, are decompressed by a thread of their own into a
+// ring of raw blocks of one FIFO block each, so decompression runs
+// alongside conversion and demodulation instead of in series with them.
+
+#define IFILE_RAW_BLOCKS 4 // raw blocks decompressed ahead of the converter
+#define IFILE_INBUF_SIZE (256 * 1024) // compressed input read at a time
+
+struct raw_block {
+    char *data; // bufsize bytes
+    unsigned len; // decompressed bytes in data
+    bool last; // end of the input, no more blocks follow
+};
+
+struct decompressor {
+    const char *name;
+    unsigned char magic[6];
+    unsigned char magic_mask[6]; // bits of magic to compare, the rest may be anything
+    unsigned magic_len;
+    bool (*init)(void); // NULL if this build doesn't support the format
+    ssize_t (*fill)(char *out, unsigned len); // fill out; short only at the end of the input, -1 on error
+    void (*cleanup)(void);
+};
+
 static struct {
     input_format_t input_format;
     int fd;
     unsigned bytes_per_sample;
     bool throttle;
+    int batch; // --batch, only used without --throttle
     unsigned bufsize;
     char *readbuf;
+    char *map; // mapping of the whole file, or NULL to use read()
+    size_t map_size;
+    size_t map_pos; // next byte to convert
+    size_t map_willneed; // end of the readahead requested so far
+    size_t map_dropped; // start of the pages still held
+    const char *compression; // --ifile-compression: NULL to detect, "none" or a decompressor name
+    const struct decompressor *decompressor; // NULL if the input is not compressed
+    bool decompressor_initialized; // its init() succeeded, and raw_mutex and raw_cond are set up
+    unsigned char peek[8]; // bytes read from a pipe to detect compression, not yet consumed
+    unsigned peek_len;
+    unsigned peek_pos;
+    uint8_t *inbuf; // compressed input
+    struct raw_block raw[IFILE_RAW_BLOCKS]; // ring of decompressed blocks
+    unsigned raw_head; // oldest filled block
+    unsigned raw_count; // number of filled blocks
+    bool raw_stop; // tells the decompression thread to exit
+    bool raw_thread_running;
+    pthread_t raw_thread;
+    pthread_mutex_t raw_mutex; // protects raw_head, raw_count, raw_stop
+    pthread_cond_t raw_cond; // signalled when a block is filled or freed
     iq_convert_fn converter;
     struct converter_state *converter_state;
     const char *filename;
@@ -71,10 +137,19 @@ void ifileInitConfig(void) {
     ifile.filename = NULL;
     ifile.input_format = INPUT_UC8;
     ifile.throttle = false;
+    ifile.batch = 0;
     ifile.fd = -1;
     ifile.bytes_per_sample = 0;
     ifile.bufsize = 0;
     ifile.readbuf = NULL;
+    ifile.map = NULL;
+    ifile.map_size = 0;
+    ifile.compression = NULL;
+    ifile.decompressor = NULL;
+    ifile.decompressor_initialized = false;
+    ifile.peek_len = ifile.peek_pos = 0;
+    ifile.inbuf = NULL;
+    ifile.raw_thread_running = false;
     ifile.converter = NULL;
     ifile.converter_state = NULL;
 }
@@ -101,7 +176,23 @@ bool ifileHandleOption(int argc, char *argv) {
         case OptIfileThrottle:
             ifile.throttle = true;
             break;
+        case OptIfileBatch:
+            ifile.batch = (int) max(min(strtoll(argv, NULL, 10), MODES_MAX_DEMOD_THREADS), 0);
+            break;
+        case OptIfileCompression:
+            if (!strcasecmp(argv, "auto")) {
+                ifile.compression = NULL;
+            } else if (!strcasecmp(argv, "none") || !strcasecmp(argv, "gzip") || !strcasecmp(argv, "xz") || !strcasecmp(argv, "zstd")) {
+                ifile.compression = strdup(argv);
+            } else {
+                fprintf(stderr, "Input compression '%s' not understood (supported values: auto, none, gzip, xz, zstd)\n",
+                        argv);
+                return false;
+            }
+            break;
     }
+    // batch mode runs as fast as the CPUs allow, which is pointless when throttled
+    Modes.demod_batch = ifile.throttle ? 0 : ifile.batch;
     return true;
 }
 
@@ -112,6 +203,377 @@ bool ifileHandleOption(int argc, char *argv) {
 // instead of using an RTLSDR device
 //
 
+static bool ifileMap(void) {
+    struct stat st;
+    void *map;
+
+    if (fstat(ifile.fd, &st) < 0 || !S_ISREG(st.st_mode) || st.st_size <= 0 || (uint64_t) st.st_size > SIZE_MAX)
+        return false;
+
+    if ((map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, ifile.fd, 0)) == MAP_FAILED) {
+        fprintf(stderr, "ifile: can't map %s, reading it instead: %s\n", ifile.filename, strerror(errno));
+        return false;
+    }
+
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+
+    ifile.map = map;
+    ifile.map_size = st.st_size;
+    ifile.map_pos = ifile.map_willneed = ifile.map_dropped = 0;
+    return true;
+}
+
+// Next block of samples from the mapping, at most `bytes_wanted` bytes.
+// Sets *bytes_read; returns a pointer into the mapping.
+
+static void *ifileMapNext(unsigned bytes_wanted, unsigned *bytes_read) {
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t left = ifile.map_size - ifile.map_pos;
+    size_t pos = ifile.map_pos;
+
+    *bytes_read = (left < bytes_wanted) ? left : bytes_wanted;
+    ifile.map_pos += *bytes_read;
+
+    // keep a window of readahead in front of the cursor
+    if (ifile.map_willneed < ifile.map_size && ifile.map_willneed < ifile.map_pos + IFILE_READAHEAD / 2) {
+        size_t start = ifile.map_willneed / page * page;
+        size_t end = ifile.map_pos + IFILE_READAHEAD;
+        if (end > ifile.map_size)
+            end = ifile.map_size;
+        madvise(ifile.map + start, end - start, MADV_WILLNEED);
+        ifile.map_willneed = end;
+    }
+
+    // release everything before the block being handed out
+    size_t done = pos / page * page;
+    if (done - ifile.map_dropped >= IFILE_DROPBEHIND) {
+        madvise(ifile.map + ifile.map_dropped, done - ifile.map_dropped, MADV_DONTNEED);
+        posix_fadvise(ifile.fd, ifile.map_dropped, done - ifile.map_dropped, POSIX_FADV_DONTNEED);
+        ifile.map_dropped = done;
+    }
+
+    return ifile.map + pos;
+}
+
+// read() that first returns any bytes consumed by ifileDetect()
+
+static ssize_t ifileRead(void *buf, size_t len) {
+    if (ifile.peek_pos < ifile.peek_len) {
+        size_t n = ifile.peek_len - ifile.peek_pos;
+        if (n > len)
+            n = len;
+        memcpy(buf, ifile.peek + ifile.peek_pos, n);
+        ifile.peek_pos += n;
+        return n;
+    }
+
+    return read(ifile.fd, buf, len);
+}
+
+#if defined(ENABLE_GZIP) || defined(ENABLE_XZ) || defined(ENABLE_ZSTD)
+// Read the next chunk of compressed input into ifile.inbuf, 0 at the end of the input
+
+static size_t ifileReadCompressed(void) {
+    ssize_t n;
+
+    while ((n = ifileRead(ifile.inbuf, IFILE_INBUF_SIZE)) < 0 && errno == EINTR)
+        ;
+    if (n < 0) {
+        fprintf(stderr, "ifile: error reading input file: %s\n", strerror(errno));
+        return 0;
+    }
+    return n;
+}
+#endif
+
+#ifdef ENABLE_GZIP
+static z_stream gzip_stream;
+static bool gzip_eof;
+
+static bool gzipInit(void) {
+    memset(&gzip_stream, 0, sizeof (gzip_stream));
+    gzip_eof = false;
+    // 15 bit window, +32: accept both gzip and zlib headers
+    return inflateInit2(&gzip_stream, 15 + 32) == Z_OK;
+}
+
+static ssize_t gzipFill(char *out, unsigned len) {
+    gzip_stream.next_out = (Bytef *) out;
+    gzip_stream.avail_out = len;
+
+    while (gzip_stream.avail_out) {
+        if (!gzip_stream.avail_in && !gzip_eof) {
+            gzip_stream.next_in = ifile.inbuf;
+            gzip_stream.avail_in = ifileReadCompressed();
+            gzip_eof = !gzip_stream.avail_in;
+        }
+
+        uInt before = gzip_stream.avail_out;
+        int ret = inflate(&gzip_stream, Z_NO_FLUSH);
+        if (ret == Z_STREAM_END) {
+            // gzip files may consist of several members, e.g. from pigz or cat
+            if (gzip_stream.avail_in || !gzip_eof)
+                inflateReset(&gzip_stream);
+            else
+                break;
+        } else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+            fprintf(stderr, "ifile: gzip decompression failed: %s\n", gzip_stream.msg ? gzip_stream.msg : "unknown error");
+            return -1;
+        }
+
+        if (gzip_eof && !gzip_stream.avail_in && gzip_stream.avail_out == before)
+            break; // no more input and nothing left to flush
+    }
+
+    return len - gzip_stream.avail_out;
+}
+
+static void gzipCleanup(void) {
+    inflateEnd(&gzip_stream);
+}
+#else
+#define gzipInit NULL
+#define gzipFill NULL
+#define gzipCleanup NULL
+#endif
+
+#ifdef ENABLE_XZ
+static lzma_stream xz_stream;
+static lzma_action xz_action;
+
+static bool xzInit(void) {
+    lzma_stream init = LZMA_STREAM_INIT;
+
+    xz_stream = init;
+    xz_action = LZMA_RUN;
+    return lzma_stream_decoder(&xz_stream, UINT64_MAX, LZMA_CONCATENATED) == LZMA_OK;
+}
+
+static ssize_t xzFill(char *out, unsigned len) {
+    xz_stream.next_out = (uint8_t *) out;
+    xz_stream.avail_out = len;
+
+    while (xz_stream.avail_out) {
+        if (!xz_stream.avail_in && xz_action == LZMA_RUN) {
+            xz_stream.next_in = ifile.inbuf;
+            xz_stream.avail_in = ifileReadCompressed();
+            if (!xz_stream.avail_in)
+                xz_action = LZMA_FINISH;
+        }
+
+        lzma_ret ret = lzma_code(&xz_stream, xz_action);
+        if (ret == LZMA_STREAM_END)
+            break;
+        if (ret != LZMA_OK) {
+            fprintf(stderr, "ifile: xz decompression failed (error %d)\n", (int) ret);
+            return -1;
+        }
+    }
+
+    return len - xz_stream.avail_out;
+}
+
+static void xzCleanup(void) {
+    lzma_end(&xz_stream);
+}
+#else
+#define xzInit NULL
+#define xzFill NULL
+#define xzCleanup NULL
+#endif
+
+#ifdef ENABLE_ZSTD
+static ZSTD_DStream *zstd_stream;
+static ZSTD_inBuffer zstd_in;
+static bool zstd_eof;
+
+static bool zstdInit(void) {
+    if (!(zstd_stream = ZSTD_createDStream()))
+        return false;
+    zstd_in.src = ifile.inbuf;
+    zstd_in.size = zstd_in.pos = 0;
+    zstd_eof = false;
+    return !ZSTD_isError(ZSTD_initDStream(zstd_stream));
+}
+
+static ssize_t zstdFill(char *out, unsigned len) {
+    ZSTD_outBuffer zstd_out = { out, len, 0 };
+
+    while (zstd_out.pos < zstd_out.size) {
+        if (zstd_in.pos == zstd_in.size && !zstd_eof) {
+            zstd_in.size = ifileReadCompressed();
+            zstd_in.pos = 0;
+            zstd_eof = !zstd_in.size;
+        }
+
+        size_t before = zstd_out.pos;
+        // decodes concatenated frames by itself
+        size_t ret = ZSTD_decompressStream(zstd_stream, &zstd_out, &zstd_in);
+        if (ZSTD_isError(ret)) {
+            fprintf(stderr, "ifile: zstd decompression failed: %s\n", ZSTD_getErrorName(ret));
+            return -1;
+        }
+
+        if (zstd_eof && zstd_in.pos == zstd_in.size && zstd_out.pos == before)
+            break; // no more input and nothing left to flush
+    }
+
+    return zstd_out.pos;
+}
+
+static void zstdCleanup(void) {
+    ZSTD_freeDStream(zstd_stream);
+    zstd_stream = NULL;
+}
+#else
+#define zstdInit NULL
+#define zstdFill NULL
+#define zstdCleanup NULL
+#endif
+
+// gzip: ID1, ID2, CM = 8 (deflate) and FLG with the reserved bits clear,
+// so a recording that happens to start with 0x1f 0x8b is less likely taken for it
+
+static const struct decompressor decompressors[] = {
+    { "gzip", { 0x1f, 0x8b, 0x08, 0x00 }, { 0xff, 0xff, 0xff, 0xe0 }, 4, gzipInit, gzipFill, gzipCleanup },
+    { "xz", { 0xfd, '7', 'z', 'X', 'Z', 0x00 }, { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff }, 6, xzInit, xzFill, xzCleanup },
+    { "zstd", { 0x28, 0xb5, 0x2f, 0xfd }, { 0xff, 0xff, 0xff, 0xff }, 4, zstdInit, zstdFill, zstdCleanup },
+    { NULL, { 0 }, { 0 }, 0, NULL, NULL, NULL } /* must come last */
+};
+
+static bool ifileMagicMatches(const struct decompressor *d, ssize_t n) {
+    if (n < (ssize_t) d->magic_len)
+        return false;
+    for (unsigned i = 0; i < d->magic_len; ++i) {
+        if ((ifile.peek[i] & d->magic_mask[i]) != d->magic[i])
+            return false;
+    }
+    return true;
+}
+
+// Look at the first bytes of the input for a known compression format,
+// unless --ifile-compression says what it is. Regular files are peeked at
+// with pread(); from a pipe the bytes are kept in ifile.peek for ifileRead().
+
+static const struct decompressor *ifileDetect(void) {
+    struct stat st;
+    ssize_t n = 0;
+
+    if (ifile.compression) {
+        for (int i = 0; decompressors[i].name; ++i) {
+            if (!strcasecmp(ifile.compression, decompressors[i].name))
+                return &decompressors[i];
+        }
+        return NULL; // none
+    }
+
+    if (fstat(ifile.fd, &st) == 0 && S_ISREG(st.st_mode)) {
+        n = pread(ifile.fd, ifile.peek, sizeof (ifile.peek), 0);
+    } else {
+        ssize_t nread;
+        while (n < (ssize_t) sizeof (ifile.peek) && ((nread = read(ifile.fd, ifile.peek + n, sizeof (ifile.peek) - n)) > 0 || (nread < 0 && errno == EINTR)))
+            n += (nread > 0) ? nread : 0;
+        ifile.peek_len = n;
+    }
+
+    for (int i = 0; decompressors[i].name; ++i) {
+        if (ifileMagicMatches(&decompressors[i], n))
+            return &decompressors[i];
+    }
+    return NULL;
+}
+
+static bool ifileDecompressInit(void) {
+    if (!ifile.decompressor->init) {
+        fprintf(stderr, "ifile: %s is %s compressed, but this readsb was built without %s support\n",
+                ifile.filename, ifile.decompressor->name, ifile.decompressor->name);
+        return false;
+    }
+
+    if (!(ifile.inbuf = malloc(IFILE_INBUF_SIZE))) {
+        fprintf(stderr, "ifile: failed to allocate read buffer\n");
+        return false;
+    }
+    for (int i = 0; i < IFILE_RAW_BLOCKS; ++i) {
+        if (!(ifile.raw[i].data = malloc(ifile.bufsize))) {
+            fprintf(stderr, "ifile: failed to allocate read buffer\n");
+            return false;
+        }
+    }
+
+    if (!ifile.decompressor->init()) {
+        fprintf(stderr, "ifile: can't initialize %s decompression\n", ifile.decompressor->name);
+        return false;
+    }
+
+    pthread_mutex_init(&ifile.raw_mutex, NULL);
+    pthread_cond_init(&ifile.raw_cond, NULL);
+    ifile.raw_head = ifile.raw_count = 0;
+    ifile.raw_stop = false;
+    ifile.decompressor_initialized = true;
+
+    fprintf(stderr, "ifile: decompressing %s input\n", ifile.decompressor->name);
+    return true;
+}
+
+static void *ifileDecompressThreadEntryPoint(void *arg) {
+    MODES_NOTUSED(arg);
+
+    worker_thread_init("readsb-unpack");
+
+    for (;;) {
+        struct raw_block *block;
+
+        pthread_mutex_lock(&ifile.raw_mutex);
+        while (ifile.raw_count == IFILE_RAW_BLOCKS && !ifile.raw_stop)
+            pthread_cond_wait(&ifile.raw_cond, &ifile.raw_mutex);
+        if (ifile.raw_stop) {
+            pthread_mutex_unlock(&ifile.raw_mutex);
+            break;
+        }
+        block = &ifile.raw[(ifile.raw_head + ifile.raw_count) % IFILE_RAW_BLOCKS];
+        pthread_mutex_unlock(&ifile.raw_mutex);
+
+        ssize_t len = ifile.decompressor->fill(block->data, ifile.bufsize);
+        block->len = (len > 0) ? len : 0;
+        block->last = (block->len < ifile.bufsize);
+
+        pthread_mutex_lock(&ifile.raw_mutex);
+        ifile.raw_count++;
+        pthread_cond_broadcast(&ifile.raw_cond);
+        pthread_mutex_unlock(&ifile.raw_mutex);
+
+        if (block->last)
+            break;
+    }
+
+    return NULL;
+}
+
+// Wait for the oldest decompressed block
+
+static struct raw_block *ifileRawNext(void) {
+    struct raw_block *block;
+
+    pthread_mutex_lock(&ifile.raw_mutex);
+    while (!ifile.raw_count)
+        pthread_cond_wait(&ifile.raw_cond, &ifile.raw_mutex);
+    block = &ifile.raw[ifile.raw_head];
+    pthread_mutex_unlock(&ifile.raw_mutex);
+
+    return block;
+}
+
+// Hand the oldest block back to the decompression thread
+
+static void ifileRawDone(void) {
+    pthread_mutex_lock(&ifile.raw_mutex);
+    ifile.raw_head = (ifile.raw_head + 1) % IFILE_RAW_BLOCKS;
+    ifile.raw_count--;
+    pthread_cond_broadcast(&ifile.raw_cond);
+    pthread_mutex_unlock(&ifile.raw_mutex);
+}
+
 bool ifileOpen(void) {
     if (!ifile.filename) {
         fprintf(stderr, "SDR type 'ifile' requires an --ifile argument\n");
@@ -140,9 +602,14 @@ bool ifileOpen(void) {
             return false;
     }
 
-    ifile.bufsize = ifile.bytes_per_sample * MODES_MAG_BUF_SAMPLES; /* ~1M samples, about half a second's worth */
+    ifile.bufsize = ifile.bytes_per_sample * Modes.mag_buf_samples; /* one FIFO block */
 
-    if (!(ifile.readbuf = malloc(ifile.bufsize))) {
+    if ((ifile.decompressor = ifileDetect())) {
+        if (!ifileDecompressInit()) {
+            ifileClose();
+            return false;
+        }
+    } else if (!ifileMap() && !(ifile.readbuf = malloc(ifile.bufsize))) {
         fprintf(stderr, "ifile: failed to allocate read buffer\n");
         ifileClose();
         return false;
@@ -172,6 +639,15 @@ void ifileRun() {
 
     uint64_t sampleCounter = 0;
 
+    if (ifile.decompressor) {
+        if (pthread_create(&ifile.raw_thread, NULL, ifileDecompressThreadEntryPoint, NULL)) {
+            fprintf(stderr, "ifile: can't start the decompression thread\n");
+            Modes.exit = 1;
+            return;
+        }
+        ifile.raw_thread_running = true;
+    }
+
     while (!Modes.exit && !eof) {
 
         /* wait for up to 1000ms for a buffer */
@@ -195,8 +671,20 @@ void ifileRun() {
         }
 
         unsigned bytes_read = 0;
-        while (bytes_read < bytes_wanted) {
-            ssize_t nread = read(ifile.fd, ifile.readbuf + bytes_read, bytes_wanted - bytes_read);
+        void *samples = ifile.readbuf;
+        struct raw_block *raw = NULL;
+        if (ifile.map) {
+            samples = ifileMapNext(bytes_wanted, &bytes_read);
+            eof = (bytes_read < bytes_wanted);
+        } else if (ifile.decompressor) {
+            // blocks are bufsize bytes, i.e. bytes_wanted
+            raw = ifileRawNext();
+            samples = raw->data;
+            bytes_read = raw->len;
+            eof = raw->last;
+        }
+        while (samples == ifile.readbuf && bytes_read < bytes_wanted) {
+            ssize_t nread = ifileRead(ifile.readbuf + bytes_read, bytes_wanted - bytes_read);
             if (nread <= 0) {
                 if (nread < 0) {
                     fprintf(stderr, "ifile: error reading input file: %s\n", strerror(errno));
@@ -211,10 +699,13 @@ void ifileRun() {
         unsigned samples_read = bytes_read / ifile.bytes_per_sample;
 
         // Convert the new data
-        ifile.converter(ifile.readbuf, &outbuf->data[outbuf->overlap], samples_read, ifile.converter_state, &outbuf->mean_level, &outbuf->mean_power);
+        ifile.converter(samples, &outbuf->data[outbuf->overlap], samples_read, ifile.converter_state, &outbuf->mean_level, &outbuf->mean_power);
         outbuf->validLength = outbuf->overlap + samples_read;
         outbuf->flags = 0;
 
+        if (raw)
+            ifileRawDone();
+
         if (ifile.throttle || Modes.interactive) {
             // Wait until we are allowed to release this buffer to the FIFO
             while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next_buffer_delivery, NULL) == EINTR)
@@ -248,6 +739,38 @@ void ifileClose() {
         ifile.readbuf = NULL;
     }
 
+    if (ifile.map) {
+        munmap(ifile.map, ifile.map_size);
+        ifile.map = NULL;
+        ifile.map_size = 0;
+    }
+
+    if (ifile.raw_thread_running) {
+        pthread_mutex_lock(&ifile.raw_mutex);
+        ifile.raw_stop = true;
+        pthread_cond_broadcast(&ifile.raw_cond);
+        pthread_mutex_unlock(&ifile.raw_mutex);
+        pthread_join(ifile.raw_thread, NULL);
+        ifile.raw_thread_running = false;
+    }
+
+    if (ifile.decompressor) {
+        if (ifile.decompressor_initialized) {
+            if (ifile.decompressor->cleanup)
+                ifile.decompressor->cleanup();
+            pthread_mutex_destroy(&ifile.raw_mutex);
+            pthread_cond_destroy(&ifile.raw_cond);
+            ifile.decompressor_initialized = false;
+        }
+        for (int i = 0; i < IFILE_RAW_BLOCKS; ++i) {
+            free(ifile.raw[i].data);
+            ifile.raw[i].data = NULL;
+        }
+        free(ifile.inbuf);
+        ifile.inbuf = NULL;
+        ifile.decompressor = NULL;
+    }
+
     if (ifile.fd >= 0 && ifile.fd != STDIN_FILENO) {
         close(ifile.fd);
         ifile.fd = -1;
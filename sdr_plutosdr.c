@@ -135,13 +135,13 @@ bool plutosdrOpen() {
     iio_channel_enable(PLUTOSDR.rx0_i);
     iio_channel_enable(PLUTOSDR.rx0_q);
 
-    PLUTOSDR.rxbuf = iio_device_create_buffer(PLUTOSDR.dev, MODES_MAG_BUF_SAMPLES, false);
+    PLUTOSDR.rxbuf = iio_device_create_buffer(PLUTOSDR.dev, Modes.mag_buf_samples, false);
 
     if (!PLUTOSDR.rxbuf) {
         perror("plutosdr: Could not create RX buffer");
     }
 
-    if (!(PLUTOSDR.readbuf = malloc(MODES_RTL_BUF_SIZE * 4))) {
+    if (!(PLUTOSDR.readbuf = malloc(Modes.mag_buf_samples * 8))) {
         fprintf(stderr, "plutosdr: Failed to allocate read buffer\n");
         plutosdrClose();
         return false;
@@ -248,7 +248,7 @@ bool rtlsdrOpen(void) {
     }
 
 #ifdef USE_BOUNCE_BUFFER
-    if (!(RTLSDR.bounce_buffer = malloc(MODES_RTL_BUF_SIZE))) {
+    if (!(RTLSDR.bounce_buffer = malloc(Modes.mag_buf_samples * 2))) {
         fprintf(stderr, "rtlsdr: can't allocate bounce buffer\n");
         rtlsdrClose();
         return false;
@@ -330,7 +330,7 @@ void rtlsdrRun() {
         return;
     }
 
-    rtlsdr_read_async(RTLSDR.dev, rtlsdrCallback, NULL, MODES_RTL_BUFFERS, MODES_RTL_BUF_SIZE);
+    rtlsdr_read_async(RTLSDR.dev, rtlsdrCallback, NULL, MODES_RTL_BUFFERS, Modes.mag_buf_samples * 2);
     if (!Modes.exit) {
         fprintf(stderr, "rtlsdr_read_async returned unexpectedly, probably lost the USB device, bailing out");
     }
@@ -81,6 +81,13 @@ void display_stats(struct stats *st) {
         printf("Local receiver:\n");
         printf("  %llu samples processed\n", (unsigned long long) st->samples_processed);
         printf("  %llu samples dropped\n", (unsigned long long) st->samples_dropped);
+        printf("  %u sample buffers, at most %u queued\n", st->fifo_depth, st->fifo_high_water);
+        if (st->beast_batches) {
+            printf("  %u Beast messages read in %u batches, at most %u per batch\n",
+                    st->beast_batch_msgs, st->beast_batches, st->beast_batch_max);
+            printf("  %.0f us mean, %llu us max latency from read to decode\n",
+                    (double) st->beast_latency_sum / st->beast_batch_msgs, (unsigned long long) st->beast_latency_max);
+        }
 
         printf("  %u Mode A/C messages received\n", st->demod_modeac);
         printf("  %u Mode-S message preambles received\n", st->demod_preambles);
@@ -89,6 +96,10 @@ void display_stats(struct stats *st) {
         printf("    %u accepted with correct CRC\n", st->demod_accepted[0]);
         for (j = 1; j <= Modes.nfix_crc; ++j)
             printf("    %u accepted with %d-bit error repaired\n", st->demod_accepted[j], j);
+        printf("  %u preamble phases rejected on CRC while slicing\n", st->demod_rejected_early);
+        printf("  %u preamble phases not scored after a perfect match\n", st->demod_score_skipped);
+        if (st->demod_preambles_dropped)
+            printf("  %u preambles dropped, out of memory\n", st->demod_preambles_dropped);
 
         if (st->noise_power_sum > 0 && st->noise_power_count > 0) {
             printf("  %.1f dBFS noise power\n",
@@ -129,6 +140,30 @@ void display_stats(struct stats *st) {
         printf("    %u accepted with correct CRC\n", st->remote_accepted[0]);
         for (j = 1; j <= Modes.nfix_crc; ++j)
             printf("    %u accepted with %d-bit error repaired\n", st->remote_accepted[j], j);
+        printf("Network system calls:\n");
+        printf("  %u epoll waits, %u reads, %u writes, %u accepts, %u epoll changes\n",
+                st->net_epoll_wait, st->net_read, st->net_write, st->net_accept, st->net_epoll_ctl);
+        printf("Output to the network thread:\n");
+        printf("  %u buffers sent, %u most queued, %u dropped\n",
+                st->net_queue_chunks, st->net_queue_high_water, st->net_queue_dropped);
+        if (st->net_queue_chunks)
+            printf("  %.0f us mean, %llu us max hand-off latency\n",
+                    (double) st->net_queue_latency_sum / st->net_queue_chunks, (unsigned long long) st->net_queue_latency_max);
+        printf("  %u bytes most queued for one client\n", st->net_sendq_high_water);
+        printf("  %u messages (%llu bytes) dropped for slow clients\n",
+                st->net_slow_dropped_messages, (unsigned long long) st->net_slow_dropped_bytes);
+        if (st->net_slow_dropped_beast_out_messages)
+            printf("    %u messages (%llu bytes) of beast_out\n",
+                    st->net_slow_dropped_beast_out_messages, (unsigned long long) st->net_slow_dropped_beast_out_bytes);
+        if (st->net_slow_dropped_beast_reduce_out_messages)
+            printf("    %u messages (%llu bytes) of beast_reduce_out\n",
+                    st->net_slow_dropped_beast_reduce_out_messages, (unsigned long long) st->net_slow_dropped_beast_reduce_out_bytes);
+        if (st->net_slow_dropped_raw_out_messages)
+            printf("    %u messages (%llu bytes) of raw_out\n",
+                    st->net_slow_dropped_raw_out_messages, (unsigned long long) st->net_slow_dropped_raw_out_bytes);
+        if (st->net_slow_dropped_sbs_out_messages)
+            printf("    %u messages (%llu bytes) of sbs_out\n",
+                    st->net_slow_dropped_sbs_out_messages, (unsigned long long) st->net_slow_dropped_sbs_out_bytes);
     }
 
     printf("%u total usable messages\n",
@@ -218,9 +253,19 @@ void add_stats(const struct stats *st1, const struct stats *st2, struct stats *t
         target->demod_preamblePhase[i] = st1->demod_preamblePhase[i] + st2->demod_preamblePhase[i];
         target->demod_bestPhase[i] = st1->demod_bestPhase[i] + st2->demod_bestPhase[i];
     }
+    target->demod_rejected_early = st1->demod_rejected_early + st2->demod_rejected_early;
+    target->demod_score_skipped = st1->demod_score_skipped + st2->demod_score_skipped;
+    target->demod_preambles_dropped = st1->demod_preambles_dropped + st2->demod_preambles_dropped;
 
     target->samples_processed = st1->samples_processed + st2->samples_processed;
     target->samples_dropped = st1->samples_dropped + st2->samples_dropped;
+    target->fifo_depth = max(st1->fifo_depth, st2->fifo_depth);
+    target->fifo_high_water = max(st1->fifo_high_water, st2->fifo_high_water);
+    target->beast_batches = st1->beast_batches + st2->beast_batches;
+    target->beast_batch_msgs = st1->beast_batch_msgs + st2->beast_batch_msgs;
+    target->beast_batch_max = max(st1->beast_batch_max, st2->beast_batch_max);
+    target->beast_latency_sum = st1->beast_latency_sum + st2->beast_latency_sum;
+    target->beast_latency_max = (st1->beast_latency_max > st2->beast_latency_max) ? st1->beast_latency_max : st2->beast_latency_max;
 
     add_timespecs(&st1->demod_cpu, &st2->demod_cpu, &target->demod_cpu);
     add_timespecs(&st1->reader_cpu, &st2->reader_cpu, &target->reader_cpu);
@@ -251,6 +296,29 @@ void add_stats(const struct stats *st1, const struct stats *st2, struct stats *t
     for (i = 0; i < MODES_MAX_BITERRORS + 1; ++i)
         target->remote_accepted[i] = st1->remote_accepted[i] + st2->remote_accepted[i];
 
+    // network syscalls:
+    target->net_epoll_wait = st1->net_epoll_wait + st2->net_epoll_wait;
+    target->net_read = st1->net_read + st2->net_read;
+    target->net_write = st1->net_write + st2->net_write;
+    target->net_accept = st1->net_accept + st2->net_accept;
+    target->net_epoll_ctl = st1->net_epoll_ctl + st2->net_epoll_ctl;
+    target->net_queue_chunks = st1->net_queue_chunks + st2->net_queue_chunks;
+    target->net_queue_high_water = (st1->net_queue_high_water > st2->net_queue_high_water) ? st1->net_queue_high_water : st2->net_queue_high_water;
+    target->net_sendq_high_water = (st1->net_sendq_high_water > st2->net_sendq_high_water) ? st1->net_sendq_high_water : st2->net_sendq_high_water;
+    target->net_slow_dropped_messages = st1->net_slow_dropped_messages + st2->net_slow_dropped_messages;
+    target->net_slow_dropped_bytes = st1->net_slow_dropped_bytes + st2->net_slow_dropped_bytes;
+    target->net_slow_dropped_beast_out_messages = st1->net_slow_dropped_beast_out_messages + st2->net_slow_dropped_beast_out_messages;
+    target->net_slow_dropped_beast_out_bytes = st1->net_slow_dropped_beast_out_bytes + st2->net_slow_dropped_beast_out_bytes;
+    target->net_slow_dropped_beast_reduce_out_messages = st1->net_slow_dropped_beast_reduce_out_messages + st2->net_slow_dropped_beast_reduce_out_messages;
+    target->net_slow_dropped_beast_reduce_out_bytes = st1->net_slow_dropped_beast_reduce_out_bytes + st2->net_slow_dropped_beast_reduce_out_bytes;
+    target->net_slow_dropped_raw_out_messages = st1->net_slow_dropped_raw_out_messages + st2->net_slow_dropped_raw_out_messages;
+    target->net_slow_dropped_raw_out_bytes = st1->net_slow_dropped_raw_out_bytes + st2->net_slow_dropped_raw_out_bytes;
+    target->net_slow_dropped_sbs_out_messages = st1->net_slow_dropped_sbs_out_messages + st2->net_slow_dropped_sbs_out_messages;
+    target->net_slow_dropped_sbs_out_bytes = st1->net_slow_dropped_sbs_out_bytes + st2->net_slow_dropped_sbs_out_bytes;
+    target->net_queue_dropped = st1->net_queue_dropped + st2->net_queue_dropped;
+    target->net_queue_latency_sum = st1->net_queue_latency_sum + st2->net_queue_latency_sum;
+    target->net_queue_latency_max = (st1->net_queue_latency_max > st2->net_queue_latency_max) ? st1->net_queue_latency_max : st2->net_queue_latency_max;
+
     // total messages:
     target->messages_total = st1->messages_total + st2->messages_total;
 
@@ -64,8 +64,20 @@ struct stats {
     uint32_t demod_accepted[MODES_MAX_BITERRORS + 1];
     uint32_t demod_preamblePhase[5];
     uint32_t demod_bestPhase[5];
+    uint32_t demod_rejected_early; // phases rejected on CRC while slicing, never scored
+    uint32_t demod_score_skipped; // phases not scored because a better one was already found
+    uint32_t demod_preambles_dropped; // preambles not looked at, out of memory for candidates
     uint64_t samples_processed;
     uint64_t samples_dropped;
+    // magnitude FIFO:
+    uint32_t fifo_depth; // largest number of sample buffers in circulation
+    uint32_t fifo_high_water; // most sample buffers queued for demodulation at once
+    // Beast serial and file input:
+    uint32_t beast_batches; // message batches handed from the reader thread to the decoder
+    uint32_t beast_batch_msgs; // messages in those batches
+    uint32_t beast_batch_max; // largest batch
+    uint64_t beast_latency_sum; // microseconds from read to decode, summed over beast_batch_msgs
+    uint64_t beast_latency_max; // longest of those, microseconds
     // Mode A/C demodulator counts:
     uint32_t demod_modeac;
     // number of signals with power > -3dBFS
@@ -88,6 +100,29 @@ struct stats {
     uint32_t remote_rejected_bad;
     uint32_t remote_rejected_unknown_icao;
     uint32_t remote_accepted[MODES_MAX_BITERRORS + 1];
+    // network syscalls:
+    uint32_t net_epoll_wait;
+    uint32_t net_read;
+    uint32_t net_write;
+    uint32_t net_accept;
+    uint32_t net_epoll_ctl;
+    // output handed to the network thread:
+    uint32_t net_queue_chunks; // buffers sent by the network thread
+    uint32_t net_queue_high_water; // most buffers queued at once
+    uint32_t net_queue_dropped; // buffers dropped because the queue was full
+    uint64_t net_queue_latency_sum; // microseconds from queueing to sending, summed over net_queue_chunks
+    uint64_t net_queue_latency_max; // longest of those, microseconds
+    uint32_t net_sendq_high_water; // most bytes queued for one client
+    uint32_t net_slow_dropped_messages; // by the slow consumer policies
+    uint64_t net_slow_dropped_bytes;
+    uint32_t net_slow_dropped_beast_out_messages; // the same per output service
+    uint64_t net_slow_dropped_beast_out_bytes;
+    uint32_t net_slow_dropped_beast_reduce_out_messages;
+    uint64_t net_slow_dropped_beast_reduce_out_bytes;
+    uint32_t net_slow_dropped_raw_out_messages;
+    uint64_t net_slow_dropped_raw_out_bytes;
+    uint32_t net_slow_dropped_sbs_out_messages;
+    uint64_t net_slow_dropped_sbs_out_bytes;
     // total messages:
     uint32_t messages_total;
     // CPR decoding:
@@ -243,6 +243,9 @@ struct aircraft *trackUpdateFromMessage(struct modesMessage *mm);
 /* Call periodically */
 void trackPeriodicUpdate();
 
+/* Distance in meters between two points */
+double greatcircle(double lat0, double lon0, double lat1, double lon1);
+
 /* Convert from a (hex) mode A value to a 0-4095 index */
 static inline unsigned
 modeAToIndex(unsigned modeA) {
@@ -55,14 +55,24 @@
 
 #include <stdlib.h>
 #include <sys/time.h>
+#include <sys/mman.h>
+#include <sched.h>
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
 
 uint64_t _messageNow = 0;
 
 uint64_t mstime(void) {
-    if (Modes.sdr_type == SDR_IFILE) {
+    if (Modes.sdr_type == SDR_IFILE || Modes.sdr_type == SDR_BEASTFILE) {
         return Modes.ifile_now;
     }
 
+    return system_mstime();
+}
+
+uint64_t system_mstime(void) {
     struct timeval tv;
     uint64_t mst;
 
@@ -131,4 +141,126 @@ void set_thread_name(const char *name) {
 #else
     MODES_NOTUSED(name);
 #endif
-}
\ No newline at end of file
+}
+
+static cpu_set_t process_cpuset;
+static bool process_cpuset_saved;
+
+void save_process_affinity(void) {
+    process_cpuset_saved = (sched_getaffinity(0, sizeof (process_cpuset), &process_cpuset) == 0);
+}
+
+void worker_thread_init(const char *name) {
+    set_thread_name(name);
+    if (process_cpuset_saved)
+        pthread_setaffinity_np(pthread_self(), sizeof (cpu_set_t), &process_cpuset);
+}
+//
+// Hot memory, see util.h
+//
+
+bool hot_memory_pinned(void) {
+    return Modes.pin_memory;
+}
+
+// Smaller allocations stay on normal pages: a huge page each for the small
+// lookup tables would mostly be padding
+#define HOT_HUGE_MIN_SIZE (HOT_HUGE_PAGE_SIZE / 2)
+
+static bool hot_huge(size_t size) {
+    return Modes.pin_memory && size >= HOT_HUGE_MIN_SIZE;
+}
+
+static size_t hot_size(size_t size) {
+    size_t page = hot_huge(size) ? HOT_HUGE_PAGE_SIZE : (size_t) sysconf(_SC_PAGESIZE);
+    return (size + page - 1) / page * page;
+}
+
+// NUMA node of the calling thread if it is pinned to a single CPU, else -1
+
+static int hot_numa_node(void) {
+#if defined(__linux__)
+    cpu_set_t cpuset;
+    unsigned cpu, node;
+
+    if (sched_getaffinity(0, sizeof (cpuset), &cpuset) < 0 || CPU_COUNT(&cpuset) != 1)
+        return -1;
+    if (syscall(SYS_getcpu, &cpu, &node, NULL) < 0)
+        return -1;
+    return node;
+#else
+    return -1;
+#endif
+}
+
+void hot_pin(void *ptr, size_t size, bool huge, const char *what) {
+    char numa[64] = "not NUMA bound (demod thread not pinned)";
+    const char *pages = huge ? "2MB huge pages" : "4kB pages";
+    char locked[128] = "locked";
+    int node;
+
+    if (!Modes.pin_memory)
+        return;
+
+    // bind before the pages are first touched (mlock below faults them in)
+    if ((node = hot_numa_node()) >= 0) {
+#if defined(__linux__)
+        unsigned long nodemask = 1UL << node;
+        // MPOL_BIND = 2, MPOL_MF_MOVE = 2; no <numaif.h> without libnuma
+        if (syscall(SYS_mbind, ptr, size, 2, &nodemask, sizeof (nodemask) * 8, 2) == 0)
+            snprintf(numa, sizeof (numa), "bound to NUMA node %d", node);
+        else
+            snprintf(numa, sizeof (numa), "not NUMA bound (%s)", strerror(errno));
+#endif
+    }
+
+#if defined(MADV_HUGEPAGE)
+    if (!huge && size >= HOT_HUGE_PAGE_SIZE && madvise(ptr, size, MADV_HUGEPAGE) == 0)
+        pages = "transparent huge pages";
+#endif
+
+    if (mlock(ptr, size) < 0)
+        snprintf(locked, sizeof (locked), "not locked (%s)", strerror(errno));
+
+    fprintf(stderr, "memory: %s: %.1fMB, %s, %s, %s\n", what, size / 1048576.0, pages, locked, numa);
+}
+
+void *hot_alloc(size_t size, const char *what) {
+    size_t len = hot_size(size);
+    bool huge = false;
+    void *ptr = MAP_FAILED;
+
+    if (hot_huge(size)) {
+#if defined(MAP_HUGETLB)
+        // explicit huge pages, only if the administrator reserved some
+        ptr = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        huge = (ptr != MAP_FAILED);
+#endif
+        if (ptr == MAP_FAILED) {
+            // align to a huge page so transparent huge pages can back all of it
+            char *base = mmap(NULL, len + HOT_HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (base != MAP_FAILED) {
+                char *aligned = (char *) (((uintptr_t) base + HOT_HUGE_PAGE_SIZE - 1) & ~((uintptr_t) HOT_HUGE_PAGE_SIZE - 1));
+                if (aligned > base)
+                    munmap(base, aligned - base);
+                munmap(aligned + len, base + HOT_HUGE_PAGE_SIZE - aligned);
+                ptr = aligned;
+            }
+        }
+    } else {
+        ptr = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    }
+
+    if (ptr == MAP_FAILED) {
+        fprintf(stderr, "can't allocate %s: %s\n", what, strerror(errno));
+        return NULL;
+    }
+
+    hot_pin(ptr, len, huge, what);
+    return ptr;
+}
+
+void hot_free(void *ptr, size_t size) {
+    if (ptr)
+        munmap(ptr, hot_size(size));
+}
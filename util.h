@@ -25,10 +25,15 @@
 #define UTIL_H
 
 #include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
 
-/* Returns system time in milliseconds */
+/* Returns system time in milliseconds, or the replay time when replaying a file */
 uint64_t mstime(void);
 
+/* Returns system time in milliseconds, also when replaying a file */
+uint64_t system_mstime(void);
+
 /* Returns the time for the current message we're dealing with */
 extern uint64_t _messageNow;
 
@@ -66,4 +71,29 @@ void update_cpu_timing(struct timespec *start_time, struct timespec *add_to);
 /* set current thread name, if supported */
 void set_thread_name(const char *name);
 
+/* remember the CPU affinity we were started with, e.g. by taskset, before the main thread pins itself */
+void save_process_affinity(void);
+
+/* set up a worker thread: name it and give it the CPU affinity we were started with instead of the core the
+ * creating thread is pinned to; without a saved affinity the inherited one is kept */
+void worker_thread_init(const char *name);
+
+/* "Hot" memory: the large, long lived buffers and tables that the demodulator
+ * touches all the time. With --pin-memory these are locked into RAM, bound to
+ * the NUMA node of the (pinned) demodulator thread, and, if at least half a
+ * huge page, put on 2MB huge pages where available; each allocation reports
+ * what it got. Otherwise they are plain anonymous mappings.
+ */
+bool hot_memory_pinned(void);
+
+/* Allocate zeroed hot memory, NULL on failure. Free with hot_free() and the same size. */
+void *hot_alloc(size_t size, const char *what);
+void hot_free(void *ptr, size_t size);
+
+/* Apply --pin-memory to an existing mapping; huge is true if it is already on huge pages */
+void hot_pin(void *ptr, size_t size, bool huge, const char *what);
+
+/* Size of the huge pages hot memory tries to use */
+#define HOT_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
 #endif